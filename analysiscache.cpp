@@ -0,0 +1,150 @@
+#include "analysiscache.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <stdexcept>
+#include <type_traits>
+#include <vector>
+
+#include "version.h"
+
+namespace chip8
+{
+    namespace
+    {
+        constexpr char k_magic[8] = { 'c', 'h', 'i', 'p', '8', 'a', 'n', 'a' };
+
+        struct Header
+        {
+            char magic[8];
+            char version[64];       // CHIP8_VERSION, zero padded
+            uint32_t recordSize;    // sizeof(RomAnalysis), in case a build of the same version changed it
+            uint32_t reserved;
+            uint64_t count;         // no. of records following
+        };
+
+        static_assert(sizeof(CHIP8_VERSION) <= sizeof(Header::version), "the version fits the header");
+
+        bool isKeyLess(const RomAnalysis& a, const RomAnalysis& b)
+        {
+            return a.hash != b.hash ? a.hash < b.hash : a.size < b.size;
+        }
+    }
+
+    static_assert(std::is_trivially_copyable<RomAnalysis>::value, "analyses are written and mapped as they are");
+    static_assert(sizeof(Header) % alignof(uint64_t) == 0, "records follow the header aligned");
+
+
+    AnalysisCache::AnalysisCache(const std::string& path)
+        :   m_path(path)
+    {
+        map();
+    }
+
+    RomAnalysis AnalysisCache::analyze(const uint8_t* rom, size_t size)
+    {
+        if (const RomAnalysis* cached = find(romHash(rom, size), size))
+            return *cached;
+
+        const RomAnalysis analysis = analyzeRom(rom, size);
+        add(analysis);
+        return analysis;
+    }
+
+    void AnalysisCache::map()
+    {
+        const int fd = open(m_path.c_str(), O_RDONLY);
+        if (fd < 0)
+            return;
+
+        struct stat info;
+        if (fstat(fd, &info) < 0 || static_cast<size_t>(info.st_size) < sizeof(Header))
+        {
+            close(fd);
+            return;
+        }
+
+        void* data = mmap(nullptr, info.st_size, PROT_READ, MAP_SHARED, fd, 0);
+        close(fd);
+
+        if (data == MAP_FAILED)
+            return;
+
+        m_map = static_cast<const uint8_t*>(data);
+        m_mapSize = info.st_size;
+
+        const Header* header = reinterpret_cast<const Header*>(m_map);
+        if (memcmp(header->magic, k_magic, sizeof(k_magic)) != 0 ||
+            strncmp(header->version, CHIP8_VERSION, sizeof(header->version)) != 0 ||
+            header->recordSize != sizeof(RomAnalysis) || m_mapSize != sizeof(Header) + header->count * sizeof(RomAnalysis))
+            return;
+
+        m_records = reinterpret_cast<const RomAnalysis*>(m_map + sizeof(Header));
+        m_count = header->count;
+    }
+
+    void AnalysisCache::unmap()
+    {
+        if (m_map)
+            munmap(const_cast<uint8_t*>(m_map), m_mapSize);
+
+        m_map = nullptr;
+        m_mapSize = 0;
+        m_records = nullptr;
+        m_count = 0;
+    }
+
+    const RomAnalysis* AnalysisCache::find(uint64_t hash, uint32_t size) const
+    {
+        RomAnalysis key {};
+        key.hash = hash;
+        key.size = size;
+
+        const RomAnalysis* found = std::lower_bound(m_records, m_records + m_count, key, isKeyLess);
+        return found != m_records + m_count && found->hash == hash && found->size == size ? found : nullptr;
+    }
+
+    void AnalysisCache::add(const RomAnalysis& analysis)
+    {
+        // another process may have added analyses since the file was mapped
+        unmap();
+        map();
+
+        if (find(analysis.hash, analysis.size))
+            return;
+
+        std::vector<RomAnalysis> records(m_records, m_records + m_count);
+        records.insert(std::upper_bound(records.begin(), records.end(), analysis, isKeyLess), analysis);
+
+        Header header {};
+        memcpy(header.magic, k_magic, sizeof(k_magic));
+        strncpy(header.version, CHIP8_VERSION, sizeof(header.version));
+        header.recordSize = sizeof(RomAnalysis);
+        header.count = records.size();
+
+        const std::string temporary = m_path + ".tmp." + std::to_string(getpid());
+        FILE* file = fopen(temporary.c_str(), "wb");
+        if (!file)
+            throw std::runtime_error("ERROR: Unable to write analysis cache " + temporary + ": " + strerror(errno));
+
+        const bool isWritten = fwrite(&header, sizeof(header), 1, file) == 1 &&
+                               fwrite(records.data(), sizeof(RomAnalysis), records.size(), file) == records.size();
+
+        if (fclose(file) != 0 || !isWritten || rename(temporary.c_str(), m_path.c_str()) != 0)
+        {
+            const std::string reason = strerror(errno);
+            remove(temporary.c_str());
+            throw std::runtime_error("ERROR: Unable to write analysis cache " + m_path + ": " + reason);
+        }
+
+        unmap();
+        map();
+    }
+}
@@ -0,0 +1,74 @@
+#ifndef ANALYSISCACHE_H
+#define ANALYSISCACHE_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include <string>
+
+#include "rom.h"
+
+namespace chip8
+{
+    /**
+     * RomAnalyses kept in a file across runs, keyed by the rom's hash and
+     * size and by the version of the emulator that wrote them, see
+     * CHIP8_VERSION, so short lived runs start without analysing their rom again.
+     *
+     * The file is a header and the analyses as they are in memory, sorted
+     * by key, so it only suits the machine and build that wrote it. It is
+     * mapped read-only and looked up in place with a binary search, nothing
+     * is parsed or copied to open it. New analyses are merged with what the
+     * file holds by then into a new file renamed over the old one, so other
+     * processes using the cache always see a whole file.
+    **/
+    class AnalysisCache
+    {
+    public:
+        /**
+         * maps the file at path if there is one. a file written by another
+         * version, or that is no cache, is left alone till an analysis is added.
+        **/
+        AnalysisCache(const std::string& path);
+        ~AnalysisCache() { unmap(); }
+
+        AnalysisCache(const AnalysisCache&) = delete;
+        AnalysisCache& operator=(const AnalysisCache&) = delete;
+
+        /**
+         * @returns the analysis of rom, from the file if it holds one,
+         *  otherwise done by analyzeRom() and added to the file
+         * @throws runtime_error if the analysis cannot be added to the file
+        **/
+        RomAnalysis analyze(const uint8_t* rom, size_t size);
+
+        /**
+         * @returns no. of analyses in the file as mapped
+        **/
+        size_t size() const { return m_count; }
+
+    private:
+        std::string m_path;
+
+        const uint8_t* m_map {};
+        size_t m_mapSize {};
+
+        const RomAnalysis* m_records {};
+        size_t m_count {};
+
+        /**
+         * maps the file as it is now, if it is a cache of this version
+        **/
+        void map();
+        void unmap();
+
+        const RomAnalysis* find(uint64_t hash, uint32_t size) const;
+
+        /**
+         * @throws runtime_error if the file cannot be written
+        **/
+        void add(const RomAnalysis& analysis);
+    };
+}
+
+#endif /* ANALYSISCACHE_H */
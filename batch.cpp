@@ -0,0 +1,1139 @@
+#include "batch.h"
+
+#include <string.h>
+
+#include <algorithm>
+#include <stdexcept>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define BATCH_HAVE_X86_KERNELS
+#endif
+
+// inlined even without optimisation, so the vector code is built for the vector unit of the kernel using it
+#define BATCH_INLINE __attribute__((always_inline)) inline
+
+// GCC notes vectors returned without AVX, never done as all is inlined
+#pragma GCC diagnostic ignored "-Wpsabi"
+
+namespace chip8
+{
+    namespace
+    {
+        constexpr size_t k_block = BatchEngine::k_laneBlock;
+        constexpr size_t k_half = k_block / 2;
+        constexpr size_t k_quarter = k_block / 4;
+
+        // groups of lanes gathered in a step at most, and the fewest lanes
+        // worth gathering another group for, the rest go one by one
+        constexpr size_t k_maxGroups = 8;
+        constexpr size_t k_minGroupLanes = 4;
+
+        // a field of a block of lanes, or of part of one, in GCC's vector
+        // extensions so the same code compiles for whatever vector unit the
+        // function using it is built for. a vector never gets wider than a
+        // block of bytes, GCC splits wider ones badly. comparisons give
+        // masks, all bits of a lane set where true.
+        typedef uint8_t Bytes __attribute__((vector_size(k_block)));
+        typedef int8_t Mask8 __attribute__((vector_size(k_block)));
+
+        typedef uint8_t HalfBytes __attribute__((vector_size(k_half)));
+        typedef int8_t HalfMask8 __attribute__((vector_size(k_half)));
+        typedef uint16_t Words __attribute__((vector_size(k_half * 2)));
+        typedef int16_t Mask16 __attribute__((vector_size(k_half * 2)));
+
+        typedef int8_t QuarterMask8 __attribute__((vector_size(k_quarter)));
+        typedef uint32_t Longs __attribute__((vector_size(k_quarter * 4)));
+        typedef int32_t Mask32 __attribute__((vector_size(k_quarter * 4)));
+
+        template <typename Vector, typename T>
+        BATCH_INLINE Vector load(const T* at)
+        {
+            Vector vector;
+            memcpy(&vector, at, sizeof(vector));
+            return vector;
+        }
+
+        template <typename T, typename Vector>
+        BATCH_INLINE void store(T* at, const Vector& vector)
+        {
+            memcpy(at, &vector, sizeof(vector));
+        }
+
+        /**
+         * stores value into the lanes selected by mask, leaving the others be
+        **/
+        template <typename T, typename Vector>
+        BATCH_INLINE void update(T* at, const Vector& mask, const Vector& value)
+        {
+            store(at, (value & mask) | (load<Vector>(at) & ~mask));
+        }
+
+        /**
+         * @returns the mask of half a block of lanes at, for their 16 bit fields
+        **/
+        BATCH_INLINE Words widenHalf(const uint8_t* at)
+        {
+            return reinterpret_cast<Words>(__builtin_convertvector(load<HalfMask8>(at), Mask16));
+        }
+
+        /**
+         * @returns the mask of a quarter block of lanes at, for their 32 bit fields
+        **/
+        BATCH_INLINE Longs widenQuarter(const uint8_t* at)
+        {
+            return reinterpret_cast<Longs>(__builtin_convertvector(load<QuarterMask8>(at), Mask32));
+        }
+
+        BATCH_INLINE Words zeroExtend(const uint8_t* at)
+        {
+            return __builtin_convertvector(load<HalfBytes>(at), Words);
+        }
+
+        template <typename Vector>
+        BATCH_INLINE bool any(const Vector& mask)
+        {
+            uint64_t words[sizeof(mask) / sizeof(uint64_t)];
+            memcpy(words, &mask, sizeof(mask));
+
+            uint64_t bits = 0;
+            for (uint64_t word : words)
+                bits |= word;
+            return bits != 0;
+        }
+
+        /**
+         * @returns no. of lanes set in mask
+        **/
+        BATCH_INLINE size_t count(const Bytes& mask)
+        {
+            uint64_t words[sizeof(mask) / sizeof(uint64_t)];
+            memcpy(words, &mask, sizeof(mask));
+
+            size_t lanes = 0;
+            for (uint64_t word : words)
+                lanes += __builtin_popcountll(word & 0x0101010101010101);
+            return lanes;
+        }
+    }
+
+    /**
+     * The stepping of the lanes, compiled once for every vector unit run() may
+     * use and quirk profile of a CHIP-8 platform
+    **/
+    template <typename Profile>
+    struct BatchKernels
+    {
+        BATCH_INLINE static void run(BatchEngine& self, uint64_t instructions)
+        {
+            for (uint64_t i = 0; i < instructions && self.m_firstRunning < self.m_lanes; i++)
+            {
+                step(self);
+                self.m_instructions++;
+            }
+        }
+
+        /**
+         * executes an instruction on every running lane, those at the same
+         * one as the first lane still pending together, until k_maxGroups
+         * were or one turned out to have fewer than k_minGroupLanes lanes.
+         * lanes kept together by the last step are not gathered again.
+        **/
+        BATCH_INLINE static void step(BatchEngine& self)
+        {
+            const size_t running = self.m_runningLanes;
+
+            if (self.m_isUniform)
+            {
+                const size_t first = self.m_firstRunning;
+                const uint16_t pc = self.m_PC[first];
+
+                if (pc + 1u < BatchEngine::k_memorySize)
+                {
+                    const uint16_t op = (self.m_ram[pc * self.m_stride + first] << 8) | self.m_ram[(pc + 1) * self.m_stride + first];
+
+                    if (isCommonOp(self, first, pc, op))
+                    {
+                        std::copy(self.m_running.begin(), self.m_running.end(), self.m_group.begin());
+                        self.m_uniformInstructions++;
+                        self.m_isUniform = executeGroup(self, first, op, running) && keepsTogether(op);
+                        return;
+                    }
+                }
+                self.m_isUniform = false;
+            }
+
+            std::copy(self.m_running.begin(), self.m_running.end(), self.m_pending.begin());
+
+            size_t first = self.m_firstRunning;
+            bool gathering = true;
+            for (size_t groups = 0; first < self.m_lanes; groups++)
+            {
+                const uint16_t pc = self.m_PC[first];
+
+                if (groups == k_maxGroups || !gathering)
+                {
+                    for (size_t lane = first; lane < self.m_lanes; lane++)
+                        if (self.m_pending[lane])
+                            self.template executeLane<Profile>(lane, -1);
+                    return;
+                }
+
+                // fetching past the end, faults
+                if (pc + 1u >= BatchEngine::k_memorySize)
+                {
+                    self.m_pending[first] = 0;
+                    self.template executeLane<Profile>(first, -1);
+                    first = nextPending(self, first + 1);
+                    continue;
+                }
+
+                const uint16_t op = (self.m_ram[pc * self.m_stride + first] << 8) | self.m_ram[(pc + 1) * self.m_stride + first];
+
+                bool pending;
+                const size_t lanes = gather(self, first, pc, op, pending);
+                if (lanes == running)
+                    self.m_uniformInstructions++;
+
+                self.m_isUniform = executeGroup(self, first, op, lanes) && lanes == running && keepsTogether(op);
+
+                // lanes this spread out cost more to gather than they save
+                gathering = lanes >= k_minGroupLanes;
+                first = pending ? nextPending(self, first + 1) : self.m_lanes;
+            }
+        }
+
+        /**
+         * sets m_group to the pending lanes from the block of first on that are
+         * at pc with op there, removing them from m_pending
+         * @param pending set if lanes are left pending
+         * @returns no. of lanes in the group
+        **/
+        BATCH_INLINE static size_t gather(BatchEngine& self, size_t first, uint16_t pc, uint16_t op, bool& pending)
+        {
+            const uint8_t* high = &self.m_ram[pc * self.m_stride];
+            const uint8_t* low = high + self.m_stride;
+
+            const Words pcs = Words{} + pc;
+            const Bytes highs = Bytes{} + static_cast<uint8_t>(op >> 8);
+            const Bytes lows = Bytes{} + static_cast<uint8_t>(op);
+
+            size_t lanes = 0;
+            Bytes left {};
+            for (size_t lane = first - first % k_block; lane < self.m_stride; lane += k_block)
+            {
+                uint8_t atPc[k_block];
+                for (size_t half = 0; half < k_block; half += k_half)
+                    store(atPc + half, __builtin_convertvector(load<Words>(&self.m_PC[lane + half]) == pcs, HalfMask8));
+
+                // the same address holds the same instruction unless a lane wrote to it
+                const Bytes candidates = load<Bytes>(&self.m_pending[lane]);
+                const Bytes group = candidates & load<Bytes>(atPc) &
+                                    reinterpret_cast<Bytes>(load<Bytes>(high + lane) == highs) &
+                                    reinterpret_cast<Bytes>(load<Bytes>(low + lane) == lows);
+
+                store(&self.m_group[lane], group);
+                store(&self.m_pending[lane], candidates & ~group);
+                left |= candidates & ~group;
+                lanes += count(group);
+            }
+
+            pending = any(left);
+            return lanes;
+        }
+
+        /**
+         * @returns true if every running lane, from the block of first on, holds op at pc
+        **/
+        BATCH_INLINE static bool isCommonOp(const BatchEngine& self, size_t first, uint16_t pc, uint16_t op)
+        {
+            const uint8_t* high = &self.m_ram[pc * self.m_stride];
+            const uint8_t* low = high + self.m_stride;
+
+            const Bytes highs = Bytes{} + static_cast<uint8_t>(op >> 8);
+            const Bytes lows = Bytes{} + static_cast<uint8_t>(op);
+
+            for (size_t lane = first - first % k_block; lane < self.m_stride; lane += k_block)
+                if (any(load<Bytes>(&self.m_running[lane]) &
+                        reinterpret_cast<Bytes>((load<Bytes>(high + lane) != highs) | (load<Bytes>(low + lane) != lows))))
+                    return false;
+
+            return true;
+        }
+
+        /**
+         * @returns true if lanes at the same PC executing op together are
+         *  still at the same PC afterwards, whatever their registers hold
+        **/
+        static constexpr bool keepsTogether(uint16_t op)
+        {
+            switch (op & 0xF000)
+            {
+            case 0x0:
+                return op != 0x00EE;
+
+            case 0x3000: case 0x4000: case 0x5000: case 0x9000: case 0xB000: case 0xE000:
+                return false;
+
+            case 0xD000:
+                return !Profile::k_quirks.displayWait;
+
+            case 0xF000:
+                return (op & 0xFF) != 0x0A;
+
+            default:
+                return true;
+            }
+        }
+
+        BATCH_INLINE static size_t nextPending(const BatchEngine& self, size_t from)
+        {
+            const void* at = memchr(self.m_pending.data() + from, 0xFF, self.m_lanes - from);
+            return at ? static_cast<const uint8_t*>(at) - self.m_pending.data() : self.m_lanes;
+        }
+
+        /**
+         * executes op on the lanes of m_group, from first on, in vector code
+         * if executeAll() does it and lane by lane otherwise
+         * @param lanes no. of lanes in the group
+         * @returns true if executeAll() did it
+        **/
+        BATCH_INLINE static bool executeGroup(BatchEngine& self, size_t first, uint16_t op, size_t lanes)
+        {
+            if (lanes == 1)
+            {
+                self.template executeLane<Profile>(first, op);
+                return false;
+            }
+
+            if (executeAll(self, first, op))
+                return true;
+
+            for (size_t lane = first; lane < self.m_lanes; lane++)
+                if (self.m_group[lane])
+                    self.template executeLane<Profile>(lane, op);
+
+            return false;
+        }
+
+        /**
+         * executes op on the lanes of m_group, from first on, if it is one of those done here
+         * @returns false if it is not, nothing was done then
+        **/
+        BATCH_INLINE static bool executeAll(BatchEngine& self, size_t first, uint16_t op)
+        {
+            const uint8_t depth = self.m_stackDepth[first];
+
+            switch (op & 0xF000)
+            {
+            case 0x0:
+                // the display instructions of SUPER-CHIP go lane by lane
+                if (Profile::k_hasHires && (op == 0x00FB || op == 0x00FC || op == 0x00FE || op == 0x00FF || (op & 0xFFF0) == 0x00C0))
+                    return false;
+
+                // lanes returning from an empty call stack fault
+                if (op == 0x00EE && (depth == 0 || !isCommonDepth(self, first)))
+                    return false;
+                break;
+
+            case 0x2000:
+                // lanes calling with a full call stack fault
+                if (depth == Cpu::k_stackSize || !isCommonDepth(self, first))
+                    return false;
+                break;
+
+            case 0x1000: case 0x3000: case 0x4000: case 0x5000: case 0x6000:
+            case 0x7000: case 0x8000: case 0x9000: case 0xA000: case 0xB000: case 0xC000:
+                break;
+
+            case 0xD000:
+                // the sprite as rows of memory, if every lane draws it from the same address
+                if (!isCommonI(self, first, std::max<uint8_t>(self.m_displays[first].spriteSize(op & 0xF), 1) - 1))
+                    return false;
+                break;
+
+            case 0xE000:
+                // lanes reading keys past 0xF fault
+                if (!isKeyInRange(self, first, (op & 0x0F00) >> 8))
+                    return false;
+                break;
+
+            case 0xF000:
+                switch (op & 0xFF)
+                {
+                case 0x07: case 0x0A: case 0x15: case 0x18: case 0x1E: case 0x29:
+                    break;
+
+                // as rows of memory, if every lane accesses the same one
+                case 0x55: case 0x65:
+                    if (!isCommonI(self, first, (op & 0x0F00) >> 8))
+                        return false;
+                    break;
+
+                default:
+                    return false;
+                }
+                break;
+
+            default:
+                return false;
+            }
+
+            // before the first block moves them, see Quirks::loadStoreIncrementsI
+            const uint16_t I = self.m_I[first];
+            for (size_t lane = first - first % k_block; lane < self.m_stride; lane += k_block)
+                if (any(load<Bytes>(&self.m_group[lane])))
+                    executeBlock(self, lane, op, I, depth);
+
+            return true;
+        }
+
+        /**
+         * @returns true if all lanes of m_group, from first on, have first's call stack depth
+        **/
+        BATCH_INLINE static bool isCommonDepth(const BatchEngine& self, size_t first)
+        {
+            const Bytes depths = Bytes{} + self.m_stackDepth[first];
+            for (size_t lane = first - first % k_block; lane < self.m_stride; lane += k_block)
+                if (any(load<Bytes>(&self.m_group[lane]) & reinterpret_cast<Bytes>(load<Bytes>(&self.m_stackDepth[lane]) != depths)))
+                    return false;
+
+            return true;
+        }
+
+        /**
+         * @returns true if register x of all lanes of m_group, from first on, is a key
+        **/
+        BATCH_INLINE static bool isKeyInRange(const BatchEngine& self, size_t first, uint8_t x)
+        {
+            for (size_t lane = first - first % k_block; lane < self.m_stride; lane += k_block)
+                if (any(load<Bytes>(&self.m_group[lane]) & reinterpret_cast<Bytes>(load<Bytes>(&self.m_V[x * self.m_stride + lane]) > 0xF)))
+                    return false;
+
+            return true;
+        }
+
+        /**
+         * @returns true if all lanes of m_group, from first on, hold first's
+         *  I and the x + 1 bytes from there are in memory
+        **/
+        BATCH_INLINE static bool isCommonI(const BatchEngine& self, size_t first, uint8_t x)
+        {
+            const uint16_t I = self.m_I[first];
+            if (I + x >= BatchEngine::k_memorySize)
+                return false;
+
+            const Words Is = Words{} + I;
+            for (size_t lane = first - first % k_block; lane < self.m_stride; lane += k_half)
+                if (any(widenHalf(&self.m_group[lane]) & reinterpret_cast<Words>(load<Words>(&self.m_I[lane]) != Is)))
+                    return false;
+
+            return true;
+        }
+
+        /**
+         * executes op on the lanes of m_group in the block from lane on, as
+         * BatchEngine::execute() would
+         * @param I of the lanes, for the memory accesses, see isCommonI()
+         * @param depth of the lanes' call stacks, see isCommonDepth()
+        **/
+        BATCH_INLINE static void executeBlock(BatchEngine& self, size_t lane, uint16_t op, uint16_t I, uint8_t depth)
+        {
+            const size_t stride = self.m_stride;
+            const uint8_t* group = &self.m_group[lane];
+            const Bytes mask = load<Bytes>(group);
+
+            uint8_t* vx = &self.m_V[((op & 0x0F00) >> 8) * stride + lane];
+            uint8_t* vf = &self.m_V[0xF * stride + lane];
+            const Bytes valX = load<Bytes>(vx);
+            const Bytes valY = load<Bytes>(&self.m_V[((op & 0xF0) >> 4) * stride + lane]);
+
+            const uint8_t nn = op & 0xFF;
+            const uint16_t nnn = op & 0xFFF;
+
+            constexpr Quirks quirks = Profile::k_quirks;
+
+            // lanes skipping the next instruction
+            uint8_t skip[k_block] {};
+
+            switch (op & 0xF000)
+            {
+            case 0x0:
+                if (op == 0x00E0)
+                {
+                    for (size_t i = 0; i < k_block; i++)
+                        if (group[i])
+                            self.m_displays[lane + i].clear();
+                }
+                else if (op == 0x00EE)
+                    update(&self.m_stackDepth[lane], mask, Bytes{} + static_cast<uint8_t>(depth - 1));
+                break;
+
+            case 0x2000:
+                for (size_t half = 0; half < k_block; half += k_half)
+                    update(&self.m_callStack[depth * stride + lane + half], widenHalf(group + half), load<Words>(&self.m_PC[lane + half]));
+                update(&self.m_stackDepth[lane], mask, Bytes{} + static_cast<uint8_t>(depth + 1));
+
+                for (size_t i = 0; i < k_block; i++)
+                    if (group[i])
+                        self.m_counters[lane + i].stackHighWater = std::max<uint8_t>(self.m_counters[lane + i].stackHighWater, depth + 1);
+                break;
+
+            case 0x3000:
+                store(skip, valX == nn);
+                break;
+
+            case 0x4000:
+                store(skip, valX != nn);
+                break;
+
+            case 0x5000:
+                store(skip, valX == valY);
+                break;
+
+            case 0x6000:
+                update(vx, mask, Bytes{} + nn);
+                break;
+
+            case 0x7000:
+                update(vx, mask, valX + nn);
+                break;
+
+            case 0x8000:
+                // the result first, then VF, as Vx may be VF
+                switch (op & 0xF)
+                {
+                case 0x0:
+                    update(vx, mask, valY);
+                    break;
+
+                case 0x1:
+                case 0x2:
+                case 0x3:
+                    update(vx, mask, (op & 0xF) == 0x1 ? valX | valY : (op & 0xF) == 0x2 ? valX & valY : valX ^ valY);
+                    if constexpr (quirks.logicResetsVf)
+                        update(vf, mask, Bytes{});
+                    break;
+
+                case 0x4:
+                    {
+                    const Bytes sum = valX + valY;
+                    update(vx, mask, sum);
+                    update(vf, mask, reinterpret_cast<Bytes>(sum < valX) & 1);
+                    }
+                    break;
+
+                case 0x5:
+                    update(vx, mask, valX - valY);
+                    update(vf, mask, reinterpret_cast<Bytes>(valX > valY) & 1);
+                    break;
+
+                case 0x6:
+                    {
+                    const Bytes shifted = quirks.shiftUsesVy ? valY : valX;
+                    update(vx, mask, shifted >> 1);
+                    update(vf, mask, shifted & 1);
+                    }
+                    break;
+
+                case 0x7:
+                    update(vx, mask, valY - valX);
+                    update(vf, mask, reinterpret_cast<Bytes>(valY > valX) & 1);
+                    break;
+
+                case 0xE:
+                    {
+                    const Bytes shifted = quirks.shiftUsesVy ? valY : valX;
+                    update(vx, mask, shifted << 1);
+                    update(vf, mask, shifted >> 7);
+                    }
+                    break;
+
+                default:
+                    break;
+                }
+                break;
+
+            case 0x9000:
+                store(skip, valX != valY);
+                break;
+
+            case 0xA000:
+                for (size_t half = 0; half < k_block; half += k_half)
+                    update(&self.m_I[lane + half], widenHalf(group + half), Words{} + nnn);
+                break;
+
+            case 0xC000:
+                for (size_t quarter = 0; quarter < k_block; quarter += k_quarter)
+                {
+                    Longs random = load<Longs>(&self.m_random[lane + quarter]);
+                    random ^= random << 13;
+                    random ^= random >> 17;
+                    random ^= random << 5;
+                    update(&self.m_random[lane + quarter], widenQuarter(group + quarter), random);
+                }
+
+                for (size_t i = 0; i < k_block; i++)
+                    if (group[i])
+                        vx[i] = nn & self.m_random[lane + i];
+                break;
+
+            case 0xD000:
+                {
+                const uint8_t n = op & 0xF;
+                const uint8_t size = self.m_displays[lane].spriteSize(n);
+
+                // each lane draws on a display of its own, from its own memory
+                for (size_t i = 0; i < k_block; i++)
+                {
+                    if (!group[i])
+                        continue;
+
+                    // lanes that drew this frame wait for the next, executing this again
+                    if constexpr (quirks.displayWait)
+                    {
+                        if (self.m_isFrameDrawn[lane + i])
+                        {
+                            skip[i] = 0xFF;
+                            continue;
+                        }
+                        self.m_isFrameDrawn[lane + i] = true;
+                    }
+
+                    uint8_t sprite[Display::k_maxSpriteSize];
+                    for (uint8_t row = 0; row < size; row++)
+                        sprite[row] = self.m_ram[(I + row) * stride + lane + i];
+
+                    const bool collided = self.m_displays[lane + i].template attachSprite<quirks.spritesWrap>(sprite, n, valX[i], valY[i]);
+                    vf[i] = collided;
+                    self.m_counters[lane + i].draws++;
+                    self.m_counters[lane + i].collisions += collided;
+                }
+                }
+                break;
+
+            case 0xE000:
+                // shifts by a count per lane, which vector units lack for bytes
+                for (size_t i = 0; i < k_block; i++)
+                {
+                    const bool pressed = (self.m_keys[lane + i] >> (vx[i] & 0xF)) & 1;
+                    skip[i] = (op & 0xFF) == 0x9E ? -pressed : (op & 0xFF) == 0xA1 ? -!pressed : 0;
+                }
+                break;
+
+            case 0xF000:
+                switch (op & 0xFF)
+                {
+                case 0x07:
+                    update(vx, mask, load<Bytes>(&self.m_delayTimer[lane]));
+                    break;
+
+                case 0x0A:
+                    // lanes without a key held wait, executing this again
+                    for (size_t i = 0; i < k_block; i++)
+                    {
+                        const uint16_t keys = self.m_keys[lane + i];
+                        if (group[i] && keys)
+                            vx[i] = __builtin_ctz(keys);
+                        skip[i] = keys ? 0 : 0xFF;
+                    }
+                    break;
+
+                case 0x15:
+                    update(&self.m_delayTimer[lane], mask, valX);
+                    break;
+
+                case 0x18:
+                    update(&self.m_soundTimer[lane], mask, valX);
+                    break;
+
+                case 0x1E:
+                    for (size_t half = 0; half < k_block; half += k_half)
+                        update(&self.m_I[lane + half], widenHalf(group + half), load<Words>(&self.m_I[lane + half]) + zeroExtend(vx + half));
+                    break;
+
+                case 0x29:
+                    for (size_t half = 0; half < k_block; half += k_half)
+                        update(&self.m_I[lane + half], widenHalf(group + half),
+                               Memory::c_fontStartAddr + (zeroExtend(vx + half) & 0xF) * static_cast<uint16_t>(fonts::k_glyphSize));
+                    break;
+
+                case 0x55:
+                    for (uint8_t i = 0; i <= (op & 0x0F00) >> 8; i++)
+                        update(&self.m_ram[(I + i) * stride + lane], mask, load<Bytes>(&self.m_V[i * stride + lane]));
+                    break;
+
+                case 0x65:
+                    for (uint8_t i = 0; i <= (op & 0x0F00) >> 8; i++)
+                        update(&self.m_V[i * stride + lane], mask, load<Bytes>(&self.m_ram[(I + i) * stride + lane]));
+                    break;
+                }
+
+                // the lanes share I, see isCommonI()
+                if constexpr (quirks.loadStoreIncrementsI)
+                {
+                    if ((op & 0xFF) == 0x55 || (op & 0xFF) == 0x65)
+                        for (size_t half = 0; half < k_block; half += k_half)
+                            update(&self.m_I[lane + half], widenHalf(group + half), Words{} + static_cast<uint16_t>(I + ((op & 0x0F00) >> 8) + 1));
+                }
+                break;
+            }
+
+            for (size_t half = 0; half < k_block; half += k_half)
+            {
+                uint16_t* pc = &self.m_PC[lane + half];
+                Words next;
+
+                switch (op & 0xF000)
+                {
+                case 0x0:
+                    if (op == 0x00EE)
+                        next = load<Words>(&self.m_callStack[(depth - 1) * stride + lane + half]) + 2;
+                    else
+                        next = load<Words>(pc) + 2;
+                    break;
+
+                case 0x1000:
+                case 0x2000:
+                    next = Words{} + nnn;
+                    break;
+
+                case 0xB000:
+                    next = nnn + zeroExtend(&self.m_V[(quirks.jumpUsesVx ? (op & 0x0F00) >> 8 : 0x0) * stride + lane + half]);
+                    break;
+
+                case 0xD000:
+                case 0xF000:
+                    // skip holds the lanes waiting for a frame or a key
+                    next = load<Words>(pc) + (~widenHalf(skip + half) & 2);
+                    break;
+
+                default:
+                    next = load<Words>(pc) + 2 + (widenHalf(skip + half) & 2);
+                    break;
+                }
+
+                update(pc, widenHalf(group + half), next);
+            }
+        }
+    };
+
+    namespace
+    {
+        template <typename Profile>
+        void runPortable(BatchEngine& self, uint64_t instructions)
+        {
+            BatchKernels<Profile>::run(self, instructions);
+        }
+
+#ifdef BATCH_HAVE_X86_KERNELS
+        template <typename Profile>
+        __attribute__((target("avx2")))
+        void runAvx2(BatchEngine& self, uint64_t instructions)
+        {
+            BatchKernels<Profile>::run(self, instructions);
+        }
+#endif
+    }
+
+
+    BatchEngine::BatchEngine(const uint8_t* rom, size_t size, size_t lanes, Platform platform)
+        :   m_lanes(lanes),
+            m_stride((lanes + k_laneBlock - 1) / k_laneBlock * k_laneBlock),
+            m_V(16 * m_stride),
+            m_I(m_stride),
+            m_PC(m_stride, Memory::romStartAddress()),
+            m_delayTimer(m_stride),
+            m_soundTimer(m_stride),
+            m_callStack(Cpu::k_stackSize * m_stride),
+            m_stackDepth(m_stride),
+            m_random(m_stride, Interpreter::k_randomSeed),
+            m_ram(k_memorySize * m_stride),
+            m_keys(m_stride),
+            m_isFrameDrawn(m_stride),
+            m_running(m_stride),
+            m_runningLanes(lanes),
+            m_pending(m_stride),
+            m_group(m_stride),
+            m_displays(lanes),
+            m_counters(lanes),
+            m_errors(lanes),
+            m_stoppedAt(lanes)
+    {
+        if (lanes == 0)
+            throw std::runtime_error("ERROR: A batch needs at least one lane");
+
+        if (platform == Platform::XoChip)
+            throw std::runtime_error("ERROR: A batch does not run XO-CHIP roms");
+
+        // font and rom where a single machine has them
+        const Memory memory{rom, size, platform};
+        Memory::Ram ram;
+        memory.copyTo(ram);
+
+        for (uint32_t addr = 0; addr < k_memorySize; addr++)
+            std::fill_n(&m_ram[addr * m_stride], m_lanes, ram[addr]);
+
+        for (Display& display : m_displays)
+            display.reset(platform);
+
+        std::fill_n(m_running.begin(), m_lanes, 0xFF);
+
+        visitProfile(platform, [this](auto profile)
+        {
+            using Profile = decltype(profile);
+
+            if constexpr (!Profile::k_isXoChip)
+            {
+                m_run = &runPortable<Profile>;
+#ifdef BATCH_HAVE_X86_KERNELS
+                if (__builtin_cpu_supports("avx2"))
+                    m_run = &runAvx2<Profile>;
+#endif
+            }
+        });
+    }
+
+    void BatchEngine::decrementTimers()
+    {
+        // stopped lanes keep theirs, as a machine that faulted is not ticked any more
+        for (size_t lane = 0; lane < m_stride; lane++)
+        {
+            m_delayTimer[lane] -= m_delayTimer[lane] > 0 && m_running[lane];
+            m_soundTimer[lane] -= m_soundTimer[lane] > 0 && m_running[lane];
+            m_isFrameDrawn[lane] &= !m_running[lane];
+        }
+    }
+
+    void BatchEngine::save(size_t lane, Snapshot& snapshot) const
+    {
+        snapshot.ram.resize(k_memorySize);
+        for (uint32_t addr = 0; addr < k_memorySize; addr++)
+            snapshot.ram[addr] = m_ram[addr * m_stride + lane];
+
+        for (uint8_t r = 0; r < snapshot.cpu.registers.size(); r++)
+            snapshot.cpu.registers[r] = m_V[r * m_stride + lane];
+        snapshot.cpu.I = m_I[lane];
+        snapshot.cpu.PC = m_PC[lane];
+        snapshot.cpu.delayTimer = m_delayTimer[lane];
+        snapshot.cpu.soundTimer = m_soundTimer[lane];
+        for (uint8_t depth = 0; depth < Cpu::k_stackSize; depth++)
+            snapshot.cpu.callStack[depth] = m_callStack[depth * m_stride + lane];
+        snapshot.cpu.stackDepth = m_stackDepth[lane];
+
+        snapshot.screen = m_displays[lane].screenBuffer();
+        snapshot.displayMode = m_displays[lane].mode();
+        snapshot.isFrameDrawn = m_isFrameDrawn[lane];
+        snapshot.random = m_random[lane];
+        snapshot.instructions = m_running[lane] ? m_instructions : m_stoppedAt[lane];
+        snapshot.counters = m_counters[lane];
+    }
+
+    template <typename Profile>
+    void BatchEngine::executeLane(size_t lane, int32_t op)
+    {
+        try
+        {
+            execute<Profile>(lane, op < 0 ? fetch(lane) : op);
+        }
+        catch (const std::runtime_error& e)
+        {
+            stop(lane, e.what());
+        }
+    }
+
+    void BatchEngine::stop(size_t lane, const char* error)
+    {
+        m_running[lane] = 0;
+        m_runningLanes--;
+        m_errors[lane] = error;
+        m_stoppedAt[lane] = m_instructions;
+
+        while (m_firstRunning < m_lanes && !m_running[m_firstRunning])
+            m_firstRunning++;
+    }
+
+    template <typename Profile>
+    void BatchEngine::execute(size_t lane, uint16_t op)
+    {
+        constexpr Quirks quirks = Profile::k_quirks;
+
+        bool shallInc = true;
+
+        uint16_t& pc = m_PC[lane];
+        uint16_t& I = m_I[lane];
+        uint8_t& depth = m_stackDepth[lane];
+        uint8_t& vx = reg(lane, (op & 0x0F00) >> 8);
+        const uint8_t x = (op & 0x0F00) >> 8;
+        const uint8_t valX = vx;
+        const uint8_t valY = reg(lane, (op & 0xF0) >> 4);
+
+        switch (op & 0xF000)
+        {
+        case 0x0:
+            switch (op)
+            {
+            case 0xE0:
+                m_displays[lane].clear();
+                break;
+
+            case 0xEE:
+                if (depth == 0)
+                    throw std::runtime_error("ERROR: Return with an empty call stack");
+                pc = m_callStack[--depth * m_stride + lane];
+                break;
+
+            case 0xFB:
+            case 0xFC:
+                if constexpr (Profile::k_hasHires)
+                    m_displays[lane].scroll(op == 0xFB ? 4 : -4, 0);
+                break;
+
+            case 0xFE:
+            case 0xFF:
+                if constexpr (Profile::k_hasHires)
+                    m_displays[lane].setLowRes(op == 0xFE);
+                break;
+
+            default:
+                if (Profile::k_hasHires && (op & 0xFFF0) == 0xC0)
+                    m_displays[lane].scroll(0, op & 0xF);
+                break;
+            }
+            break;
+
+        case 0x1000:
+            pc = op & 0x0FFF;
+            shallInc = false;
+            break;
+
+        case 0x2000:
+            if (depth == Cpu::k_stackSize)
+                throw std::runtime_error("ERROR: Call stack overflow");
+            m_callStack[depth++ * m_stride + lane] = pc;
+            pc = op & 0x0FFF;
+            m_counters[lane].stackHighWater = std::max(m_counters[lane].stackHighWater, depth);
+            shallInc = false;
+            break;
+
+        case 0x3000:
+            if (valX == (op & 0xFF))
+                pc += 2;
+            break;
+
+        case 0x4000:
+            if (valX != (op & 0xFF))
+                pc += 2;
+            break;
+
+        case 0x5000:
+            if (valX == valY)
+                pc += 2;
+            break;
+
+        case 0x6000:
+            vx = op & 0xFF;
+            break;
+
+        case 0x7000:
+            vx = valX + (op & 0xFF);
+            break;
+
+        case 0x8000:
+            {
+            uint8_t& vf = reg(lane, 0xF);
+
+            switch (op & 0xF)
+            {
+            case 0x0:
+                vx = valY;
+                break;
+
+            case 0x1:
+                vx = valX | valY;
+                if constexpr (quirks.logicResetsVf)
+                    vf = 0;
+                break;
+
+            case 0x2:
+                vx = valX & valY;
+                if constexpr (quirks.logicResetsVf)
+                    vf = 0;
+                break;
+
+            case 0x3:
+                vx = valX ^ valY;
+                if constexpr (quirks.logicResetsVf)
+                    vf = 0;
+                break;
+
+            case 0x4:
+                vx = valX + valY;
+                vf = valX + valY > 255;
+                break;
+
+            case 0x5:
+                vx = valX - valY;
+                vf = valX > valY;
+                break;
+
+            case 0x6:
+                {
+                const uint8_t shifted = quirks.shiftUsesVy ? valY : valX;
+                vx = shifted >> 1;
+                vf = shifted & 1;
+                }
+                break;
+
+            case 0x7:
+                vx = valY - valX;
+                vf = valY > valX;
+                break;
+
+            case 0xE:
+                {
+                const uint8_t shifted = quirks.shiftUsesVy ? valY : valX;
+                vx = shifted << 1;
+                vf = shifted >> 7;
+                }
+                break;
+
+            default:
+                break;
+            }
+            }
+            break;
+
+        case 0x9000:
+            if (valX != valY)
+                pc += 2;
+            break;
+
+        case 0xA000:
+            I = op & 0xFFF;
+            break;
+
+        case 0xB000:
+            pc = (op & 0xFFF) + reg(lane, quirks.jumpUsesVx ? x : 0x0);
+            shallInc = false;
+            break;
+
+        case 0xC000:
+            {
+            uint32_t& random = m_random[lane];
+            random ^= random << 13;
+            random ^= random >> 17;
+            random ^= random << 5;
+            vx = (op & 0xFF) & random;
+            }
+            break;
+
+        case 0xD000:
+            {
+            // waiting for the next frame executes this again
+            if constexpr (quirks.displayWait)
+            {
+                if (m_isFrameDrawn[lane])
+                {
+                    shallInc = false;
+                    break;
+                }
+                m_isFrameDrawn[lane] = true;
+            }
+
+            const uint8_t n = op & 0xF;
+            const uint8_t size = m_displays[lane].spriteSize(n);
+
+            uint8_t sprite[Display::k_maxSpriteSize] {};
+            for (uint16_t i = 0; i < size; i++)
+                sprite[i] = read(lane, I + i);
+
+            const bool collided = m_displays[lane].attachSprite<quirks.spritesWrap>(sprite, n, valX, valY);
+            reg(lane, 0xF) = collided;
+            m_counters[lane].draws++;
+            m_counters[lane].collisions += collided;
+            }
+            break;
+
+        case 0xE000:
+            switch (op & 0xFF)
+            {
+            case 0x9E:
+                checkValSize(valX, 4);      // as Keypad::isPressed() does
+                if ((m_keys[lane] >> valX) & 1)
+                    pc += 2;
+                break;
+
+            case 0xA1:
+                checkValSize(valX, 4);
+                if (!((m_keys[lane] >> valX) & 1))
+                    pc += 2;
+                break;
+
+            default:
+                break;
+            }
+            break;
+
+        case 0xF000:
+            switch (op & 0xFF)
+            {
+            case 0x07:
+                vx = m_delayTimer[lane];
+                break;
+
+            case 0x0A:
+                if (const uint16_t keys = m_keys[lane])
+                    vx = __builtin_ctz(keys);
+                else
+                    shallInc = false;
+                break;
+
+            case 0x15:
+                m_delayTimer[lane] = valX;
+                break;
+
+            case 0x18:
+                m_soundTimer[lane] = valX;
+                break;
+
+            case 0x1E:
+                I += valX;
+                break;
+
+            case 0x29:
+                I = chip8::Memory::c_fontStartAddr + (valX & 0xF) * fonts::k_glyphSize;
+                break;
+
+            case 0x33:
+                write(lane, I, valX / 100);
+                write(lane, I + 1, (valX % 100) / 10);
+                write(lane, I + 2, valX % 10);
+                break;
+
+            case 0x55:
+                for (uint8_t i = 0; i <= x; i++)
+                    write(lane, I + i, reg(lane, i));
+                if constexpr (quirks.loadStoreIncrementsI)
+                    I += x + 1;
+                break;
+
+            case 0x65:
+                for (uint8_t i = 0; i <= x; i++)
+                    reg(lane, i) = read(lane, I + i);
+                if constexpr (quirks.loadStoreIncrementsI)
+                    I += x + 1;
+                break;
+
+            default:
+                break;
+            }
+            break;
+
+        default:
+            break;
+        }
+
+        if (shallInc)
+            pc += 2;
+    }
+}
@@ -0,0 +1,193 @@
+#ifndef BATCH_H
+#define BATCH_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include <string>
+#include <vector>
+
+#include "chip8.h"
+#include "interpreter.h"
+
+namespace chip8
+{
+    /**
+     * Runs one rom on many machines side by side, a lane per machine, e.g.
+     * to sweep random seeds or key schedules.
+     *
+     * The machine state is kept as structure of arrays, a register, timer or
+     * memory byte of every lane next to the same one of the others. Each
+     * step the lanes about to execute the same instruction are gathered, and
+     * for them arithmetic, loads, skips, jumps, calls and returns, timers
+     * and the random generator are done a whole block of lanes at once with
+     * vector code, AVX2 where the cpu has it. Lanes drawing a sprite from
+     * the same address read it as rows of memory, each then drawing on its
+     * own display. Everything else is executed lane by lane, as are the
+     * lanes left once the instructions of a step are spread over too many
+     * places to be worth gathering. Lanes an instruction cannot have split
+     * up are not gathered again for the next.
+     *
+     * Each lane does exactly what an Interpreter without key wait would,
+     * quirks included, the kernels being specialized on the QuirkProfile of
+     * the platform. A lane running into a rom fault stops in the state the
+     * fault left it in, the others go on.
+    **/
+    class BatchEngine
+    {
+    public:
+        // lanes are kept in blocks of this many, the width of the vector code
+        static constexpr size_t k_laneBlock = 32;
+
+        /**
+         * @param rom, size the rom image, loaded into every lane
+         * @param lanes no. of machines
+         * @param platform the rom was written for, see detectPlatform()
+         * @throws runtime_error
+         *  if size > Memory::maxRomSize(platform), lanes is 0 or platform is XO-CHIP
+        **/
+        BatchEngine(const uint8_t* rom, size_t size, size_t lanes, Platform platform = Platform::CosmacVip);
+
+        BatchEngine(const BatchEngine&) = delete;
+        BatchEngine& operator=(const BatchEngine&) = delete;
+
+        size_t lanes() const { return m_lanes; }
+
+        /**
+         * @param state of the generator Cxnn draws from, not 0,
+         *  Interpreter::k_randomSeed unless set
+        **/
+        void setRandomState(size_t lane, uint32_t state) { m_random[lane] = state; }
+
+        /**
+         * @param keys held, bit n for key n, see Keypad
+        **/
+        void setKeys(size_t lane, uint16_t keys) { m_keys[lane] = keys; }
+
+        /**
+         * executes the next instructions instructions on every lane still
+         * running, returning early once none is
+        **/
+        void run(uint64_t instructions) { m_run(*this, instructions); }
+
+        void decrementTimers();
+
+        /**
+         * @returns no. of instructions the lanes still running executed
+        **/
+        uint64_t instructions() const { return m_instructions; }
+
+        /**
+         * @returns no. of those all running lanes executed at once
+        **/
+        uint64_t uniformInstructions() const { return m_uniformInstructions; }
+
+        /**
+         * @returns false once the lane ran into a rom fault, see error()
+        **/
+        bool isRunning(size_t lane) const { return m_running[lane]; }
+
+        const std::string& error(size_t lane) const { return m_errors[lane]; }
+
+        /**
+         * copies the lane's machine state into snapshot, as Interpreter::save()
+         * would. allocates nothing once snapshot held a state of this batch.
+        **/
+        void save(size_t lane, Snapshot& snapshot) const;
+
+    private:
+        template <typename Profile> friend struct BatchKernels;
+
+        // the lanes run no XO-CHIP roms, those would need 16 times the memory
+        static constexpr uint32_t k_memorySize = Memory::sizeFor(Platform::CosmacVip);
+
+        size_t m_lanes;
+        size_t m_stride;                    // m_lanes rounded up to whole blocks
+
+        // field f of lane l at f * m_stride + l
+        std::vector<uint8_t> m_V;           // 16 fields, one per register
+        std::vector<uint16_t> m_I;
+        std::vector<uint16_t> m_PC;
+        std::vector<uint8_t> m_delayTimer;
+        std::vector<uint8_t> m_soundTimer;
+        std::vector<uint16_t> m_callStack;  // Cpu::k_stackSize fields
+        std::vector<uint8_t> m_stackDepth;
+        std::vector<uint32_t> m_random;
+        std::vector<uint8_t> m_ram;         // k_memorySize fields, one per address
+        std::vector<uint16_t> m_keys;
+        std::vector<uint8_t> m_isFrameDrawn;    // see Quirks::displayWait
+
+        // 0xFF while running, the padding lanes of the last block never are
+        std::vector<uint8_t> m_running;
+        size_t m_runningLanes;
+        size_t m_firstRunning {};           // m_lanes once none is
+        bool m_isUniform { true };          // every running lane at the same PC, as all start
+
+        // per step, 0xFF for the lanes still to execute and those executing together
+        std::vector<uint8_t> m_pending;
+        std::vector<uint8_t> m_group;
+
+        std::vector<chip8::Display> m_displays;
+        std::vector<Counters> m_counters;
+        std::vector<std::string> m_errors;
+        std::vector<uint64_t> m_stoppedAt;  // instructions() when the lane stopped
+
+        uint64_t m_instructions {};
+        uint64_t m_uniformInstructions {};
+
+        // run(), the vector code the cpu supports specialized on the quirk profile, see batch.cpp
+        void (*m_run)(BatchEngine& self, uint64_t instructions);
+
+        /**
+         * @returns the instruction at the lane's PC
+         * @throws runtime_error as Interpreter::fetch() does
+        **/
+        uint16_t fetch(size_t lane) const
+        {
+            const uint16_t pc = m_PC[lane];
+            checkAddr(pc + 1);
+            return (m_ram[pc * m_stride + lane] << 8) | m_ram[(pc + 1) * m_stride + lane];
+        }
+
+        /**
+         * executes op on lane, as Interpreter::execute() does
+         * @throws runtime_error on a rom fault, leaving the lane as the fault left it
+        **/
+        template <typename Profile>
+        void execute(size_t lane, uint16_t op);
+
+        /**
+         * executes op, or the lane's own instruction if op < 0, stopping the
+         * lane if it faults
+        **/
+        template <typename Profile>
+        void executeLane(size_t lane, int32_t op);
+
+        void stop(size_t lane, const char* error);
+
+        uint8_t& reg(size_t lane, uint8_t r) { return m_V[r * m_stride + lane]; }
+
+        uint8_t read(size_t lane, uint16_t addr) const
+        {
+            checkAddr(addr);
+            return m_ram[addr * m_stride + lane];
+        }
+
+        void write(size_t lane, uint16_t addr, uint8_t val)
+        {
+            checkAddr(addr);
+            m_ram[addr * m_stride + lane] = val;
+        }
+
+        /**
+         * @throws runtime_error as Memory::read() and Memory::write() do
+        **/
+        static void checkAddr(uint32_t addr)
+        {
+            if (addr >= k_memorySize)
+                throw std::runtime_error("ERROR: Attempted to access invalid memory address on host");
+        }
+    };
+}
+
+#endif /* BATCH_H */
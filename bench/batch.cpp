@@ -0,0 +1,199 @@
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "../batch.h"
+#include "../interpreter.h"
+#include "../rom.h"
+#include "../tableengine.h"
+
+/**
+ * Runs every rom below a directory on a BatchEngine and on as many
+ * interpreters, a seed sweep: every lane draws other random numbers, the
+ * keys pressed are the same. Checks every lane ended as its interpreter did
+ * and prints how long an instruction takes either way. The timers tick every
+ * k_instructionsPerFrame instructions, as in the window.
+ *
+ * usage: batch [rom directory] [lanes] [frames per rom] [platform]
+ *  the platform, see chip8::c_platformKeys, runs every rom on it instead of the one detected
+**/
+
+namespace
+{
+    constexpr uint32_t k_instructionsPerFrame = 15;
+
+    // the keys are pressed for this many frames, then the next one
+    constexpr uint64_t k_framesPerKey = 20;
+
+    uint32_t seedFor(size_t lane)
+    {
+        const uint32_t seed = chip8::Interpreter::k_randomSeed + lane * 0x9E3779B9u;
+        return seed ? seed : chip8::Interpreter::k_randomSeed;
+    }
+
+    /**
+     * @returns the keys held in frame, none every other time so Fx0A waits
+    **/
+    uint16_t keysFor(uint64_t frame)
+    {
+        const uint64_t press = frame / k_framesPerKey;
+        return press % 2 ? 0 : 1 << (press / 2 % 16);
+    }
+
+    struct Lane
+    {
+        chip8::Snapshot state;
+        std::string error;
+    };
+
+    /**
+     * @returns how long an instruction took on interpreters, one lane after another
+    **/
+    double runInterpreters(const uint8_t* rom, size_t size, chip8::Platform platform, uint64_t frames, std::vector<Lane>& lanes)
+    {
+        std::chrono::nanoseconds took {};
+        uint64_t ran = 0;
+
+        for (size_t index = 0; index < lanes.size(); index++)
+        {
+            chip8::Interpreter interpreter{rom, size, platform};
+
+            chip8::Snapshot seeded;
+            interpreter.save(seeded);
+            seeded.random = seedFor(index);
+            interpreter.restore(seeded);
+
+            const std::chrono::time_point<std::chrono::steady_clock> start = std::chrono::steady_clock::now();
+            try
+            {
+                for (uint64_t frame = 0; frame < frames; frame++)
+                {
+                    interpreter.keypad()->setKeys(keysFor(frame));
+                    chip8::TableEngine::run(interpreter, k_instructionsPerFrame);
+                    interpreter.decrementTimers();
+                }
+            }
+            catch (const std::exception& e)
+            {
+                lanes[index].error = e.what();
+            }
+            took += std::chrono::steady_clock::now() - start;
+
+            ran += interpreter.instructions();
+            interpreter.save(lanes[index].state);
+        }
+
+        return ran ? took.count() / double(ran) : 0;
+    }
+
+    /**
+     * @returns how long an instruction of a lane took on the batch
+    **/
+    double runBatch(chip8::BatchEngine& batch, uint64_t frames)
+    {
+        for (size_t lane = 0; lane < batch.lanes(); lane++)
+            batch.setRandomState(lane, seedFor(lane));
+
+        const std::chrono::time_point<std::chrono::steady_clock> start = std::chrono::steady_clock::now();
+        for (uint64_t frame = 0; frame < frames; frame++)
+        {
+            for (size_t lane = 0; lane < batch.lanes(); lane++)
+                batch.setKeys(lane, keysFor(frame));
+
+            batch.run(k_instructionsPerFrame);
+            batch.decrementTimers();
+        }
+        const std::chrono::nanoseconds took = std::chrono::steady_clock::now() - start;
+
+        chip8::Snapshot state;
+        uint64_t ran = 0;
+        for (size_t lane = 0; lane < batch.lanes(); lane++)
+        {
+            batch.save(lane, state);
+            ran += state.instructions;
+        }
+
+        return ran ? took.count() / double(ran) : 0;
+    }
+
+    bool operator==(const chip8::Snapshot& a, const chip8::Snapshot& b)
+    {
+        return a.ram == b.ram && a.screen == b.screen &&
+               a.cpu.registers == b.cpu.registers && a.cpu.I == b.cpu.I && a.cpu.PC == b.cpu.PC &&
+               a.cpu.delayTimer == b.cpu.delayTimer && a.cpu.soundTimer == b.cpu.soundTimer &&
+               a.cpu.stackDepth == b.cpu.stackDepth && a.cpu.callStack == b.cpu.callStack &&
+               a.random == b.random && a.instructions == b.instructions &&
+               a.counters.draws == b.counters.draws && a.counters.collisions == b.counters.collisions &&
+               a.counters.stackHighWater == b.counters.stackHighWater;
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    const std::string directory = argc > 1 ? argv[1] : "roms";
+    const size_t lanes = argc > 2 ? std::stoull(argv[2]) : 64;
+    const uint64_t frames = argc > 3 ? std::stoull(argv[3]) : 20'000;
+
+    std::optional<chip8::Platform> platform;
+    if (argc > 4)
+    {
+        chip8::Platform chosen;
+        if (!chip8::platformFromKey(argv[4], chosen))
+        {
+            std::cerr << "the platform is one of " << chip8::c_platformKeys << '\n';
+            return 2;
+        }
+        platform = chosen;
+    }
+
+    const chip8::RomCatalog catalog{directory, nullptr, platform};
+
+    std::cout << "ns per instruction and lane, " << lanes << " lanes, " << frames << " frames per rom\n"
+              << std::setw(12) << "interpreter" << std::setw(12) << "batch"
+              << std::setw(10) << "speedup" << std::setw(10) << "uniform" << "  rom\n" << std::fixed << std::setprecision(2);
+
+    double interpreterTotal = 0, batchTotal = 0;
+    for (const chip8::RomCatalog::Entry& entry : catalog.entries())
+    {
+        if (entry.platform == chip8::Platform::XoChip)
+        {
+            std::cout << std::setw(44) << "XO-CHIP, skipped" << "  " << entry.path << '\n';
+            continue;
+        }
+
+        const uint8_t* rom = catalog.image(entry);
+        const size_t size = catalog.imageSize(entry);
+
+        std::vector<Lane> expected(lanes);
+        const double viaInterpreters = runInterpreters(rom, size, entry.platform, frames, expected);
+
+        chip8::BatchEngine batch{rom, size, lanes, entry.platform};
+        const double viaBatch = runBatch(batch, frames);
+
+        std::cout << std::setw(12) << viaInterpreters << std::setw(12) << viaBatch
+                  << std::setw(9) << viaInterpreters / viaBatch << "x"
+                  << std::setw(9) << 100.0 * batch.uniformInstructions() / std::max<uint64_t>(batch.instructions(), 1) << "%"
+                  << "  " << entry.path << '\n';
+
+        chip8::Snapshot state;
+        for (size_t lane = 0; lane < lanes; lane++)
+        {
+            batch.save(lane, state);
+            if (state == expected[lane].state && batch.error(lane) == expected[lane].error)
+                continue;
+
+            std::cout << "    lane " << lane << " ended in another state than its interpreter!\n";
+            return 1;
+        }
+
+        interpreterTotal += viaInterpreters;
+        batchTotal += viaBatch;
+    }
+
+    if (batchTotal > 0)
+        std::cout << "mean speedup of the batch " << interpreterTotal / batchTotal << "x\n";
+}
@@ -0,0 +1,140 @@
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <optional>
+#include <string>
+
+#include "../interpreter.h"
+#include "../rom.h"
+#include "../tableengine.h"
+
+/**
+ * Runs every rom below a directory with each dispatch and prints how long
+ * an instruction takes. No keys are held and the timers tick every
+ * k_instructionsPerFrame instructions, as in the window.
+ *
+ * usage: dispatch [rom directory] [instructions per rom] [platform]
+ *  the platform, see chip8::c_platformKeys, runs every rom on it instead of the one detected
+**/
+
+namespace
+{
+    constexpr uint32_t k_instructionsPerFrame = 15;
+
+    struct Result
+    {
+        double nsPerInstruction;
+        chip8::Snapshot state;      // after the run, to check the dispatches agree
+        std::string error;
+    };
+
+    enum class Dispatch
+    {
+        Switch,     // Interpreter::step() through execute()
+        Table,      // Interpreter::step() through TableEngine::step()
+        TableRun    // TableEngine::run() for a frame at once
+    };
+
+    Result measure(const uint8_t* rom, size_t size, chip8::Platform platform, uint64_t instructions, Dispatch dispatch)
+    {
+        chip8::Interpreter interpreter{rom, size, platform};
+        Result result {};
+
+        if (dispatch == Dispatch::Table)
+            interpreter.setEngine(chip8::Interpreter::Engine::Table);
+
+        const std::chrono::time_point<std::chrono::steady_clock> start = std::chrono::steady_clock::now();
+        uint64_t ran = 0;
+        try
+        {
+            for (; ran < instructions; ran += k_instructionsPerFrame)
+            {
+                if (dispatch == Dispatch::TableRun)
+                    chip8::TableEngine::run(interpreter, k_instructionsPerFrame);
+                else
+                    for (uint32_t i = 0; i < k_instructionsPerFrame; i++)
+                        interpreter.step();
+
+                interpreter.decrementTimers();
+            }
+        }
+        catch (const std::exception& e)
+        {
+            result.error = e.what();
+        }
+        const std::chrono::nanoseconds took = std::chrono::steady_clock::now() - start;
+
+        result.nsPerInstruction = ran ? took.count() / double(ran) : 0;
+        interpreter.save(result.state);
+
+        return result;
+    }
+
+    bool operator==(const chip8::Snapshot& a, const chip8::Snapshot& b)
+    {
+        return a.ram == b.ram && a.screen == b.screen &&
+               a.cpu.registers == b.cpu.registers && a.cpu.I == b.cpu.I && a.cpu.PC == b.cpu.PC &&
+               a.cpu.delayTimer == b.cpu.delayTimer && a.cpu.soundTimer == b.cpu.soundTimer &&
+               a.cpu.stackDepth == b.cpu.stackDepth && a.cpu.callStack == b.cpu.callStack &&
+               a.random == b.random && a.instructions == b.instructions &&
+               a.counters.draws == b.counters.draws && a.counters.collisions == b.counters.collisions &&
+               a.counters.stackHighWater == b.counters.stackHighWater;
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    const std::string directory = argc > 1 ? argv[1] : "roms";
+    const uint64_t instructions = argc > 2 ? std::stoull(argv[2]) : 50'000'000;
+
+    std::optional<chip8::Platform> platform;
+    if (argc > 3)
+    {
+        chip8::Platform chosen;
+        if (!chip8::platformFromKey(argv[3], chosen))
+        {
+            std::cerr << "the platform is one of " << chip8::c_platformKeys << '\n';
+            return 2;
+        }
+        platform = chosen;
+    }
+
+    const chip8::RomCatalog catalog{directory, nullptr, platform};
+
+    std::cout << "ns per instruction, " << instructions << " instructions per rom\n"
+              << std::setw(12) << "switch" << std::setw(12) << "table" << std::setw(12) << "table run"
+              << std::setw(10) << "speedup" << "  rom\n" << std::fixed << std::setprecision(2);
+
+    double switchTotal = 0, runTotal = 0;
+    for (const chip8::RomCatalog::Entry& entry : catalog.entries())
+    {
+        const uint8_t* rom = catalog.image(entry);
+        const size_t size = catalog.imageSize(entry);
+
+        const Result viaSwitch = measure(rom, size, entry.platform, instructions, Dispatch::Switch);
+        const Result viaTable = measure(rom, size, entry.platform, instructions, Dispatch::Table);
+        const Result viaRun = measure(rom, size, entry.platform, instructions, Dispatch::TableRun);
+
+        std::cout << std::setw(12) << viaSwitch.nsPerInstruction
+                  << std::setw(12) << viaTable.nsPerInstruction
+                  << std::setw(12) << viaRun.nsPerInstruction
+                  << std::setw(9) << viaSwitch.nsPerInstruction / viaRun.nsPerInstruction << "x"
+                  << "  " << entry.path << '\n';
+
+        if (!viaSwitch.error.empty())
+            std::cout << "    stopped early: " << viaSwitch.error << '\n';
+
+        if (viaSwitch.error != viaTable.error || viaSwitch.error != viaRun.error ||
+            !(viaSwitch.state == viaTable.state) || !(viaSwitch.state == viaRun.state))
+        {
+            std::cout << "    the dispatches ended in different states!\n";
+            return 1;
+        }
+
+        switchTotal += viaSwitch.nsPerInstruction;
+        runTotal += viaRun.nsPerInstruction;
+    }
+
+    if (runTotal > 0)
+        std::cout << "mean speedup of the table " << switchTotal / runTotal << "x\n";
+}
@@ -0,0 +1,365 @@
+#include "capture.h"
+
+#include <string.h>
+
+#include <array>
+#include <chrono>
+#include <fstream>
+#include <stdexcept>
+
+namespace emuGL
+{
+    /**
+     * Writes RGBA frames, made of only the foreground and background colors,
+     * to a video file.
+    **/
+    class FrameEncoder
+    {
+    public:
+        virtual ~FrameEncoder() {}
+
+        /**
+         * @param pixels as produced by FrameScaler::pixels()
+        **/
+        virtual void write(const uint32_t* pixels) = 0;
+
+        virtual void finish() {}
+
+    protected:
+        FrameEncoder(const std::string& path, int width, int height, uint32_t fps, uint32_t foreground)
+            :   m_file{path, std::ios::out | std::ios::binary},
+                m_width(width),
+                m_height(height),
+                m_fps(fps),
+                m_foreground(foreground)
+        {
+            if (!m_file.good())
+                throw std::runtime_error("ERROR: Unable to write video to " + path);
+        }
+
+        std::ofstream m_file;
+
+        int m_width;
+        int m_height;
+        uint32_t m_fps;
+        uint32_t m_foreground; // packed like FrameScaler::pixels()
+    };
+
+    namespace
+    {
+        /**
+         * uncompressed YUV 4:4:4, so both colors survive exactly
+        **/
+        class Y4mEncoder : public FrameEncoder
+        {
+        public:
+            Y4mEncoder(const std::string& path, int width, int height, uint32_t fps,
+                       uint32_t foreground, const Color& fg, const Color& bg)
+                :   FrameEncoder{path, width, height, fps, foreground},
+                    m_fgYuv(toYuv(fg)),
+                    m_bgYuv(toYuv(bg)),
+                    m_planes(static_cast<size_t>(width) * height * 3)
+            {
+                m_file << "YUV4MPEG2 W" << width << " H" << height << " F" << fps << ":1 Ip A1:1 C444\n";
+            }
+
+            void write(const uint32_t* pixels)
+            {
+                const size_t planeSize = static_cast<size_t>(m_width) * m_height;
+                uint8_t* y = m_planes.data();
+                uint8_t* u = y + planeSize;
+                uint8_t* v = u + planeSize;
+
+                for (size_t i = 0; i < planeSize; i++)
+                {
+                    const std::array<uint8_t, 3>& yuv = pixels[i] == m_foreground ? m_fgYuv : m_bgYuv;
+                    y[i] = yuv[0];
+                    u[i] = yuv[1];
+                    v[i] = yuv[2];
+                }
+
+                m_file << "FRAME\n";
+                m_file.write(reinterpret_cast<const char*>(m_planes.data()), m_planes.size());
+            }
+
+        private:
+            std::array<uint8_t, 3> m_fgYuv;
+            std::array<uint8_t, 3> m_bgYuv;
+            std::vector<uint8_t> m_planes;
+
+            // BT.601, limited range
+            static std::array<uint8_t, 3> toYuv(const Color& c)
+            {
+                const double r = c.red(), g = c.green(), b = c.blue();
+                return {
+                    static_cast<uint8_t>(16  + ( 65.481 * r + 128.553 * g +  24.966 * b) / 255 + 0.5),
+                    static_cast<uint8_t>(128 + (-37.797 * r -  74.203 * g + 112.000 * b) / 255 + 0.5),
+                    static_cast<uint8_t>(128 + (112.000 * r -  93.786 * g -  18.214 * b) / 255 + 0.5)
+                };
+            }
+        };
+
+        /**
+         * animated GIF with a 2 color palette.
+         * Runs of identical frames are merged into one, and frames that would
+         * be shown for less than the 2/100 s browsers honour are skipped.
+        **/
+        class GifEncoder : public FrameEncoder
+        {
+        public:
+            GifEncoder(const std::string& path, int width, int height, uint32_t fps,
+                       uint32_t foreground, const Color& fg, const Color& bg)
+                :   FrameEncoder{path, width, height, fps, foreground},
+                    m_pending(static_cast<size_t>(width) * height),
+                    m_next(static_cast<size_t>(width) * height)
+            {
+                m_file.write("GIF89a", 6);
+
+                // logical screen with a global color table of 2 entries
+                putShort(width);
+                putShort(height);
+                m_file.put(static_cast<char>(0x80));
+                m_file.put(0);
+                m_file.put(0);
+
+                const Color palette[2] { bg, fg };
+                for (const Color& c : palette)
+                {
+                    m_file.put(c.red());
+                    m_file.put(c.green());
+                    m_file.put(c.blue());
+                }
+
+                // loop forever
+                m_file.write("\x21\xFF\x0BNETSCAPE2.0\x03\x01\x00\x00\x00", 19);
+            }
+
+            void write(const uint32_t* pixels)
+            {
+                for (size_t i = 0; i < m_next.size(); i++)
+                    m_next[i] = pixels[i] == m_foreground;
+
+                const double frameTime = 100.0 / m_fps;
+
+                if (m_hasPending && m_next == m_pending)
+                {
+                    m_pendingTime += frameTime;
+                    return;
+                }
+
+                if (m_hasPending && m_pendingTime >= c_minDelay)
+                {
+                    writeImage(m_pending, m_pendingTime);
+                    m_pendingTime = 0;
+                }
+
+                // a pending frame shown too briefly is replaced, keeping its time
+                m_pending.swap(m_next);
+                m_pendingTime += frameTime;
+                m_hasPending = true;
+            }
+
+            void finish()
+            {
+                if (m_hasPending)
+                    writeImage(m_pending, m_pendingTime);
+
+                m_file.put(0x3B);
+            }
+
+        private:
+            inline static const double c_minDelay = 2; // in 1/100 s
+
+            std::vector<uint8_t> m_pending;
+            std::vector<uint8_t> m_next;
+            bool m_hasPending {};
+            double m_pendingTime {};
+            double m_timeError {};  // rounding carried over to the next delay
+
+            void putShort(uint16_t val)
+            {
+                m_file.put(val & 0xFF);
+                m_file.put(val >> 8);
+            }
+
+            void writeImage(const std::vector<uint8_t>& indices, double time)
+            {
+                const uint16_t delay = static_cast<uint16_t>(time + m_timeError + 0.5);
+                m_timeError += time - delay;
+
+                // graphic control extension
+                m_file.write("\x21\xF9\x04\x04", 4);
+                putShort(delay);
+                m_file.put(0);
+                m_file.put(0);
+
+                // image descriptor covering the whole screen
+                m_file.put(0x2C);
+                putShort(0);
+                putShort(0);
+                putShort(m_width);
+                putShort(m_height);
+                m_file.put(0);
+
+                const std::vector<uint8_t> data = lzw(indices);
+
+                m_file.put(c_minCodeSize);
+                for (size_t pos = 0; pos < data.size(); pos += 255)
+                {
+                    const size_t len = std::min<size_t>(255, data.size() - pos);
+                    m_file.put(static_cast<char>(len));
+                    m_file.write(reinterpret_cast<const char*>(data.data() + pos), len);
+                }
+                m_file.put(0);
+            }
+
+            inline static const int c_minCodeSize = 2; // smallest GIF allows
+            inline static const int c_clearCode = 1 << c_minCodeSize;
+            inline static const int c_maxCode = 4095;
+
+            std::vector< std::array<uint16_t, 1 << c_minCodeSize> > m_codeTree
+                { std::vector< std::array<uint16_t, 1 << c_minCodeSize> >(c_maxCode + 1) };
+
+            std::vector<uint8_t> lzw(const std::vector<uint8_t>& indices)
+            {
+                std::vector<uint8_t> out;
+                uint32_t bits = 0;
+                int bitCount = 0;
+                int codeSize = c_minCodeSize + 1;
+
+                auto emit = [&](int code)
+                {
+                    bits |= static_cast<uint32_t>(code) << bitCount;
+                    bitCount += codeSize;
+                    for (; bitCount >= 8; bitCount -= 8, bits >>= 8)
+                        out.push_back(bits & 0xFF);
+                };
+
+                auto clear = [&]()
+                {
+                    std::fill(m_codeTree.begin(), m_codeTree.end(), std::array<uint16_t, 1 << c_minCodeSize>{});
+                };
+
+                clear();
+                emit(c_clearCode);
+
+                int maxCode = c_clearCode + 1;
+                int code = indices[0];
+
+                for (size_t i = 1; i < indices.size(); i++)
+                {
+                    const uint8_t next = indices[i];
+                    if (m_codeTree[code][next])
+                    {
+                        code = m_codeTree[code][next];
+                        continue;
+                    }
+
+                    emit(code);
+                    m_codeTree[code][next] = ++maxCode;
+                    if (maxCode >= (1 << codeSize))
+                        codeSize++;
+
+                    if (maxCode == c_maxCode)
+                    {
+                        emit(c_clearCode);
+                        clear();
+                        codeSize = c_minCodeSize + 1;
+                        maxCode = c_clearCode + 1;
+                    }
+
+                    code = next;
+                }
+
+                emit(code);
+                emit(c_clearCode + 1);
+                if (bitCount > 0)
+                    out.push_back(bits & 0xFF);
+
+                return out;
+            }
+        };
+    }
+
+
+    VideoRecorder::VideoRecorder(const std::string& path, uint16_t width, uint16_t height, uint16_t scale,
+                                 const Color& foreground, const Color& background,
+                                 FullPolicy policy, uint32_t fps, size_t capacity)
+        :   m_height(height),
+            m_wordsPerRow((width + 63) / 64),
+            m_policy(policy),
+            m_capacity(capacity),
+            m_slots(capacity * m_wordsPerRow * height),
+            m_scaler{width, height, scale, foreground, background}
+    {
+        const uint32_t packedForeground = m_scaler.foreground();
+
+        const bool isGif = path.size() >= 4 && path.compare(path.size() - 4, 4, ".gif") == 0;
+        if (isGif)
+            m_encoder = new GifEncoder{path, m_scaler.width(), m_scaler.height(), fps, packedForeground, foreground, background};
+        else
+            m_encoder = new Y4mEncoder{path, m_scaler.width(), m_scaler.height(), fps, packedForeground, foreground, background};
+
+        m_worker = std::thread{&VideoRecorder::work, this};
+    }
+
+    VideoRecorder::~VideoRecorder()
+    {
+        m_isDone.store(true, std::memory_order_release);
+        m_worker.join();
+
+        m_encoder->finish();
+        delete m_encoder;
+    }
+
+    bool VideoRecorder::push(const uint64_t* rows, uint16_t wordsPerRow, uint8_t planes)
+    {
+        const size_t tail = m_tail.load(std::memory_order_relaxed);
+
+        while (tail - m_head.load(std::memory_order_acquire) == m_capacity)
+        {
+            if (m_policy == FullPolicy::Drop)
+            {
+                m_droppedFrames.fetch_add(1, std::memory_order_relaxed);
+                return false;
+            }
+
+            std::this_thread::yield();
+        }
+
+        uint64_t* slot = &m_slots[(tail % m_capacity) * m_wordsPerRow * m_height];
+        for (uint16_t y = 0; y < m_height; y++)
+            memcpy(slot + y * m_wordsPerRow, rows + y * wordsPerRow, m_wordsPerRow * sizeof(uint64_t));
+
+        for (uint8_t plane = 1; plane < planes; plane++)
+            for (uint16_t y = 0; y < m_height; y++)
+                for (uint16_t word = 0; word < m_wordsPerRow; word++)
+                    slot[y * m_wordsPerRow + word] |= rows[(plane * m_height + y) * wordsPerRow + word];
+
+        m_tail.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    void VideoRecorder::work()
+    {
+        while (true)
+        {
+            const size_t head = m_head.load(std::memory_order_relaxed);
+
+            if (head == m_tail.load(std::memory_order_acquire))
+            {
+                // push() may have queued a last frame right before setting done
+                if (m_isDone.load(std::memory_order_acquire) && head == m_tail.load(std::memory_order_acquire))
+                    return;
+
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+                continue;
+            }
+
+            m_scaler.scale(&m_slots[(head % m_capacity) * m_wordsPerRow * m_height], m_wordsPerRow);
+            m_encoder->write(m_scaler.pixels());
+
+            m_head.store(head + 1, std::memory_order_release);
+        }
+    }
+}
@@ -0,0 +1,85 @@
+#ifndef CAPTURE_H
+#define CAPTURE_H
+
+#include <stdint.h>
+
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "color.h"
+#include "scaler.h"
+
+namespace emuGL
+{
+    class FrameEncoder;
+
+    /**
+     * Records packed 1 bit per pixel frames, as kept by chip8::Display, to an
+     * uncompressed Y4M video or an animated GIF.
+     *
+     * The emulation thread only copies each frame into a bounded lock-free
+     * ring, palette expansion, scaling and encoding happen on a worker thread.
+    **/
+    class VideoRecorder
+    {
+    public:
+        /**
+         * what push() does when the worker falls behind and the ring is full
+        **/
+        enum class FullPolicy { Drop, Block };
+
+        /**
+         * @param path written as GIF if it ends in .gif and as Y4M otherwise
+         * @param width, height size of the recorded frames in pixels
+         * @param fps rate at which push() is called
+         * @throws runtime_error if path cannot be written
+        **/
+        VideoRecorder(const std::string& path, uint16_t width, uint16_t height, uint16_t scale,
+                      const Color& foreground, const Color& background,
+                      FullPolicy policy = FullPolicy::Drop, uint32_t fps = 60, size_t capacity = 256);
+
+        /**
+         * encodes the frames still queued and finishes the file
+        **/
+        ~VideoRecorder();
+
+        VideoRecorder(const VideoRecorder&) = delete;
+        VideoRecorder& operator=(const VideoRecorder&) = delete;
+
+        /**
+         * queues a frame, to be called by a single thread only
+         * @param rows height rows of wordsPerRow 64 bit words each
+         * @param planes no. of such frames following each other in rows,
+         *  recorded merged as the encoders have 2 colors only
+         * @returns false if the frame was dropped
+        **/
+        bool push(const uint64_t* rows, uint16_t wordsPerRow, uint8_t planes = 1);
+
+        uint64_t droppedFrames() const { return m_droppedFrames.load(std::memory_order_relaxed); }
+
+    private:
+        uint16_t m_height;
+        uint16_t m_wordsPerRow;
+        FullPolicy m_policy;
+
+        // single producer, single consumer ring of packed frames
+        size_t m_capacity;
+        std::vector<uint64_t> m_slots;
+        std::atomic<size_t> m_head {};  // next frame to encode, advanced by the worker
+        std::atomic<size_t> m_tail {};  // next free slot, advanced by push()
+
+        std::atomic<uint64_t> m_droppedFrames {};
+        std::atomic<bool> m_isDone {};
+
+        FrameScaler m_scaler;
+        FrameEncoder* m_encoder {};
+
+        std::thread m_worker;
+
+        void work();
+    };
+}
+
+#endif /* CAPTURE_H */
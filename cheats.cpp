@@ -0,0 +1,155 @@
+#include "cheats.h"
+
+#include <string.h>
+
+#include <iomanip>
+
+namespace chip8
+{
+    namespace
+    {
+        // 16 bytes of memory, in GCC's vector extensions so the compares
+        // compile to whatever vector unit the target has, SSE2 at least on
+        // x86-64. comparisons give masks, all bits of a byte set where true.
+        constexpr size_t k_vectorSize = 16;
+
+        typedef uint8_t Bytes __attribute__((vector_size(k_vectorSize)));
+        typedef int8_t Mask __attribute__((vector_size(k_vectorSize)));
+
+        static_assert(Memory::k_pageSize % k_vectorSize == 0, "the memory is compared a vector at a time");
+
+        Bytes load(const uint8_t* at)
+        {
+            Bytes vector;
+            memcpy(&vector, at, sizeof(vector));
+            return vector;
+        }
+
+        /**
+         * @returns the mask of the bytes in now relating to the ones in before as relation says
+        **/
+        Mask compare(const Bytes& now, const Bytes& before, RamSearch::Relation relation, uint8_t operand)
+        {
+            switch (relation)
+            {
+            case RamSearch::Relation::Unchanged:    return now == before;
+            case RamSearch::Relation::Changed:      return now != before;
+            case RamSearch::Relation::Increased:    return now > before;
+            case RamSearch::Relation::Decreased:    return now < before;
+            case RamSearch::Relation::IncreasedBy:  return Bytes(now - before) == operand;
+            case RamSearch::Relation::DecreasedBy:  return Bytes(before - now) == operand;
+            case RamSearch::Relation::EqualTo:      return now == operand;
+            }
+
+            return Mask{};
+        }
+    }
+
+
+    void RamSearch::start(const Memory& memory)
+    {
+        m_candidates.assign(memory.size(), 0xFF);
+        memory.copyTo(m_snapshot);
+    }
+
+    size_t RamSearch::filter(const Memory& memory, Relation relation, uint8_t operand)
+    {
+        if (m_snapshot.size() != memory.size())
+        {
+            m_candidates.assign(memory.size(), 0xFF);
+            m_snapshot.assign(memory.size(), 0);
+        }
+
+        memory.copyTo(m_now);
+
+        for (size_t at = 0; at < m_now.size(); at += k_vectorSize)
+        {
+            const Mask kept = compare(load(m_now.data() + at), load(m_snapshot.data() + at), relation, operand) &
+                              Mask(load(m_candidates.data() + at));
+            memcpy(m_candidates.data() + at, &kept, sizeof(kept));
+        }
+
+        m_snapshot.swap(m_now);
+        return count();
+    }
+
+    size_t RamSearch::count() const
+    {
+        // a candidate sets all 8 bits of its byte
+        size_t bits = 0;
+        for (size_t at = 0; at < m_candidates.size(); at += sizeof(uint64_t))
+        {
+            uint64_t word;
+            memcpy(&word, m_candidates.data() + at, sizeof(word));
+            bits += __builtin_popcountll(word);
+        }
+
+        return bits / 8;
+    }
+
+    std::vector<uint16_t> RamSearch::candidates() const
+    {
+        std::vector<uint16_t> addrs;
+        for (uint32_t addr = 0; addr < m_candidates.size(); addr++)
+            if (m_candidates[addr])
+                addrs.push_back(addr);
+
+        return addrs;
+    }
+
+
+    void CheatList::freeze(uint16_t addr, uint8_t val)
+    {
+        add(Patch{addr, val, true});
+    }
+
+    void CheatList::poke(uint16_t addr, uint8_t val)
+    {
+        add(Patch{addr, val, false});
+    }
+
+    bool CheatList::remove(uint16_t addr)
+    {
+        for (size_t index = 0; index < m_patches.size(); index++)
+        {
+            if (m_patches[index].addr != addr)
+                continue;
+
+            m_patches.erase(m_patches.begin() + index);
+            return true;
+        }
+
+        return false;
+    }
+
+    void CheatList::apply(Memory& memory)
+    {
+        size_t kept = 0;
+        for (const Patch& patch : m_patches)
+        {
+            if (patch.addr < memory.size() && memory.read(patch.addr) != patch.val)
+                memory.write(patch.addr, patch.val);
+
+            if (patch.isFrozen)
+                m_patches[kept++] = patch;
+        }
+
+        m_patches.resize(kept);
+    }
+
+    void CheatList::print(std::ostream& out) const
+    {
+        out << std::hex << std::setfill('0');
+        for (const Patch& patch : m_patches)
+            out << "0x" << std::setw(3) << patch.addr << " = 0x" << std::setw(2) << static_cast<int>(patch.val)
+                << (patch.isFrozen ? " frozen\n" : " once\n");
+        out << std::dec << std::setfill(' ');
+    }
+
+    void CheatList::add(Patch patch)
+    {
+        // a later patch of an address replaces the earlier one
+        remove(patch.addr);
+        m_patches.push_back(patch);
+    }
+}
@@ -0,0 +1,126 @@
+#ifndef CHEATS_H
+#define CHEATS_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include <ostream>
+#include <vector>
+
+#include "chip8.h"
+
+namespace chip8
+{
+    /**
+     * Narrows down which memory addresses hold a value, e.g. a rom's score
+     * or lives, by how their bytes changed between snapshots of the memory.
+     *
+     * Every address starts as a candidate. Each filter() compares the memory
+     * now with the snapshot taken by the one before and drops the candidates
+     * whose byte did not change as asked, a whole vector of addresses at a
+     * time.
+    **/
+    class RamSearch
+    {
+    public:
+        enum class Relation
+        {
+            Unchanged,
+            Changed,
+            Increased,
+            Decreased,
+            IncreasedBy,    // by the operand, wrapping around as the rom's arithmetic does
+            DecreasedBy,
+            EqualTo         // the operand, whatever the byte was before
+        };
+
+        /**
+         * makes every address a candidate again and snapshots memory
+        **/
+        void start(const Memory& memory);
+
+        /**
+         * keeps the candidates whose byte in memory relates to the one in the
+         * last snapshot as relation says, then snapshots memory. without a
+         * snapshot of a memory this size yet, starts from a blank one.
+         * @returns no. of candidates left
+        **/
+        size_t filter(const Memory& memory, Relation relation, uint8_t operand = 0);
+
+        /**
+         * @returns no. of candidates left
+        **/
+        size_t count() const;
+
+        /**
+         * @returns the addresses still candidates, in ascending order
+        **/
+        std::vector<uint16_t> candidates() const;
+
+        /**
+         * @returns the byte at addr in the last snapshot
+        **/
+        uint8_t value(uint16_t addr) const { return m_snapshot[addr]; }
+
+    private:
+        // 0xFF for a candidate, 0 otherwise, an entry per address
+        std::vector<uint8_t> m_candidates;
+        Memory::Ram m_snapshot;
+        Memory::Ram m_now;                  // kept to compare without allocating
+    };
+
+    /**
+     * Bytes written into memory at frame boundaries, once or every frame,
+     * to tinker with a game or keep a value fixed while looking for another.
+     * Nothing is checked per instruction, the rom may change a frozen byte
+     * but only until the next frame starts.
+    **/
+    class CheatList
+    {
+    public:
+        /**
+         * writes val to addr before every frame from the next one on
+        **/
+        void freeze(uint16_t addr, uint8_t val);
+
+        /**
+         * writes val to addr before the next frame only
+        **/
+        void poke(uint16_t addr, uint8_t val);
+
+        /**
+         * stops writing to addr, pokes not applied yet included
+         * @returns false if nothing was to be written to addr
+        **/
+        bool remove(uint16_t addr);
+
+        bool empty() const { return m_patches.empty(); }
+
+        /**
+         * writes the patches into memory, to be called between frames.
+         * bytes already holding their value are not written, so pages
+         * shared with a clone are not copied for nothing. addresses past
+         * the end of memory are left out.
+        **/
+        void apply(Memory& memory);
+
+        /**
+         * prints every patch, a line each
+        **/
+        void print(std::ostream& out) const;
+
+    private:
+        struct Patch
+        {
+            uint16_t addr;
+            uint8_t val;
+            bool isFrozen;      // false for a poke, dropped once applied
+        };
+
+        std::vector<Patch> m_patches;
+
+        void add(Patch patch);
+    };
+}
+
+#endif /* CHEATS_H */
@@ -1,5 +1,8 @@
 #include "chip8.h"
 
+#include <stdlib.h>
+#include <string.h>
+
 namespace chip8
 {
     void checkValSize(uint16_t val, uint8_t b)
@@ -15,36 +18,155 @@ namespace chip8
     }
 
 
-    bool Display::attachSprite(const std::vector<uint8_t>& sprite, uint8_t x, uint8_t y)
+    Memory* Memory::clone()
+    {
+        Memory* copy = new Memory{};
+
+        for (uint16_t index = 0; index < m_pageCount; index++)
+        {
+            m_pages[index]->references.fetch_add(1, std::memory_order_relaxed);
+            copy->m_pages[index] = m_pages[index];
+        }
+        copy->m_pageCount = m_pageCount;
+
+        // shared now, the next write to a page copies it
+        m_owned.reset();
+
+        return copy;
+    }
+
+    void Memory::own(uint16_t index)
+    {
+        Page* page = m_pages[index];
+
+        // acquire, what other memories read from it before letting go happens before writes to it
+        if (page->references.load(std::memory_order_acquire) != 1)
+        {
+            Page* copy = new Page{};
+            memcpy(copy->bytes, page->bytes, k_pageSize);
+
+            m_pages[index] = copy;
+            release(page);
+        }
+
+        m_owned[index] = true;
+    }
+
+    namespace
+    {
+        /**
+         * @returns bits with every bit doubled, for pixels drawn 2 wide
+        **/
+        uint32_t doubleBits(uint16_t bits)
+        {
+            uint32_t spread = bits;
+            spread = (spread | (spread << 8)) & 0x00FF00FF;
+            spread = (spread | (spread << 4)) & 0x0F0F0F0F;
+            spread = (spread | (spread << 2)) & 0x33333333;
+            spread = (spread | (spread << 1)) & 0x55555555;
+            return spread | (spread << 1);
+        }
+    }
+
+    template <bool Wraps>
+    bool Display::attachSprite(const uint8_t* sprite, uint8_t n, uint8_t x, uint8_t y)
     {
-        const static uint8_t spriteWidth = 8;
         bool anyErased = false;
 
-        // start pos of sprites wrap around
-        x %= m_width;
-        y %= m_height;
+        const bool isWide = n == 0 && hasHires(m_platform);
+        const uint8_t rows = isWide ? 16 : n;
+        const uint8_t bytesPerRow = isWide ? 2 : 1;
 
-        for (uint8_t i = 0; i < sprite.size(); i++)
+        // screen pixels per sprite pixel along each axis
+        const uint8_t scale = m_mode.isLowRes ? 2 : 1;
+        const uint8_t width = 8 * bytesPerRow * scale;
+
+        // start pos of sprites wrap around, the sprites themselves are clipped unless Wraps
+        const uint16_t left = x % (m_width / scale) * scale;
+        const uint16_t top = y % (m_height / scale) * scale;
+
+        for (uint8_t plane = 0; plane < m_planes; plane++)
         {
-            uint8_t drwY = y + i;
-            if (drwY >= m_height) break;
+            if (!((m_mode.selected >> plane) & 1))
+                continue;
 
-            for (uint8_t j = 0; j < spriteWidth; j++)
-            {   
-                uint8_t drwX = x + (spriteWidth - j - 1);
-                if (drwX >= m_width) continue;
+            uint64_t* screen = &m_screen[plane * m_planeWords];
 
-                if ((sprite[i] & (1 << j)) && m_screen.at(drwY).at(drwX))
-                {
-                    anyErased = true;
-                }
+            for (uint8_t i = 0; i < rows; i++)
+            {
+                uint32_t line = isWide ? (sprite[2 * i] << 8) | sprite[2 * i + 1] : sprite[i];
+                if (scale == 2)
+                    line = doubleBits(line);
+
+                const uint64_t bits = static_cast<uint64_t>(line) << (c_wordBits - width);
 
-                m_screen.at(drwY).at(drwX) =
-                    m_screen.at(drwY).at(drwX) ^ ((sprite[i] & (1 << j)) >> j);
+                for (uint16_t drwY = top + i * scale; drwY < top + (i + 1) * scale; drwY++)
+                {
+                    if (!Wraps && drwY >= m_height)
+                        break;
 
+                    anyErased |= xorRow<Wraps>(&screen[(Wraps ? drwY % m_height : drwY) * m_wordsPerRow], bits, width, left);
+                }
             }
+
+            sprite += rows * bytesPerRow;
         }
 
         return anyErased;
     }
+
+    template bool Display::attachSprite<false>(const uint8_t* sprite, uint8_t n, uint8_t x, uint8_t y);
+    template bool Display::attachSprite<true>(const uint8_t* sprite, uint8_t n, uint8_t x, uint8_t y);
+
+    void Display::scroll(int8_t dx, int8_t dy)
+    {
+        const uint8_t scale = m_mode.isLowRes ? 2 : 1;
+        const int shiftX = dx * scale;
+        const int shiftY = dy * scale;
+
+        for (uint8_t plane = 0; plane < m_planes; plane++)
+        {
+            if (!((m_mode.selected >> plane) & 1))
+                continue;
+
+            uint64_t* screen = &m_screen[plane * m_planeWords];
+
+            // whole rows at a time
+            const size_t movedRows = std::max(m_height - abs(shiftY), 0);
+            const size_t blankRows = m_height - movedRows;
+            if (shiftY > 0)
+            {
+                std::copy_backward(screen, screen + movedRows * m_wordsPerRow, screen + m_planeWords);
+                std::fill_n(screen, blankRows * m_wordsPerRow, 0);
+            }
+            else if (shiftY < 0)
+            {
+                std::copy(screen + blankRows * m_wordsPerRow, screen + m_planeWords, screen);
+                std::fill_n(screen + movedRows * m_wordsPerRow, blankRows * m_wordsPerRow, 0);
+            }
+
+            // bits carried from word to word along each row, less than a word
+            if (shiftX == 0)
+                continue;
+
+            const int bits = abs(shiftX);
+            for (uint16_t y = 0; y < m_height; y++)
+            {
+                uint64_t* row = screen + y * m_wordsPerRow;
+
+                if (shiftX > 0)
+                {
+                    for (uint16_t word = m_wordsPerRow - 1; word > 0; word--)
+                        row[word] = (row[word] >> bits) | (row[word - 1] << (c_wordBits - bits));
+                    row[0] >>= bits;
+                }
+                else
+                {
+                    for (uint16_t word = 0; word + 1 < m_wordsPerRow; word++)
+                        row[word] = (row[word] << bits) | (row[word + 1] >> (c_wordBits - bits));
+                    row[m_wordsPerRow - 1] <<= bits;
+                }
+            }
+        }
+    }
 }
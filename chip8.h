@@ -4,12 +4,19 @@
 #include <stdint.h>
 #include <math.h>
 
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bitset>
 #include <iostream>
 #include <fstream>
 #include <vector>
-#include <stack>
+#include <string>
 #include <stdexcept>
 
+#include "fonts.h"
+#include "platform.h"
+
 namespace chip8
 {
     /**
@@ -19,115 +26,415 @@ namespace chip8
     **/
     void checkValSize(uint16_t val, uint8_t b);
 
+    /**
+     * The address space, kept in pages that clones share until one of them
+     * writes to a page, see clone(). 4KB for most platforms, the whole 64KB
+     * a 16 bit address reaches for XO-CHIP, see sizeFor().
+    **/
     class Memory
     {
     public:
         inline static const uint16_t c_fontStartAddr = 0x050;
 
-        Memory(std::ifstream& rom) : Memory(rom, c_defaultFont) { }
+        /**
+         * @param platform picks the font put at c_fontStartAddr
+        **/
+        Memory(std::ifstream& rom, Platform platform = Platform::CosmacVip)
+            :   Memory(readRom(rom), platform)
+        { }
+
+        /**
+         * @param rom, size the rom image, copied in as is
+         * @param platform picks the font put at c_fontStartAddr and the size
+         * @throws runtime_error if size > maxRomSize(platform)
+        **/
+        Memory(const uint8_t* rom, size_t size, Platform platform = Platform::CosmacVip)
+        {
+            load(rom, size, platform);
+        }
 
-        Memory(std::ifstream& rom, std::vector<uint8_t> font)
-            :   m_font(font)
+        ~Memory()
         {
+            for (uint16_t index = 0; index < m_pageCount; index++)
+                release(m_pages[index]);
+        }
+
+        /**
+         * clears the memory and puts the font and rom in again, allocates
+         * nothing unless pages are shared with a clone or platform needs
+         * more memory than the one loaded before
+         * @param rom, size the rom image, copied in as is
+         * @param platform picks the font put at c_fontStartAddr and the size
+         * @throws runtime_error if size > maxRomSize(platform)
+        **/
+        void load(const uint8_t* rom, size_t size, Platform platform = Platform::CosmacVip)
+        {
+            if (size > maxRomSize(platform))
+                throw std::runtime_error("ERROR: Rom is " + std::to_string(size) + " bytes, at most " +
+                                         std::to_string(maxRomSize(platform)) + " fit in memory!");
+
+            resize(sizeFor(platform) / k_pageSize);
+
+            for (uint16_t index = 0; index < m_pageCount; index++)
+                std::fill_n(writablePage(index)->bytes, k_pageSize, 0);
+
             // initialising font
-            for (uint16_t i = 0; i < m_font.size(); i++)
-                m_ram[i + c_fontStartAddr] = m_font[i];
+            const std::array<uint8_t, 80>& font = fontFor(platform);
+            copyIn(c_fontStartAddr, font.data(), font.size());
 
             // initialising rom
-            if (!rom.good())
-                throw std::runtime_error("ERROR: Unable to load rom!");
-
-            char ch {};
-            for (uint16_t i = c_romStartAddr; rom.get(ch); i++)
-                m_ram.at(i) = static_cast<uint8_t>(ch);
+            copyIn(c_romStartAddr, rom, size);
         }
 
 
         /**
-         * @param addr should be a 12 bit int < (1 << 12)
+         * @param addr should be < size()
          * @returns a uint8_t value at addr
         **/
-        uint8_t read (int addr) { checkValSize(addr, c_addrBits); return m_ram[addr]; }
+        uint8_t read (int addr) const
+        {
+            const uint32_t at = checkAddr(addr);
+            return m_pages[at / k_pageSize]->bytes[at % k_pageSize];
+        }
+
+        /**
+         * @param addr should be < size() - 1
+         * @returns the big endian word at addr, an instruction
+        **/
+        uint16_t readWord(int addr) const
+        {
+            const uint32_t at = checkAddr(addr);
+            checkAddr(at + 1);
+
+            const uint8_t* bytes = m_pages[at / k_pageSize]->bytes;
+            if (at % k_pageSize != k_pageSize - 1)
+                return (bytes[at % k_pageSize] << 8) | bytes[at % k_pageSize + 1];
+
+            // the word spans two pages
+            return (bytes[k_pageSize - 1] << 8) | m_pages[at / k_pageSize + 1]->bytes[0];
+        }
 
         /**
-         * @param addr should be a 12 bit int
+         * @param addr should be < size()
          * @param val should be a uint8_t
         **/
-        void write(uint16_t addr, uint8_t val) { checkValSize(addr, c_addrBits ); m_ram[addr] = val; }
+        void write(int addr, uint8_t val)
+        {
+            const uint32_t at = checkAddr(addr);
+            writablePage(at / k_pageSize)->bytes[at % k_pageSize] = val;
+        }
 
 
         Memory(const Memory&) = delete;
         Memory& operator=(const Memory&) = delete;
 
+        /**
+         * @returns a memory holding the same, sharing every page with this
+         *  one. either copies a page the first time it writes to it, both
+         *  may then be used on different threads.
+        **/
+        Memory* clone();
+
+        // the unit shared by clones
+        static constexpr uint16_t k_pageSize = 256;
+
+        /**
+         * the memory's bytes, size() of them, as a snapshot holds them
+        **/
+        using Ram = std::vector<uint8_t>;
+
+        /**
+         * for snapshots, see Interpreter::save(). allocates nothing once ram
+         * held a copy of a memory this size.
+        **/
+        void copyTo(Ram& ram) const
+        {
+            ram.resize(size());
+            for (uint16_t index = 0; index < m_pageCount; index++)
+                std::copy_n(m_pages[index]->bytes, k_pageSize, ram.begin() + index * k_pageSize);
+        }
+
+        /**
+         * @param ram as copyTo() filled it, of a memory this size
+         * @throws runtime_error if ram is of another size
+        **/
+        void setRam(const Ram& ram)
+        {
+            if (ram.size() != size())
+                throw std::runtime_error("ERROR: Snapshot of " + std::to_string(ram.size()) + " bytes does not fit a memory of " +
+                                         std::to_string(size()) + "!");
+
+            for (uint16_t index = 0; index < m_pageCount; index++)
+                std::copy_n(ram.begin() + index * k_pageSize, k_pageSize, writablePage(index)->bytes);
+        }
+
+        /**
+         * @returns the k_pageSize bytes from address index * k_pageSize on
+        **/
+        const uint8_t* page(uint16_t index) const { return m_pages[index]->bytes; }
+
+        /**
+         * @returns no. of pages, size() / k_pageSize
+        **/
+        uint16_t pages() const { return m_pageCount; }
+
         static uint16_t romStartAddress() { return c_romStartAddr; }
 
+        /**
+         * @returns no. of addressable bytes
+        **/
+        uint32_t size() const { return m_pageCount * k_pageSize; }
+
+        /**
+         * @returns no. of addressable bytes of a machine running roms for platform
+        **/
+        static constexpr uint32_t sizeFor(Platform platform) { return (platform == Platform::XoChip ? 64 : 4) * 1024; }
+
+        /**
+         * @returns the largest size() of any platform
+        **/
+        static constexpr uint32_t maxSize() { return sizeFor(Platform::XoChip); }
+
+        /**
+         * @returns no. of bytes between the rom start address and the end of memory for platform
+        **/
+        static constexpr uint32_t maxRomSize(Platform platform) { return sizeFor(platform) - c_romStartAddr; }
+
+        /**
+         * @returns the largest rom any platform loads
+        **/
+        static constexpr uint32_t maxRomSize() { return maxRomSize(Platform::XoChip); }
+
     private:
-        static constexpr uint k_sizeKB = 4;
-
-        inline static const uint8_t c_addrBits =    // no. of bits in a mem addr
-            static_cast<uint8_t>(ceil(log2(k_sizeKB * 1024)));
-
-        inline static const uint16_t c_romStartAddr  = 0x200;
-
-        inline static const std::vector<uint8_t> c_defaultFont {
-            0xf0, 0x90, 0x90, 0x90, 0xf0, // 0
-            0x20, 0x60, 0x20, 0x20, 0x70, // 1
-            0xf0, 0x10, 0xf0, 0x80, 0xf0, // 2
-            0xf0, 0x10, 0xf0, 0x10, 0xf0, // 3
-            0x90, 0x90, 0xf0, 0x10, 0x10, // 4
-            0xf0, 0x80, 0xf0, 0x10, 0xf0, // 5
-            0xf0, 0x80, 0xf0, 0x90, 0xf0, // 6
-            0xf0, 0x10, 0x20, 0x40, 0x40, // 7
-            0xf0, 0x90, 0xf0, 0x90, 0xf0, // 8
-            0xf0, 0x90, 0xf0, 0x10, 0xf0, // 9
-            0xf0, 0x90, 0xf0, 0x90, 0x90, // A
-            0xe0, 0x90, 0xe0, 0x90, 0xe0, // B
-            0xf0, 0x80, 0x80, 0x80, 0xf0, // C
-            0xe0, 0x90, 0x90, 0x90, 0xe0, // D
-            0xf0, 0x80, 0xf0, 0x80, 0xf0, // E
-            0xf0, 0x80, 0xf0, 0x80, 0x80  // F
+        static constexpr uint16_t c_romStartAddr  = 0x200;
+
+        struct Page
+        {
+            std::atomic<uint32_t> references { 1 };
+            uint8_t bytes[k_pageSize] {};
         };
 
-        std::vector<uint8_t> m_ram{ std::vector<uint8_t>(k_sizeKB * 1024, 0) };
+        // enough for the largest memory, see sizeFor()
+        static constexpr uint16_t k_maxPages = 64 * 1024 / k_pageSize;
+
+        std::array<Page*, k_maxPages> m_pages {};
+        std::bitset<k_maxPages> m_owned;    // pages no clone shares, written in place
+        uint16_t m_pageCount {};            // the first this many are used
+
+        Memory() = default;
+
+        /**
+         * makes pages the no. of pages used, new ones owned and empty
+        **/
+        void resize(uint16_t pages)
+        {
+            for (uint16_t index = m_pageCount; index < pages; index++)
+            {
+                m_pages[index] = new Page{};
+                m_owned[index] = true;
+            }
+
+            for (uint16_t index = pages; index < m_pageCount; index++)
+            {
+                release(m_pages[index]);
+                m_pages[index] = nullptr;
+                m_owned[index] = false;
+            }
+
+            m_pageCount = pages;
+        }
+
+        /**
+         * @returns page no. index, copied first if it may be shared
+        **/
+        Page* writablePage(uint16_t index)
+        {
+            if (!m_owned[index])
+                own(index);
+
+            return m_pages[index];
+        }
+
+        /**
+         * copies size bytes from bytes to addr on, which have to fit
+        **/
+        void copyIn(uint32_t addr, const uint8_t* bytes, size_t size)
+        {
+            while (size > 0)
+            {
+                const size_t count = std::min<size_t>(size, k_pageSize - addr % k_pageSize);
+                std::copy_n(bytes, count, writablePage(addr / k_pageSize)->bytes + addr % k_pageSize);
+
+                addr += count;
+                bytes += count;
+                size -= count;
+            }
+        }
 
-        std::vector<uint8_t> m_font;
+        /**
+         * copies page no. index unless this memory is the only one left referencing it
+        **/
+        void own(uint16_t index);
+
+        static void release(Page* page)
+        {
+            if (page->references.fetch_sub(1, std::memory_order_acq_rel) == 1)
+                delete page;
+        }
+
+        /**
+         * @returns addr
+         * @throws runtime_error if addr is outside the memory, addresses
+         *  past 0xFFFF included as e.g. I + 15 may get there
+        **/
+        uint32_t checkAddr(int addr) const
+        {
+            if (addr < 0 || addr >= static_cast<int>(size()))
+                throw std::runtime_error("ERROR: Attempted to access invalid memory address on host");
+
+            return addr;
+        }
+
+        Memory(const std::vector<uint8_t>& rom, Platform platform)
+            :   Memory(rom.data(), rom.size(), platform)
+        { }
+
+        /**
+         * @returns the built in font of platform, as generated from fonts/
+        **/
+        static constexpr const std::array<uint8_t, 80>& fontFor(Platform platform)
+        {
+            switch (platform)
+            {
+            case Platform::CosmacVip:   return fonts::cosmacvip;
+            case Platform::Dream6800:   return fonts::dream6800;
+            case Platform::Eti660:      return fonts::eti660;
+            default:                    return fonts::chip48;
+            }
+        }
+
+        /**
+         * @throws runtime_error if rom cannot be read or holds more than maxRomSize() bytes
+        **/
+        static std::vector<uint8_t> readRom(std::ifstream& rom)
+        {
+            if (!rom.good())
+                throw std::runtime_error("ERROR: Unable to load rom!");
+
+            // one byte more than fits is enough to know it does not
+            std::vector<uint8_t> bytes(maxRomSize() + 1);
+            rom.read(reinterpret_cast<char*>(bytes.data()), bytes.size());
+            bytes.resize(rom.gcount());
+
+            return bytes;
+        }
     };
 
     class Cpu
     {
     public:
+        static constexpr uint8_t k_stackSize = 16;     // no. of nested calls
+
+        /**
+         * everything the cpu holds, plain data so it copies cheaply
+        **/
+        struct State
+        {
+            std::array<uint8_t, 16> registers;
+
+            uint16_t I;     // used to store memory addrs'
+            uint16_t PC;    // program counter
+
+            uint8_t delayTimer;     // decrements by 1 if > 0 at 60Hz
+            uint8_t soundTimer;     // decrements by 1 if > 0 at 60Hz
+
+            std::array<uint16_t, k_stackSize> callStack;
+            uint8_t stackDepth;
+
+            // XO-CHIP audio, played while the sound timer runs, see audioRate()
+            std::array<uint8_t, 16> audioPattern;   // 128 1 bit samples, most significant bit first
+            uint8_t pitch { k_defaultPitch };
+        };
+
+        static constexpr uint8_t k_defaultPitch = 64;     // 4000 samples per second
+
+        /**
+         * @returns the samples per second the audio pattern plays at with pitch
+        **/
+        static double audioRate(uint8_t pitch) { return 4000 * pow(2, (pitch - k_defaultPitch) / 48.0); }
 
         /**
          * @param addr should be a 4 bit int
          * @returns a uint8_t value at addr
         **/
-        uint8_t readRegister(uint8_t addr) { checkValSize(addr, c_registerBits); return m_registers[addr]; }
+        uint8_t readRegister(uint8_t addr) { checkValSize(addr, c_registerBits); return m_state.registers[addr]; }
 
         /**
          * @param addr should be a 4 bit int
          * @param val should be a uint8_t
         **/
-        void writeRegister(uint8_t addr, uint8_t val) { checkValSize(addr, c_registerBits); m_registers[addr] = val; }
+        void writeRegister(uint8_t addr, uint8_t val) { checkValSize(addr, c_registerBits); m_state.registers[addr] = val; }
+
+        uint16_t readI() { return m_state.I; }
+        void writeI(uint16_t val) { m_state.I = val; }
+
+        uint16_t readPC() { return m_state.PC; }
+        void writePC(uint16_t val) { m_state.PC = val; }
+        void incrementPC() { m_state.PC += 2; }
+
+        uint8_t delayTimer() { return m_state.delayTimer; }
+        void setDelayTimer(uint8_t val) { m_state.delayTimer = val; }
+
+        uint8_t soundTimer() { return m_state.soundTimer; }
+        void setSoundTimer(uint8_t val) { m_state.soundTimer = val; }
+
+        const std::array<uint8_t, 16>& audioPattern() { return m_state.audioPattern; }
+        void setAudioPattern(const std::array<uint8_t, 16>& pattern) { m_state.audioPattern = pattern; }
 
-        uint16_t readI() { return m_I; }
-        void writeI(uint16_t val) { m_I = val; }
+        uint8_t pitch() { return m_state.pitch; }
+        void setPitch(uint8_t val) { m_state.pitch = val; }
 
-        uint16_t readPC() { return m_PC; }
-        void writePC(uint16_t val) { m_PC = val; }
-        void incrementPC() { m_PC += 2; }
+        /**
+         * @throws runtime_error if k_stackSize calls are nested already
+        **/
+        void pushStack(uint16_t addr)
+        {
+            if (m_state.stackDepth == k_stackSize)
+                throw std::runtime_error("ERROR: Call stack overflow");
+            m_state.callStack[m_state.stackDepth++] = addr;
+        }
 
-        uint8_t delayTimer() { return m_delayTimer; }
-        void setDelayTimer(uint8_t val) { m_delayTimer = val; }
+        /**
+         * @throws runtime_error if the stack is empty
+        **/
+        uint16_t peekStack()
+        {
+            if (m_state.stackDepth == 0)
+                throw std::runtime_error("ERROR: Return with an empty call stack");
+            return m_state.callStack[m_state.stackDepth - 1];
+        }
 
-        uint8_t soundTimer() { return m_soundTimer; }
-        void setSoundTimer(uint8_t val) { m_soundTimer = val; }
+        /**
+         * @throws runtime_error if the stack is empty
+        **/
+        void popStack()
+        {
+            if (m_state.stackDepth == 0)
+                throw std::runtime_error("ERROR: Return with an empty call stack");
+            m_state.stackDepth--;
+        }
 
-        void pushStack(uint16_t addr) { m_callStack.push(addr); }
-        uint16_t peekStack() { return m_callStack.top(); }
-        void popStack() { m_callStack.pop(); }
+        size_t stackDepth() { return m_state.stackDepth; }
 
+        /**
+         * for snapshots, see Interpreter::save()
+        **/
+        const State& state() const { return m_state; }
+        void setState(const State& state) { m_state = state; }
 
     private:
+        friend class TableEngine;
+
         static constexpr uint8_t k_registerCount = 16;
         static constexpr uint8_t k_iPcBits = 16;        // no. of bits in I & PC registers each
         static constexpr uint8_t k_timerBits = 8;       // no. of bits in delay & sound timers each
@@ -135,78 +442,216 @@ namespace chip8
         inline static const uint8_t c_registerBits =    // no. of bits in a register addr
             static_cast<uint8_t>(ceil(log2(k_registerCount)));
 
-
-        std::vector<uint8_t> m_registers{ std::vector<uint8_t>(k_registerCount, 0) };
-
-        uint16_t m_I  {}; // used to store memory addrs'
-        uint16_t m_PC {}; // program counter
-
-        uint8_t m_delayTimer {}; // decrements by 1 if > 0 at 60Hz
-        uint8_t m_soundTimer {}; // decrements by 1 if > 0 at 60Hz
-        
-        std::stack<uint16_t> m_callStack {};
+        State m_state {};
     };
 
     class Display
     {
     public:
-        Display() : Display(false) { }
+        static constexpr uint8_t k_maxPlanes = 2;
 
-        Display(bool isSuperChip)
-            :   m_isSuperChip(isSuperChip),
-                m_width(isSuperChip ? 128 : 64),
-                m_height(isSuperChip ? 64 : 32)
+        // the most bytes one Dxyn draws, a 16x16 sprite on every plane
+        static constexpr uint8_t k_maxSpriteSize = 32 * k_maxPlanes;
+
+        /**
+         * what SUPER-CHIP and XO-CHIP roms switch between, part of the machine state
+        **/
+        struct Mode
         {
-            // initialising bool matrix
-            m_screen.resize(m_height);
-            for (std::vector<bool>& row : m_screen)
-                row.resize(m_width, false);
-        }
+            uint8_t selected;   // planes drawn to, cleared and scrolled, bit n for plane n
+            bool isLowRes;      // drawing every pixel as 2x2
+        };
+
+        Display() : Display(Platform::CosmacVip) { }
+
+        /**
+         * @param platform see reset()
+        **/
+        explicit Display(Platform platform) { reset(platform); }
 
         Display(const Display&) = delete;
         Display& operator=(const Display&) = delete;
 
         uint16_t width() { return m_width; }
         uint16_t height() { return m_height; }
-        const std::vector< std::vector<bool> >& screenBuffer() { return m_screen; }
+        uint8_t planes() { return m_planes; }
 
         /**
-         * attaches sprite in-memory.
+         * @returns
+         *  the frame packed at 1 bit per pixel, plane after plane of height()
+         *  rows of wordsPerRow() words each. The most significant bit of the
+         *  first word of a row is its leftmost pixel.
+        **/
+        const std::vector<uint64_t>& screenBuffer() const { return m_screen; }
+        uint16_t wordsPerRow() { return m_wordsPerRow; }
+
+        bool pixel(uint16_t x, uint16_t y, uint8_t plane = 0)
+        {
+            return (m_screen.at(plane * m_planeWords + y * m_wordsPerRow + x / c_wordBits) >> (c_wordBits - 1 - x % c_wordBits)) & 1;
+        }
+
+        /**
+         * @param n as in Dxyn
+         * @returns no. of sprite bytes attachSprite() draws from
+        **/
+        uint8_t spriteSize(uint8_t n) const
+        {
+            return (n == 0 && hasHires(m_platform) ? 32 : n) * __builtin_popcount(m_mode.selected);
+        }
+
+        /**
+         * attaches sprite in-memory to every selected plane, the rows for
+         * the first plane first. n is as in Dxyn, 0 drawing 16x16 pixels on
+         * SUPER-CHIP and XO-CHIP and nothing otherwise.
+         * @param Wraps sprites crossing an edge of the screen are continued
+         *  at the opposite one, see Quirks::spritesWrap, else clipped
          * @returns
          *  true if register F is to be set to 1, false if it is to be set to 0
         */
-        bool attachSprite(const std::vector<uint8_t>& sprite, uint8_t x, uint8_t y);
+        template <bool Wraps = false>
+        bool attachSprite(const uint8_t* sprite, uint8_t n, uint8_t x, uint8_t y);
 
+        bool attachSprite(const std::vector<uint8_t>& sprite, uint8_t x, uint8_t y)
+        {
+            return attachSprite(sprite.data(), sprite.size(), x, y);
+        }
+
+        /**
+         * clears the selected planes
+        **/
         void clear()
         {
-            for (uint8_t i = 0; i < m_screen.size(); i++)
-                for (uint8_t j = 0; j < m_screen[i].size(); j++)
-                    m_screen[i][j] = false;
+            for (uint8_t plane = 0; plane < m_planes; plane++)
+                if ((m_mode.selected >> plane) & 1)
+                    std::fill_n(&m_screen[plane * m_planeWords], m_planeWords, 0);
+        }
+
+        /**
+         * moves the pixels of the selected planes by dx, dy pixels of the
+         * current resolution, positive to the right and down, |dx| < 32.
+         * pixels moved past an edge are lost, the ones moved in are blank.
+        **/
+        void scroll(int8_t dx, int8_t dy);
+
+        /**
+         * @param planes bit n set to draw to plane n
+        **/
+        void selectPlanes(uint8_t planes) { m_mode.selected = planes & ((1 << m_planes) - 1); }
+
+        /**
+         * switches between drawing pixels 2x2 and 1x1, clearing every plane
+        **/
+        void setLowRes(bool isLowRes)
+        {
+            m_mode.isLowRes = isLowRes;
+            std::fill(m_screen.begin(), m_screen.end(), 0);
+        }
+
+        /**
+         * for snapshots, see Interpreter::save()
+        **/
+        const Mode& mode() const { return m_mode; }
+        void setMode(const Mode& mode) { m_mode = mode; }
+
+        /**
+         * @param screen as returned by screenBuffer(), for snapshots
+        **/
+        void setScreenBuffer(const std::vector<uint64_t>& screen) { m_screen = screen; }
+
+        /**
+         * blanks the display and makes it the one of platform: 128x64
+         * pixels, starting in low resolution, for SUPER-CHIP and XO-CHIP,
+         * the latter's on 2 planes, and 64x32 on one plane otherwise.
+         * allocates nothing unless the display grows.
+        **/
+        void reset(Platform platform)
+        {
+            m_platform = platform;
+            m_width = hasHires(platform) ? 128 : 64;
+            m_height = hasHires(platform) ? 64 : 32;
+            m_planes = platform == Platform::XoChip ? 2 : 1;
+            m_wordsPerRow = m_width / c_wordBits;
+            m_planeWords = m_wordsPerRow * m_height;
+            m_mode = { 1, hasHires(platform) };
+
+            m_screen.assign(m_planeWords * m_planes, 0);
+        }
+
+        /**
+         * @returns a new display showing the same
+        **/
+        Display* clone() const
+        {
+            Display* copy = new Display{m_platform};
+            copy->m_screen = m_screen;
+            copy->m_mode = m_mode;
+            return copy;
         }
 
     private:
+        inline static const uint16_t c_wordBits = 64;
+
+        Platform m_platform;
+
         uint16_t m_width;
         uint16_t m_height;
+        uint8_t m_planes;
+        uint16_t m_wordsPerRow;
+        size_t m_planeWords;            // per plane
 
-        bool m_isSuperChip;
+        Mode m_mode;
 
-        std::vector< std::vector<bool> > m_screen;
+        std::vector<uint64_t> m_screen;
 
+        /**
+         * xors bits, a sprite row of width bits starting at the most
+         * significant one, into row from pixel x on, clipped at the row's end
+         * or wrapping around to its start
+         * @returns true if a pixel was erased
+        **/
+        template <bool Wraps>
+        bool xorRow(uint64_t* row, uint64_t bits, uint8_t width, uint16_t x)
+        {
+            const uint16_t word = x / c_wordBits;
+            const uint16_t shift = x % c_wordBits;
+
+            const uint64_t lo = bits >> shift;
+            bool anyErased = (row[word] & lo) != 0;
+            row[word] ^= lo;
+
+            // bits shifted past the last word of the row are clipped away, or xor'ed into the first
+            const uint16_t next = Wraps ? (word + 1) % m_wordsPerRow : word + 1;
+            if (shift > c_wordBits - width && next < m_wordsPerRow)
+            {
+                const uint64_t hi = bits << (c_wordBits - shift);
+                anyErased |= (row[next] & hi) != 0;
+                row[next] ^= hi;
+            }
+
+            return anyErased;
+        }
     };
 
+    /**
+     * The 16 keys as one atomic mask, bit n set while key n is held.
+     * May be written by an input thread while the interpreter reads it.
+    **/
     class Keypad
     {
     public:
-        void pressKey(uint8_t key) { checkValSize(key, c_keysMaxBits); m_isPressed[key] = true; }
-        void releaseKey(uint8_t key) { checkValSize(key, c_keysMaxBits); m_isPressed[key] = false; }
-        bool isPressed(uint8_t key) { checkValSize(key, c_keysMaxBits); return m_isPressed[key]; }
+        void pressKey(uint8_t key) { checkValSize(key, c_keysMaxBits); m_keys.fetch_or(1 << key, std::memory_order_relaxed); }
+        void releaseKey(uint8_t key) { checkValSize(key, c_keysMaxBits); m_keys.fetch_and(~(1 << key), std::memory_order_relaxed); }
+        bool isPressed(uint8_t key) { checkValSize(key, c_keysMaxBits); return (keys() >> key) & 1; }
+
+        uint16_t keys() { return m_keys.load(std::memory_order_relaxed); }
+        void setKeys(uint16_t keys) { m_keys.store(keys, std::memory_order_relaxed); }
 
     private:
         static constexpr uint8_t k_nOfKeys = 16;
         inline static const uint8_t c_keysMaxBits =     // max no. of bits in k_nOfKeys
             static_cast<uint8_t>(ceil(log2(k_nOfKeys)));
 
-        std::vector<bool> m_isPressed { std::vector<bool>(k_nOfKeys, false) };
+        std::atomic<uint16_t> m_keys {};
     };
 }
 
@@ -0,0 +1,495 @@
+#include "debugger.h"
+
+#include <algorithm>
+#include <iomanip>
+#include <sstream>
+#include <stdexcept>
+#include <vector>
+
+#include "interpreter.h"
+
+namespace chip8
+{
+    namespace
+    {
+        const char* c_helpText =
+            "b <addr> [if <V0-VF|I> <op> <val>]  set a (conditional) breakpoint, op is one of == != < <= > >=\n"
+            "d <addr>                           delete breakpoint\n"
+            "w <addr> [len] [r|w|rw]            watch memory for reads and/or writes\n"
+            "dw <addr> [len] [r|w|rw]           stop watching memory\n"
+            "s                                  step a single instruction\n"
+            "n                                  step, running 2nnn calls to completion\n"
+            "c                                  continue\n"
+            "r                                  print registers\n"
+            "x <addr> [len]                     print memory\n"
+            "search [op]                        start a ram search, or keep the addresses whose byte changed\n"
+            "                                   as op says since the last search: == != > < +<n> -<n> =<n>\n"
+            "freeze <addr> <val>                write val to addr before every frame\n"
+            "poke <addr> <val>                  write val to addr before the next frame\n"
+            "unfreeze <addr>                    stop writing to addr\n"
+            "cheats                             list the bytes frozen or poked\n"
+            "q                                  quit\n";
+
+        uint16_t parseNumber(const std::string& token)
+        {
+            size_t used = 0;
+            unsigned long val = std::stoul(token, &used, 0);
+            if (used != token.size() || val > 0xFFFF)
+                throw std::invalid_argument(token);
+
+            return static_cast<uint16_t>(val);
+        }
+
+        uint8_t parseRegister(const std::string& token)
+        {
+            if (token == "I" || token == "i")
+                return Condition::c_regI;
+
+            if (token.size() != 2 || (token[0] != 'V' && token[0] != 'v'))
+                throw std::invalid_argument(token);
+
+            return static_cast<uint8_t>(std::stoul(token.substr(1), nullptr, 16));
+        }
+
+        Condition::Op parseOp(const std::string& token)
+        {
+            if (token == "==") return Condition::Op::Eq;
+            if (token == "!=") return Condition::Op::Ne;
+            if (token == "<")  return Condition::Op::Lt;
+            if (token == "<=") return Condition::Op::Le;
+            if (token == ">")  return Condition::Op::Gt;
+            if (token == ">=") return Condition::Op::Ge;
+
+            throw std::invalid_argument(token);
+        }
+
+        /**
+         * @returns the relation op of the search command stands for, its
+         *  operand put into operand
+        **/
+        RamSearch::Relation parseRelation(const std::string& op, uint8_t& operand)
+        {
+            if (op == "==") return RamSearch::Relation::Unchanged;
+            if (op == "!=") return RamSearch::Relation::Changed;
+            if (op == ">")  return RamSearch::Relation::Increased;
+            if (op == "<")  return RamSearch::Relation::Decreased;
+
+            if (op.size() < 2 || (op[0] != '+' && op[0] != '-' && op[0] != '='))
+                throw std::invalid_argument(op);
+
+            const uint16_t val = parseNumber(op.substr(1));
+            if (val > 0xFF)
+                throw std::invalid_argument(op);
+            operand = val;
+
+            if (op[0] == '+') return RamSearch::Relation::IncreasedBy;
+            if (op[0] == '-') return RamSearch::Relation::DecreasedBy;
+            return RamSearch::Relation::EqualTo;
+        }
+
+        uint8_t parseByte(const std::string& token)
+        {
+            const uint16_t val = parseNumber(token);
+            if (val > 0xFF)
+                throw std::invalid_argument(token);
+
+            return static_cast<uint8_t>(val);
+        }
+
+        Debugger::Access parseAccess(const std::string& token)
+        {
+            if (token == "r")  return Debugger::Access::Read;
+            if (token == "w")  return Debugger::Access::Write;
+            if (token == "rw") return Debugger::Access::ReadWrite;
+
+            throw std::invalid_argument(token);
+        }
+    }
+
+
+    bool Condition::holds(chip8::Cpu* cpu) const
+    {
+        const uint16_t lhs = reg == c_regI ? cpu->readI() : cpu->readRegister(reg);
+
+        switch (op)
+        {
+            case Op::Eq: return lhs == val;
+            case Op::Ne: return lhs != val;
+            case Op::Lt: return lhs <  val;
+            case Op::Le: return lhs <= val;
+            case Op::Gt: return lhs >  val;
+            case Op::Ge: return lhs >= val;
+        }
+
+        return false;
+    }
+
+
+    Debugger::Debugger(chip8::Interpreter& interpreter)
+        :   m_interpreter(interpreter)
+    {
+        if (m_interpreter.m_debugger)
+            throw std::runtime_error("ERROR: Interpreter already has a debugger attached");
+
+        m_interpreter.m_debugger = this;
+    }
+
+    Debugger::~Debugger()
+    {
+        m_interpreter.setTraced(false);
+        m_interpreter.m_debugger = nullptr;
+    }
+
+    void Debugger::addBreakpoint(uint16_t addr)
+    {
+        if (addr >= m_breakAt.size())
+            throw std::runtime_error("ERROR: Breakpoint address is out of memory");
+
+        m_breakAt[addr] = true;
+        m_conditions.erase(addr);
+        rearm();
+    }
+
+    void Debugger::addBreakpoint(uint16_t addr, Condition condition)
+    {
+        addBreakpoint(addr);
+        m_conditions[addr] = condition;
+    }
+
+    void Debugger::removeBreakpoint(uint16_t addr)
+    {
+        if (addr >= m_breakAt.size())
+            return;
+
+        m_breakAt[addr] = false;
+        m_conditions.erase(addr);
+        rearm();
+    }
+
+    void Debugger::addWatchpoint(uint16_t addr, uint16_t len, Access access)
+    {
+        for (uint32_t i = addr; i < static_cast<uint32_t>(addr) + len && i < m_watchRead.size(); i++)
+        {
+            if (static_cast<uint8_t>(access) & static_cast<uint8_t>(Access::Read))
+                m_watchRead[i] = true;
+            if (static_cast<uint8_t>(access) & static_cast<uint8_t>(Access::Write))
+                m_watchWrite[i] = true;
+        }
+
+        rearm();
+    }
+
+    void Debugger::removeWatchpoint(uint16_t addr, uint16_t len, Access access)
+    {
+        for (uint32_t i = addr; i < static_cast<uint32_t>(addr) + len && i < m_watchRead.size(); i++)
+        {
+            if (static_cast<uint8_t>(access) & static_cast<uint8_t>(Access::Read))
+                m_watchRead[i] = false;
+            if (static_cast<uint8_t>(access) & static_cast<uint8_t>(Access::Write))
+                m_watchWrite[i] = false;
+        }
+
+        rearm();
+    }
+
+    void Debugger::pause()
+    {
+        m_pauseRequested = true;
+        m_interpreter.setTraced(true);
+    }
+
+    void Debugger::resume()
+    {
+        m_isPaused = false;
+        m_pauseRequested = false;
+        m_stopReason = StopReason::None;
+        m_skipBreakpoint = true;
+        rearm();
+    }
+
+    void Debugger::step()
+    {
+        m_stepping = true;
+        resume();
+    }
+
+    void Debugger::stepOver()
+    {
+        chip8::Cpu* cpu = m_interpreter.cpu();
+
+        if ((m_interpreter.fetch() & 0xF000) != 0x2000)
+        {
+            step();
+            return;
+        }
+
+        m_steppingOver = true;
+        m_stepOverAddr = cpu->readPC() + 2;
+        m_stepOverDepth = cpu->stackDepth();
+        resume();
+    }
+
+    bool Debugger::beforeExecute(uint16_t pc)
+    {
+        if (m_isPaused)
+            return false;
+
+        if (m_pauseRequested.load(std::memory_order_relaxed))
+        {
+            m_pauseRequested = false;
+            stop(StopReason::Pause);
+            return false;
+        }
+
+        if (m_skipBreakpoint)
+        {
+            m_skipBreakpoint = false;
+            return true;
+        }
+
+        if (m_steppingOver && pc == m_stepOverAddr &&
+            m_interpreter.cpu()->stackDepth() <= m_stepOverDepth)
+        {
+            m_steppingOver = false;
+            stop(StopReason::Step);
+            return false;
+        }
+
+        if (pc < m_breakAt.size() && m_breakAt[pc])
+        {
+            auto condition = m_conditions.find(pc);
+            if (condition == m_conditions.end() || condition->second.holds(m_interpreter.cpu()))
+            {
+                stop(StopReason::Breakpoint);
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    bool Debugger::afterExecute()
+    {
+        if (m_watchHit)
+        {
+            m_watchHit = false;
+            m_stepping = false;
+            stop(StopReason::Watchpoint);
+            return false;
+        }
+
+        if (m_stepping)
+        {
+            m_stepping = false;
+            stop(StopReason::Step);
+            return false;
+        }
+
+        return true;
+    }
+
+    void Debugger::rearm()
+    {
+        if (!armed())
+            m_skipBreakpoint = false;
+
+        m_interpreter.setTraced(armed());
+
+        // a pause() from another thread may have raced the store above
+        if (m_pauseRequested)
+            m_interpreter.setTraced(true);
+    }
+
+    void Debugger::stop(StopReason reason)
+    {
+        m_isPaused = true;
+        m_stopReason = reason;
+        rearm();
+    }
+
+    void Debugger::printStop(std::ostream& out)
+    {
+        const uint16_t pc = m_interpreter.cpu()->readPC();
+
+        out << std::hex << std::setfill('0')
+            << "stopped at 0x" << std::setw(3) << pc
+            << " [" << std::setw(4) << m_interpreter.fetch() << "]";
+
+        switch (m_stopReason)
+        {
+            case StopReason::Pause: out << " (paused)"; break;
+            case StopReason::Breakpoint: out << " (breakpoint)"; break;
+            case StopReason::Step: out << " (step)"; break;
+            case StopReason::Watchpoint:
+                out << " (" << (m_watchAccess == Access::Read ? "read of" : "write to")
+                    << " 0x" << std::setw(3) << m_watchAddr << ")";
+                break;
+
+            default:
+                break;
+        }
+
+        out << std::dec << std::setfill(' ') << '\n';
+    }
+
+    void Debugger::printRegisters(std::ostream& out)
+    {
+        chip8::Cpu* cpu = m_interpreter.cpu();
+
+        out << std::hex << std::setfill('0');
+        for (uint8_t i = 0; i < 16; i++)
+            out << 'V' << std::uppercase << static_cast<int>(i) << std::nouppercase << ' ' << std::setw(2)
+                << static_cast<int>(cpu->readRegister(i)) << (i % 8 == 7 ? '\n' : ' ');
+
+        out << "I "   << std::setw(4) << cpu->readI()
+            << " PC " << std::setw(4) << cpu->readPC()
+            << " SP " << cpu->stackDepth()
+            << " DT " << std::setw(2) << static_cast<int>(cpu->delayTimer())
+            << " ST " << std::setw(2) << static_cast<int>(cpu->soundTimer()) << '\n';
+        out << std::dec << std::setfill(' ');
+    }
+
+    void Debugger::printMemory(std::ostream& out, uint16_t addr, uint16_t len)
+    {
+        chip8::Memory* memory = m_interpreter.memory();
+        const uint32_t end = std::min<uint32_t>(static_cast<uint32_t>(addr) + len, memory->size());
+
+        out << std::hex << std::setfill('0');
+        for (uint32_t row = addr; row < end; row += 16)
+        {
+            out << "0x" << std::setw(3) << row << ':';
+            for (uint32_t i = row; i < row + 16 && i < end; i++)
+                out << ' ' << std::setw(2) << static_cast<int>(memory->read(i));
+            out << '\n';
+        }
+        out << std::dec << std::setfill(' ');
+    }
+
+    Debugger::PromptResult Debugger::runCommand(const std::string& line, std::ostream& out)
+    {
+        std::istringstream tokens{line};
+        std::string cmd;
+        if (!(tokens >> cmd))
+            return PromptResult::Stay;
+
+        std::vector<std::string> args;
+        for (std::string arg; tokens >> arg;)
+            args.push_back(arg);
+
+        try
+        {
+            if (cmd == "b" && (args.size() == 1 || args.size() == 5) && (args.size() == 1 || args[1] == "if"))
+            {
+                if (args.size() == 1)
+                    addBreakpoint(parseNumber(args[0]));
+                else
+                    addBreakpoint(parseNumber(args[0]),
+                        Condition{parseRegister(args[2]), parseOp(args[3]), parseNumber(args[4])});
+            }
+            else if (cmd == "d" && args.size() == 1)
+                removeBreakpoint(parseNumber(args[0]));
+            else if ((cmd == "w" || cmd == "dw") && !args.empty() && args.size() <= 3)
+            {
+                const uint16_t addr = parseNumber(args[0]);
+                const uint16_t len = args.size() > 1 ? parseNumber(args[1]) : 1;
+                const Access access = args.size() > 2 ? parseAccess(args[2]) : Access::ReadWrite;
+
+                cmd == "w" ? addWatchpoint(addr, len, access) : removeWatchpoint(addr, len, access);
+            }
+            else if (cmd == "s" && args.empty())
+            {
+                step();
+                return PromptResult::Resumed;
+            }
+            else if (cmd == "n" && args.empty())
+            {
+                stepOver();
+                return PromptResult::Resumed;
+            }
+            else if (cmd == "c" && args.empty())
+            {
+                resume();
+                return PromptResult::Resumed;
+            }
+            else if (cmd == "r" && args.empty())
+                printRegisters(out);
+            else if (cmd == "x" && !args.empty() && args.size() <= 2)
+                printMemory(out, parseNumber(args[0]), args.size() > 1 ? parseNumber(args[1]) : 16);
+            else if (cmd == "search" && args.size() <= 1)
+                search(args.empty() ? "" : args[0], out);
+            else if ((cmd == "freeze" || cmd == "poke" || cmd == "unfreeze" || cmd == "cheats") && !m_cheats)
+                out << "no cheats while debugging this machine\n";
+            else if ((cmd == "freeze" || cmd == "poke") && args.size() == 2)
+            {
+                const uint16_t addr = parseNumber(args[0]);
+                const uint8_t val = parseByte(args[1]);
+                if (addr >= m_interpreter.memory()->size())
+                    throw std::out_of_range(args[0]);
+
+                cmd == "freeze" ? m_cheats->freeze(addr, val) : m_cheats->poke(addr, val);
+            }
+            else if (cmd == "unfreeze" && args.size() == 1)
+            {
+                if (!m_cheats->remove(parseNumber(args[0])))
+                    out << "nothing written to " << args[0] << '\n';
+            }
+            else if (cmd == "cheats" && args.empty())
+                m_cheats->print(out);
+            else if (cmd == "q" && args.empty())
+                return PromptResult::Quit;
+            else if (cmd == "h" || cmd == "help")
+                out << c_helpText;
+            else
+                out << "unknown command: " << line << " (try h)\n";
+        }
+        catch (const std::exception&)
+        {
+            out << "invalid arguments: " << line << '\n';
+        }
+
+        return PromptResult::Stay;
+    }
+
+    void Debugger::search(const std::string& op, std::ostream& out)
+    {
+        // few enough to look at one by one
+        constexpr size_t k_maxListed = 16;
+
+        size_t count = 0;
+        if (op.empty())
+        {
+            m_search.start(*m_interpreter.memory());
+            count = m_search.count();
+        }
+        else
+        {
+            uint8_t operand = 0;
+            const RamSearch::Relation relation = parseRelation(op, operand);
+            count = m_search.filter(*m_interpreter.memory(), relation, operand);
+        }
+
+        out << count << " candidates\n";
+        if (count == 0 || count > k_maxListed)
+            return;
+
+        out << std::hex << std::setfill('0');
+        for (uint16_t addr : m_search.candidates())
+            out << "0x" << std::setw(3) << addr << ": " << std::setw(2) << static_cast<int>(m_search.value(addr)) << '\n';
+        out << std::dec << std::setfill(' ');
+    }
+
+    Debugger::PromptResult Debugger::prompt(std::istream& in, std::ostream& out)
+    {
+        std::string line;
+        while (true)
+        {
+            out << "(chip8) " << std::flush;
+            if (!std::getline(in, line))
+                return PromptResult::EndOfInput;
+
+            const PromptResult result = runCommand(line, out);
+            if (result != PromptResult::Stay)
+                return result;
+        }
+    }
+}
@@ -0,0 +1,194 @@
+#ifndef DEBUGGER_H
+#define DEBUGGER_H
+
+#include <stdint.h>
+
+#include <atomic>
+#include <bitset>
+#include <iostream>
+#include <map>
+#include <string>
+
+#include "chip8.h"
+#include "cheats.h"
+
+namespace chip8
+{
+    class Interpreter;
+
+    /**
+     * condition on a register attached to a breakpoint, e.g. V3 == 0x10
+    **/
+    struct Condition
+    {
+        enum class Op { Eq, Ne, Lt, Le, Gt, Ge };
+
+        inline static const uint8_t c_regI = 16; // reg value refering to I instead of V0-VF
+
+        uint8_t reg;
+        Op op;
+        uint16_t val;
+
+        bool holds(chip8::Cpu* cpu) const;
+    };
+
+    /**
+     * Breakpoints, watchpoints and stepping for an Interpreter.
+     *
+     * Breakpoints are checked before an instruction is dispatched and
+     * watchpoints on every data access to memory, both through bitmaps over
+     * the address space. Whenever nothing is armed the interpreter is switched
+     * back to its untraced dispatch so a detached or idle debugger costs nothing.
+    **/
+    class Debugger
+    {
+    public:
+        enum class Access : uint8_t { Read = 1, Write = 2, ReadWrite = 3 };
+
+        enum class PromptResult { Stay, Resumed, Quit, EndOfInput };
+
+        enum class StopReason { None, Pause, Breakpoint, Watchpoint, Step };
+
+        /**
+         * attaches to interpreter, which has to outlive the debugger
+        **/
+        Debugger(chip8::Interpreter& interpreter);
+        ~Debugger();
+
+        Debugger(const Debugger&) = delete;
+        Debugger& operator=(const Debugger&) = delete;
+
+        void addBreakpoint(uint16_t addr);
+        void addBreakpoint(uint16_t addr, Condition condition);
+        void removeBreakpoint(uint16_t addr);
+
+        /**
+         * watches [addr, addr + len) for the given kind of access
+        **/
+        void addWatchpoint(uint16_t addr, uint16_t len, Access access);
+        void removeWatchpoint(uint16_t addr, uint16_t len, Access access);
+
+        /**
+         * stops before the next instruction.
+         * unlike the rest of the debugger this may be called from any thread.
+        **/
+        void pause();
+
+        void resume();
+
+        /**
+         * executes a single instruction, then stops
+        **/
+        void step();
+
+        /**
+         * like step, but runs a 2nnn subroutine call to completion
+        **/
+        void stepOver();
+
+        bool isPaused() const { return m_isPaused; }
+
+        StopReason stopReason() const { return m_stopReason; }
+
+        /**
+         * address and kind of the access that stopped the machine,
+         * valid if stopReason() is Watchpoint
+        **/
+        uint16_t watchAddr() const { return m_watchAddr; }
+        Access watchAccess() const { return m_watchAccess; }
+
+        void printStop(std::ostream& out);
+        void printRegisters(std::ostream& out);
+        void printMemory(std::ostream& out, uint16_t addr, uint16_t len);
+
+        /**
+         * @param cheats patched by the freeze, poke and unfreeze commands,
+         *  applied between frames by whoever runs them, nullptr for none
+        **/
+        void setCheats(chip8::CheatList* cheats) { m_cheats = cheats; }
+
+        /**
+         * parses and runs a single debugger command, see `help`
+         * @returns
+         *  Resumed if the command continues execution, Quit if it asks to
+         *  exit, Stay otherwise
+        **/
+        PromptResult runCommand(const std::string& line, std::ostream& out);
+
+        /**
+         * reads and runs commands from in till one of them continues execution
+        **/
+        PromptResult prompt(std::istream& in, std::ostream& out);
+
+        // hooks for the interpreter's traced dispatch
+
+        /**
+         * @returns false if the instruction at pc must not run yet
+        **/
+        bool beforeExecute(uint16_t pc);
+
+        /**
+         * @returns false if the last instruction stopped the machine
+        **/
+        bool afterExecute();
+
+        /**
+         * @param access either Read or Write, of a valid address
+        **/
+        void onAccess(uint16_t addr, Access access)
+        {
+            if ((access == Access::Read ? m_watchRead : m_watchWrite)[addr])
+            {
+                m_watchHit = true;
+                m_watchAddr = addr;
+                m_watchAccess = access;
+            }
+        }
+
+    private:
+        chip8::Interpreter& m_interpreter;
+
+        std::bitset<chip8::Memory::maxSize()> m_breakAt {};
+        std::map<uint16_t, Condition> m_conditions {};
+
+        std::bitset<chip8::Memory::maxSize()> m_watchRead {};
+        std::bitset<chip8::Memory::maxSize()> m_watchWrite {};
+
+        bool m_isPaused {};
+        std::atomic<bool> m_pauseRequested {};
+        bool m_stepping {};
+
+        // step over, stops at m_stepOverAddr unless deeper in the call stack
+        bool m_steppingOver {};
+        uint16_t m_stepOverAddr {};
+        size_t m_stepOverDepth {};
+
+        // lets a resume execute the instruction a breakpoint stopped at
+        bool m_skipBreakpoint {};
+
+        bool m_watchHit {};
+        uint16_t m_watchAddr {};
+        Access m_watchAccess {};
+
+        StopReason m_stopReason {StopReason::None};
+
+        chip8::RamSearch m_search {};
+        chip8::CheatList* m_cheats {};
+
+        bool armed() const
+        {
+            return  m_isPaused || m_pauseRequested || m_stepping || m_steppingOver ||
+                    m_breakAt.any() || m_watchRead.any() || m_watchWrite.any();
+        }
+
+        /**
+         * runs the search command, op as its argument, empty to start over
+        **/
+        void search(const std::string& op, std::ostream& out);
+
+        void rearm();
+        void stop(StopReason reason);
+    };
+}
+
+#endif /* DEBUGGER_H */
@@ -1,25 +1,38 @@
 #ifndef DRIVERS_H
 #define DRIVERS_H
 
+#include <string.h>
+#include <math.h>
+
+#include <algorithm>
 #include <vector>
 
 #include "emuGL.h"
+#include "scaler.h"
 #include "window.h"
 #include "color.h"
 #include "theme.h"
+#include "latency.h"
 
 namespace drivers
 {
+    /**
+     * @returns no. of planes in frame, see chip8::Display::screenBuffer()
+    **/
+    inline uint8_t planes(const std::vector<uint64_t>& frame, uint16_t wordsPerRow, uint16_t height)
+    {
+        return frame.size() / (static_cast<size_t>(wordsPerRow) * height);
+    }
+
     class Display
     {
     public:
 
         Display(uint16_t scale, uint16_t chip8Width, uint16_t chip8Height)
+            :   m_scaler{chip8Width, chip8Height, scale, theme::foregroundColor, theme::backgroundColor},
+                m_chip8Height(chip8Height)
         {
-            // initialising rects
-            for (int i = 0; i < chip8Height; i++)
-                for (int j = 0; j < chip8Width; j++)
-                    m_pixels.push_back(new emuGL::Rect{scale, scale, {j * scale, i * scale}});
+            m_scaler.setPlaneColors(theme::secondPlaneColor, theme::bothPlanesColor);
 
             m_window = new emuGL::Window
             {
@@ -28,16 +41,10 @@ namespace drivers
                 chip8Height * scale,
                 emuGL::Colors::white
             };
-            // attaching rects to window
-            for (auto& pixel : m_pixels)
-                m_window->attach(*pixel);
         }
 
         ~Display()
         {
-            for (auto& pixel : m_pixels)
-                delete pixel;
-
             delete m_window;
         }
 
@@ -45,25 +52,148 @@ namespace drivers
         Display(const Display&) = delete;
         Display& operator=(const Display&) = delete;
 
-        void updateDisplay(chip8::Display* chip8Display)
+        /**
+         * @param frame packed like chip8::Display::screenBuffer()
+        **/
+        void updateDisplay(const std::vector<uint64_t>& frame, uint16_t wordsPerRow)
         {
-            const std::vector< std::vector<bool> >& screenBuffer = chip8Display->screenBuffer();
-            // updating pixels
-            for (uint8_t i = 0; i < screenBuffer.size(); i++)
-                for (uint8_t j = 0; j < screenBuffer[i].size(); j++)
-                {
-                    if (screenBuffer[i][j])
-                        m_pixels.at(i * screenBuffer[i].size() + j)->setFillColor(theme::foregroundColor);
-                    else
-                        m_pixels.at(i * screenBuffer[i].size() + j)->setFillColor(theme::backgroundColor);
-                }
-            
-            m_window->update();
+            m_scaler.scale(frame.data(), wordsPerRow, planes(frame, wordsPerRow, m_chip8Height));
+            m_window->present(m_scaler.pixels(), m_scaler.width(), m_scaler.height());
         }
 
+        /**
+         * see FrameScaler::setFilter()
+        **/
+        void setFilter(emuGL::FrameScaler::Upscale upscale, uint8_t persistence) { m_scaler.setFilter(upscale, persistence); }
+
     private:
         emuGL::Window* m_window;
-        std::vector<emuGL::Rect*> m_pixels;
+        emuGL::FrameScaler m_scaler;
+        uint16_t m_chip8Height;
+    };
+
+    /**
+     * Frames of many machines tiled into one window, e.g. to watch a whole
+     * batch run.
+     *
+     * All tiles are kept in one image, the atlas, that is streamed into a
+     * single texture and drawn with a single copy. A tile is only expanded
+     * into the atlas when its machine's frame changed since it was last
+     * shown, and only the rows of tiles changed are uploaded.
+    **/
+    class Wall
+    {
+    public:
+        /**
+         * @param count no. of tiles, laid out in a grid about as wide as high
+         * @param chip8Width, chip8Height size of a frame in pixels
+        **/
+        Wall(size_t count, uint16_t chip8Width, uint16_t chip8Height)
+            :   m_columns(ceil(sqrt(count))),
+                m_tileWidth(chip8Width),
+                m_tileHeight(chip8Height),
+                m_atlasWidth(m_columns * (chip8Width + k_gap) + k_gap),
+                m_atlasHeight((count + m_columns - 1) / m_columns * (chip8Height + k_gap) + k_gap),
+                m_scaler{chip8Width, chip8Height, 1, theme::foregroundColor, theme::backgroundColor},
+                m_atlas(m_atlasWidth * m_atlasHeight, packRgba(emuGL::Colors::black)),
+                m_shown(count)
+        {
+            m_scaler.setPlaneColors(theme::secondPlaneColor, theme::bothPlanesColor);
+
+            const int scale = std::max(1, std::min(k_maxWindowWidth / m_atlasWidth, k_maxWindowHeight / m_atlasHeight));
+
+            m_window = new emuGL::Window
+            {
+                "Chip 8 - " + std::to_string(count) + " machines",
+                m_atlasWidth * scale,
+                m_atlasHeight * scale,
+                emuGL::Colors::black
+            };
+
+            // the gaps between tiles go up once, with the first present
+            m_window->setTextureSize(m_atlasWidth, m_atlasHeight);
+            m_dirtyTop = 0;
+            m_dirtyBottom = m_atlasHeight;
+        }
+
+        ~Wall()
+        {
+            delete m_window;
+        }
+
+        Wall() = delete;
+        Wall(const Wall&) = delete;
+        Wall& operator=(const Wall&) = delete;
+
+        /**
+         * puts a machine's frame into its tile, shown with the next present()
+         * @param frame packed like chip8::Display::screenBuffer()
+        **/
+        void show(size_t tile, const std::vector<uint64_t>& frame, uint16_t wordsPerRow)
+        {
+            std::vector<uint64_t>& shown = m_shown[tile];
+            if (shown.size() == frame.size() && memcmp(shown.data(), frame.data(), frame.size() * sizeof(uint64_t)) == 0)
+                return;
+            shown = frame;
+
+            m_scaler.scale(frame.data(), wordsPerRow, planes(frame, wordsPerRow, m_tileHeight));
+
+            const int x = tile % m_columns * (m_tileWidth + k_gap) + k_gap;
+            const int y = tile / m_columns * (m_tileHeight + k_gap) + k_gap;
+            for (int row = 0; row < m_tileHeight; row++)
+                memcpy(&m_atlas[(y + row) * m_atlasWidth + x], m_scaler.pixels() + row * m_scaler.width(),
+                       m_tileWidth * sizeof(uint32_t));
+
+            m_dirtyTop = std::min(m_dirtyTop, y);
+            m_dirtyBottom = std::max(m_dirtyBottom, y + m_tileHeight);
+        }
+
+        /**
+         * uploads the rows of the tiles changed and draws the atlas
+        **/
+        void present()
+        {
+            if (m_dirtyTop < m_dirtyBottom)
+                m_window->updateTextureRows(&m_atlas[m_dirtyTop * m_atlasWidth], m_dirtyTop, m_dirtyBottom - m_dirtyTop);
+
+            m_dirtyTop = m_atlasHeight;
+            m_dirtyBottom = 0;
+
+            m_window->presentTexture();
+        }
+
+    private:
+        // atlas pixels between and around the tiles
+        static constexpr int k_gap = 1;
+
+        // the window is as big as fits in this
+        static constexpr int k_maxWindowWidth = 1600;
+        static constexpr int k_maxWindowHeight = 900;
+
+        int m_columns;
+        int m_tileWidth;
+        int m_tileHeight;
+        int m_atlasWidth;
+        int m_atlasHeight;
+
+        emuGL::Window* m_window;
+        emuGL::FrameScaler m_scaler;
+
+        std::vector<uint32_t> m_atlas;              // RGBA, like FrameScaler::pixels()
+        std::vector<std::vector<uint64_t>> m_shown; // per tile, the frame in the atlas
+
+        // rows of the atlas changed since the last present, none if top >= bottom
+        int m_dirtyTop;
+        int m_dirtyBottom;
+
+        static uint32_t packRgba(const emuGL::Color& color)
+        {
+            const uint8_t bytes[4] { color.red(), color.green(), color.blue(), color.alpha() };
+
+            uint32_t packed;
+            memcpy(&packed, bytes, sizeof(packed));
+            return packed;
+        }
     };
 
     class Input
@@ -100,16 +230,41 @@ namespace drivers
                 if (chip8Key != 16)
                 {
                     const uint8_t chip8Key8Bit = static_cast<uint8_t>(chip8Key);
-                    nextKeyInput->type == emuGL::KeyEvent::Pressed ?
+                    const bool isPress = nextKeyInput->type == emuGL::KeyEvent::Pressed;
+                    const bool wasPressed = chip8KeyPad->isPressed(chip8Key8Bit);
+
+                    isPress ?
                         chip8KeyPad->pressKey(chip8Key8Bit) :
                         chip8KeyPad->releaseKey(chip8Key8Bit);
+
+                    // key repeats change nothing
+                    if (m_latency && isPress != wasPressed)
+                        m_latency->keyApplied(chip8Key8Bit, eventTime(*nextKeyInput));
                 }
             }
             
         }
 
+        /**
+         * @param latency told about every key applied to the keypad, nullptr to stop
+        **/
+        void setLatencyTracker(chip8::LatencyTracker* latency) { m_latency = latency; }
+
     private:
         emuGL::InputHandler* m_inputHandler { new emuGL::InputHandler{}};
+        chip8::LatencyTracker* m_latency {};
+
+        /**
+         * @returns when the host saw keyInput, on the tracker's clock
+        **/
+        chip8::LatencyTracker::Clock::time_point eventTime(const emuGL::KeyInput& keyInput)
+        {
+            const uint32_t now = emuGL::InputHandler::ticks();
+            const uint32_t age = now > keyInput.timestamp ? now - keyInput.timestamp : 0;
+
+            return chip8::LatencyTracker::Clock::now() - std::chrono::milliseconds(age);
+        }
+
         /**
          * @returns 16 if non-chip8 key pressed, otherwise chip8 key pressed
         */
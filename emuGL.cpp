@@ -135,7 +135,8 @@ namespace emuGL
     {
         return new KeyInput{
             sdlEvent.key.type == SDL_KEYDOWN ? KeyEvent::Pressed : KeyEvent::Released,
-            scanCodeFromSdlEvent(sdlEvent)
+            scanCodeFromSdlEvent(sdlEvent),
+            sdlEvent.key.timestamp
         }; 
     }
 }
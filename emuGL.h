@@ -114,6 +114,7 @@ namespace emuGL
     {
         KeyEvent type;
         KeyScanCode keyCode;
+        uint32_t timestamp; // ms, on the InputHandler::ticks() clock
     };
 
 
@@ -121,6 +122,11 @@ namespace emuGL
     {
     public:
 
+        /**
+         * @returns ms since the input handler's clock started
+        **/
+        static uint32_t ticks() { return SDL_GetTicks(); }
+
         bool quitIntent() const
         {
             SDL_PumpEvents();
@@ -5,8 +5,22 @@
 #include <fstream>
 #include <ios>
 #include <chrono>
+#include <thread>
+#include <atomic>
+#include <optional>
 
 #include "chip8.h"
+#include "interpreter.h"
+#include "rom.h"
+#include "analysiscache.h"
+#include "cheats.h"
+#include "movie.h"
+#include "stats.h"
+#include "framering.h"
+#include "debugger.h"
+#include "gdbstub.h"
+#include "capture.h"
+#include "triplebuffer.h"
 #include "window.h"
 #include "drivers.h"
 
@@ -15,320 +29,576 @@ namespace chip8
     class Emulator
     {
     public:
-        Emulator(uint16_t scale, std::string romPath)
-            :   m_romStream{romPath, std::ios::in | std::ios::binary},
-                m_chip8Memory(new chip8::Memory{m_romStream}),
-                m_chip8Cpu(new chip8::Cpu{}),
-                m_chip8Keypad(new chip8::Keypad{}),
-                m_chip8Display(new chip8::Display{}),
-                m_displayDriver(new drivers::Display{scale, m_chip8Display->width(), m_chip8Display->height()}),
-                m_inputDriver(new drivers::Input{})
+        /**
+         * @param isHeadless
+         *  if true no window is opened and no host input is read,
+         *  the rom is then run through runHeadless()
+         * @param analysisCache where the rom's analysis is looked up, and
+         *  added if missing, nullptr to analyse it anew
+         * @param platform to run the rom on, the one detected if not given
+        **/
+        Emulator(uint16_t scale, std::string romPath, bool isHeadless = false, chip8::AnalysisCache* analysisCache = nullptr,
+                 std::optional<chip8::Platform> platform = std::nullopt)
+            :   m_scale(scale),
+                m_interpreter(loadRom(romPath, analysisCache, platform)),
+                m_frames{Frame{m_interpreter->display()->screenBuffer(), 0}},
+                m_displayDriver(isHeadless ? nullptr : new drivers::Display{scale, m_interpreter->display()->width(), m_interpreter->display()->height()}),
+                m_inputDriver(isHeadless ? nullptr : new drivers::Input{})
         { }
 
         ~Emulator()
         {
-            delete m_chip8Display;
-            delete m_chip8Memory;
-            delete m_chip8Cpu;
-            delete m_chip8Keypad;
+            delete m_frameRing;
+            delete m_stats;
+            delete m_movie;
+            delete m_inputRecording;
+            delete m_latency;
+            delete m_recorder;
+            delete m_gdbServer;
+            delete m_debugger;
+            delete m_interpreter;
 
             delete m_displayDriver;
             delete m_inputDriver;
         }
 
-        void run()
+        /**
+         * attaches a debugger that stops before the first instruction.
+         * whenever it stops, commands are read from script till it runs out,
+         * then from stdin.
+        **/
+        void enableDebugger(std::string scriptPath = "")
         {
-            std::chrono::time_point<std::chrono::steady_clock> fpsTimer { std::chrono::steady_clock::now() };
-	        std::chrono::duration<int32_t, std::ratio<1, 60>> FPS {};
+            if (!m_debugger)
+                m_debugger = new chip8::Debugger{*m_interpreter};
+            m_debugger->setCheats(&m_cheats);
 
-            uint16_t pc = m_chip8Memory->romStartAddress();
-            m_chip8Cpu->writePC(pc);
+            if (!scriptPath.empty())
+            {
+                m_debugScript.open(scriptPath);
+                if (!m_debugScript.good())
+                    throw std::runtime_error("ERROR: Unable to open debugger script!");
+            }
+
+            m_debugger->pause();
+        }
+
+        /**
+         * serves the gdb remote protocol on address, see GdbServer::listen.
+         * the rom runs freely until a client attaches.
+        **/
+        void enableGdbServer(std::string address)
+        {
+            if (!m_debugger)
+                m_debugger = new chip8::Debugger{*m_interpreter};
+            m_debugger->setCheats(&m_cheats);
+
+            m_gdbServer = new chip8::GdbServer{*m_interpreter, *m_debugger};
+            m_gdbServer->listen(address);
+        }
+
+        /**
+         * records every 60Hz frame to path, as GIF if it ends in .gif and as
+         * Y4M otherwise. frames are encoded on a worker thread, policy says
+         * whether the rom waits for it or frames are dropped when it lags.
+         * headless the rom always waits, nothing keeps it to 60Hz but the encoder.
+         * the no. of frames dropped is printed when the rom stops.
+        **/
+        void startRecording(std::string path, emuGL::VideoRecorder::FullPolicy policy = emuGL::VideoRecorder::FullPolicy::Drop)
+        {
+            chip8::Display* display = m_interpreter->display();
+            if (!m_displayDriver)
+                policy = emuGL::VideoRecorder::FullPolicy::Block;
+
+            delete m_recorder;
+            m_recorder = new emuGL::VideoRecorder{path, display->width(), display->height(), m_scale,
+                                                  theme::foregroundColor, theme::backgroundColor, policy};
+        }
+
+        /**
+         * follows key presses from the host event to the frame showing their
+         * effect, histograms of each step are written to path as JSON when
+         * run() returns. only useful with a window.
+        **/
+        void enableLatencyTracking(std::string path)
+        {
+            if (!m_latency)
+                m_latency = new chip8::LatencyTracker{};
+
+            m_latencyPath = path;
+            m_interpreter->setLatencyTracker(m_latency);
+            if (m_inputDriver)
+                m_inputDriver->setLatencyTracker(m_latency);
+        }
+
+        /**
+         * holds the keys of the movie at path each frame instead of the
+         * ones pressed, e.g. to replay a run headless
+        **/
+        void playMovie(std::string path)
+        {
+            delete m_movie;
+            m_movie = new chip8::InputMovie{path};
+        }
 
-            while (!m_inputDriver->shouldQuit())
+        /**
+         * records the keys held each frame to a movie, written to path
+         * when the rom stops
+        **/
+        void recordInput(std::string path)
+        {
+            if (!m_inputRecording)
+                m_inputRecording = new chip8::InputMovie{};
+
+            m_inputRecordingPath = path;
+        }
+
+        /**
+         * publishes live counters to a shared memory segment named after
+         * this process while the rom runs, for chip8-top to show
+         * @param romName shown by chip8-top
+         * @throws runtime_error if the segment cannot be created
+        **/
+        void enableStats(std::string romName)
+        {
+            delete m_stats;
+            m_stats = new chip8::StatsPublisher{romName};
+        }
+
+        /**
+         * publishes every frame to a shared memory ring named after this
+         * process, for other processes to read without copying, see FrameRingView
+         * @param slots no. of frames kept in the ring
+         * @throws runtime_error if the ring cannot be created
+        **/
+        void enableFrameRing(uint32_t slots)
+        {
+            delete m_frameRing;
+            m_frameRing = new chip8::FramePublisher{*m_interpreter->display(), slots};
+        }
+
+        /**
+         * writes val to addr before every frame, see CheatList
+         * @throws runtime_error if addr is past the rom's memory
+        **/
+        void freeze(uint16_t addr, uint8_t val)
+        {
+            if (addr >= m_interpreter->memory()->size())
+                throw std::runtime_error("ERROR: Cheat address is out of memory");
+
+            m_cheats.freeze(addr, val);
+        }
+
+        /**
+         * see Interpreter::setEngine()
+        **/
+        void setEngine(chip8::Interpreter::Engine engine) { m_interpreter->setEngine(engine); }
+
+        /**
+         * post-processes the frames shown in the window and the headless
+         * image, see FrameScaler::setFilter(). recordings stay unfiltered.
+         * @throws runtime_error if upscaling a frame whose width is no multiple of 64
+        **/
+        void setFilter(emuGL::FrameScaler::Upscale upscale, uint8_t persistence)
+        {
+            m_upscale = upscale;
+            m_persistence = persistence;
+
+            if (m_displayDriver)
+                m_displayDriver->setFilter(upscale, persistence);
+        }
+
+        /**
+         * shows every frame as it will look frames frames later with the keys
+         * held now, hiding that many frames of the rom's own input lag.
+         * the time it takes is printed when the rom stops. not used while a
+         * debugger is attached.
+        **/
+        void setRunAhead(uint32_t frames) { m_runAheadFrames = frames; }
+
+        /**
+         * the length of a 60Hz frame in instructions, how fast the rom runs.
+         * the timers tick once a frame. instructionsPerFrameFor() the
+         * rom's platform unless set.
+        **/
+        void setInstructionsPerFrame(uint32_t instructions) { m_instructionsPerFrame = instructions; }
+
+        /**
+         * runs the rom on an emulation thread while this thread reads host
+         * input into the keypad and presents the frames it publishes.
+         * returns once the window is closed, the debugger quits or the rom faults.
+         * @returns false if the rom faulted, the fault is printed
+        **/
+        bool run()
+        {
+            m_shouldStop = false;
+            m_isEmulationDone = false;
+            std::thread emulation{&Emulator::emulate, this};
+
+            while (!m_inputDriver->shouldQuit() && !m_isEmulationDone.load(std::memory_order_acquire))
             {
-                FPS = std::chrono::duration_cast<std::chrono::duration<int32_t, std::ratio<1, 60>>>(
-                    std::chrono::steady_clock::now() - fpsTimer
-                );
+                m_inputDriver->updateKeyStates(m_interpreter->keypad());
 
-                if (FPS.count() >= 1)
+                if (m_frames.update())
                 {
-                    fpsTimer = std::chrono::steady_clock::now();
-
-                    const uint8_t dt = m_chip8Cpu->delayTimer();
-                    if (dt > 0)
-                        m_chip8Cpu->setDelayTimer(dt - 1);
+                    m_displayDriver->updateDisplay(m_frames.front().pixels, m_interpreter->display()->wordsPerRow());
 
-                    const uint8_t st = m_chip8Cpu->soundTimer();
-                    if (st > 0)
-                        m_chip8Cpu->setSoundTimer(st - 1);
+                    if (m_latency)
+                        m_latency->framePresented(m_frames.front().number);
                 }
+                else
+                    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
 
-                pc = m_chip8Cpu->readPC();
+            m_shouldStop = true;
+            emulation.join();
 
-                uint16_t instruction = m_chip8Memory->read(pc);
-                instruction <<= 8;
-                instruction |= m_chip8Memory->read(pc + 1);
+            printRunAheadStats();
 
-                std::cout << std::hex << pc << " : " <<  instruction << '\n';
+            if (m_latency)
+                m_latency->writeJson(m_latencyPath);
 
-                execute(instruction);
+            if (m_inputRecording)
+                m_inputRecording->save(m_inputRecordingPath);
 
-                m_inputDriver->updateKeyStates(m_chip8Keypad);
-                m_displayDriver->updateDisplay(m_chip8Display);
+            return finish();
+        }
 
-            }
+        /**
+         * runs the rom without a window for the given no. of 60Hz frames,
+         * then writes the last frame to framePath, as PNG if it ends in .png
+         * and as PPM otherwise. the frame is the real one, run-ahead only
+         * changes what a window would show.
+         * runs as fast as the host can, frames being counted in
+         * instructions the result does not depend on it.
+         * a rom that faults stops there, with its frame as the last one.
+         * @returns false if the rom faulted, the fault is printed
+        **/
+        bool runHeadless(uint32_t frames, std::string framePath)
+        {
+            startFrame();
+
+            for (uint32_t frame = 0; frame < frames; frame++)
+                if (!runFrame())
+                    break;
+
+            chip8::Display* display = m_interpreter->display();
+            emuGL::FrameScaler scaler{display->width(), display->height(), m_scale, theme::foregroundColor, theme::backgroundColor};
+            scaler.setFilter(m_upscale, m_persistence);
+            scaler.setPlaneColors(theme::secondPlaneColor, theme::bothPlanesColor);
+
+            scaler.scale(display->screenBuffer().data(), display->wordsPerRow(), display->planes());
+            scaler.writeImage(framePath);
+
+            printRunAheadStats();
+
+            if (m_inputRecording)
+                m_inputRecording->save(m_inputRecordingPath);
+
+            return finish();
         }
         
     private:
-        std::ifstream m_romStream;
+        uint16_t m_scale;
+
+        chip8::Interpreter* m_interpreter {};
+        chip8::Debugger* m_debugger {};
+        std::ifstream m_debugScript;
+        chip8::GdbServer* m_gdbServer {};
+        emuGL::VideoRecorder* m_recorder {};
+
+        emuGL::FrameScaler::Upscale m_upscale { emuGL::FrameScaler::Upscale::None };
+        uint8_t m_persistence {};
+
+        struct Frame
+        {
+            std::vector<uint64_t> pixels;
+            uint64_t number;
+        };
+
+        // frames from the emulation thread to the presenting one
+        emuGL::TripleBuffer<Frame> m_frames;
+        uint64_t m_frameCount {};
+
+        chip8::LatencyTracker* m_latency {};
+        std::string m_latencyPath;
+
+        chip8::InputMovie* m_movie {};
+        chip8::InputMovie* m_inputRecording {};
+        std::string m_inputRecordingPath;
+
+        // written at the start of every frame, by the emulation thread like the debugger's commands
+        chip8::CheatList m_cheats;
+
+        chip8::StatsPublisher* m_stats {};
+        std::chrono::time_point<std::chrono::steady_clock> m_frameStartTime;
+        uint16_t m_statsKeys {};     // the keys held as the last frame started
+        uint32_t m_keyChanges {};    // in the frame running
+
+        chip8::FramePublisher* m_frameRing {};
+
+        uint32_t m_runAheadFrames {};
+        chip8::Snapshot m_runAheadState;
+
+        // what stopped the rom, empty while it runs fine
+        std::string m_fault;
+
+        /**
+         * time spent on run-ahead per published frame
+        **/
+        struct RunAheadStats
+        {
+            uint64_t frames {};
+            std::chrono::nanoseconds snapshots {};  // save + restore
+            std::chrono::nanoseconds execution {};
+            std::chrono::nanoseconds worst {};
+
+            void add(std::chrono::nanoseconds snapshot, std::chrono::nanoseconds run)
+            {
+                frames++;
+                snapshots += snapshot;
+                execution += run;
+                worst = std::max(worst, snapshot + run);
+            }
+        } m_runAheadStats;
+
+        void printRunAheadStats()
+        {
+            if (m_runAheadStats.frames == 0)
+                return;
+
+            const double frameBudget = 1e9 / 60;
+            const double snapshots = m_runAheadStats.snapshots.count() / double(m_runAheadStats.frames);
+            const double execution = m_runAheadStats.execution.count() / double(m_runAheadStats.frames);
+
+            std::cout << "run-ahead of " << m_runAheadFrames << " frames over " << m_runAheadStats.frames << " frames:\n"
+                      << "  save + restore " << snapshots / 1000 << " us, running ahead " << execution / 1000 << " us"
+                      << ", worst " << m_runAheadStats.worst.count() / 1000.0 << " us per frame\n"
+                      << "  " << 100 * (snapshots + execution) / frameBudget << "% of a 60Hz frame on average\n";
+        }
+
+        std::atomic<bool> m_shouldStop {};
+        std::atomic<bool> m_isEmulationDone {};
+
+        uint32_t m_instructionsPerFrame { chip8::instructionsPerFrameFor(m_interpreter->platform()) };
+        uint64_t m_frameStart {};     // Interpreter::instructions() as the frame started
 
-        chip8::Display* m_chip8Display {};
-        chip8::Memory* m_chip8Memory {};
-        chip8::Cpu* m_chip8Cpu {};
-        chip8::Keypad* m_chip8Keypad {};
+        // how far emulate() may fall behind the clock before it gives up on catching up
+        inline static const std::chrono::milliseconds c_maxLag { 100 };
 
         drivers::Display* m_displayDriver {};
         drivers::Input* m_inputDriver {};
 
-        void execute(const uint16_t instruction)
+        /**
+         * runs the rom till run() stops it or the debugger quits.
+         * frames are m_instructionsPerFrame instructions of emulated time,
+         * the clock is only read between them to wait for the frame's 60th
+         * of a second to pass, whatever the presenter does.
+        **/
+        void emulate()
         {
-            bool shallInc = true;
-            
-            switch (instruction & 0xF000)
+            // frames since start, a 60th of a second is no whole no. of clock ticks
+            std::chrono::time_point<std::chrono::steady_clock> start = std::chrono::steady_clock::now();
+            std::chrono::duration<int64_t, std::ratio<1, 60>> frames { 0 };
+            startFrame();
+
+            while (!m_shouldStop.load(std::memory_order_relaxed) && runFrame())
             {
-            case 0x0:
-                switch (instruction)
-                {
-                case 0xE0:
-                        m_chip8Display->clear();
-                    break;
-                
-                case 0xEE:
-                    m_chip8Cpu->writePC(m_chip8Cpu->peekStack());
-                    m_chip8Cpu->popStack();
-                    break;
-                
-                default:
-                    break;
-                }
-                break;
-            
-            case 0x1000:
-                m_chip8Cpu->writePC(instruction & 0x0FFF);
-                shallInc = false;
-                break;
-
-            case 0x2000:
-                m_chip8Cpu->pushStack(m_chip8Cpu->readPC());
-                m_chip8Cpu->writePC(instruction & 0x0FFF);
-                shallInc = false;
-                break;
-
-            case 0x3000:
-                if (m_chip8Cpu->readRegister((instruction & 0x0F00) >> 8) == (instruction & 0xFF))
-                    m_chip8Cpu->incrementPC();
-                break;
-
-            case 0x4000:
-                if (m_chip8Cpu->readRegister((instruction & 0x0F00) >> 8) != (instruction & 0xFF))
-                    m_chip8Cpu->incrementPC();
-                break;
-
-            case 0x5000:
-                if (m_chip8Cpu->readRegister((instruction & 0x0F00) >> 8) == m_chip8Cpu->readRegister((instruction & 0xF0) >> 4))
-                    m_chip8Cpu->incrementPC();
-                break;
-
-            case 0x6000:
-                m_chip8Cpu->writeRegister((instruction & 0x0F00) >> 8, instruction & 0xFF);
-                break;
-            
-            case 0x7000:
+                const std::chrono::time_point<std::chrono::steady_clock> frameEnd =
+                    start + std::chrono::duration_cast<std::chrono::steady_clock::duration>(++frames);
+
+                // after a stall, e.g. in the debugger, go on from now instead of rushing to catch up
+                const std::chrono::time_point<std::chrono::steady_clock> now = std::chrono::steady_clock::now();
+                if (now - frameEnd > c_maxLag)
                 {
-                uint8_t reg = (instruction & 0xF00) >> 8;
-                m_chip8Cpu->writeRegister(reg, m_chip8Cpu->readRegister(reg) + (instruction & 0xFF));
+                    start = now;
+                    frames = frames.zero();
                 }
-                break;
+                else
+                    std::this_thread::sleep_until(frameEnd);
+            }
 
-            case 0x8000:
-                {
+            m_isEmulationDone.store(true, std::memory_order_release);
+        }
 
-                uint8_t regX = (instruction & 0x0F00) >> 8;
-                uint8_t regY = (instruction & 0xF0) >> 4;
+        /**
+         * runs the m_instructionsPerFrame instructions of a frame, then ends it
+         * @returns false if the user asked to quit from the debugger or the
+         *  rom faulted, the fault then is in m_fault and its frame recorded
+        **/
+        bool runFrame()
+        {
+            const uint64_t end = m_frameStart + m_instructionsPerFrame;
 
-                uint8_t valX = m_chip8Cpu->readRegister(regX);
-                uint8_t valY = m_chip8Cpu->readRegister(regY);
+            if (m_stats)
+                m_frameStartTime = std::chrono::steady_clock::now();
 
-                switch (instruction & 0xF)
-                {
-                case 0x0:
-                    m_chip8Cpu->writeRegister(regX, valY);
-                    break;
-                
-                case 0x1:
-                    m_chip8Cpu->writeRegister(regX, valX | valY);
-                    break;
+            try
+            {
+                // counted in executed instructions, the debugger may stop before one
+                while (m_interpreter->instructions() < end)
+                    if (!m_interpreter->step() && !debugPrompt())
+                        return false;
+            }
+            catch (const std::runtime_error& e)
+            {
+                m_fault = std::string(e.what()) + " in frame " + std::to_string(m_frameCount + 1);
 
-                case 0x2:
-                    m_chip8Cpu->writeRegister(regX, valX & valY);
-                    break;
+                chip8::Display* display = m_interpreter->display();
+                if (m_recorder)
+                    m_recorder->push(display->screenBuffer().data(), display->wordsPerRow(), display->planes());
 
-                case 0x3:
-                    m_chip8Cpu->writeRegister(regX, valX ^ valY);
-                    break;
-
-                case 0x4:
-                    m_chip8Cpu->writeRegister(regX, valX + valY);
-                    m_chip8Cpu->writeRegister(0xF, (static_cast<uint16_t>(valX) + static_cast<uint16_t>(valY)) > 255);
-                    break;
+                return false;
+            }
 
-                case 0x5:
-                    m_chip8Cpu->writeRegister(regX, valX - valY);
-                    m_chip8Cpu->writeRegister(0xF, valX > valY);
-                    break;
+            endFrame();
+            return true;
+        }
 
-                case 0x6:
-                    m_chip8Cpu->writeRegister(regX, valX >> 1);
-                    m_chip8Cpu->writeRegister(0xF, valX & 1);
-                    break;
+        /**
+         * finishes the recording, whose frames are encoded by now, and prints the fault if any
+         * @returns false if the rom faulted
+        **/
+        bool finish()
+        {
+            if (m_recorder)
+            {
+                const uint64_t dropped = m_recorder->droppedFrames();
+                delete m_recorder;
+                m_recorder = nullptr;
 
-                case 0x7:
-                    m_chip8Cpu->writeRegister(regX, valY - valX);
-                    m_chip8Cpu->writeRegister(0xF, valY > valX);
-                    break;
+                std::cout << "recording: " << dropped << " frames dropped\n";
+                if (dropped > 0)
+                    std::cerr << "WARNING: The recording lacks " << dropped << " frames the encoder could not keep up with\n";
+            }
 
-                case 0xE:
-                    m_chip8Cpu->writeRegister(regX, valX << 1);
-                    m_chip8Cpu->writeRegister(0xF, (valX & (1 << 7)) >> 7);
-                    break;
-                
-                default:
-                    break;
-                }
-                }
-                break;
-            
-            case 0x9000:
-                if (m_chip8Cpu->readRegister((instruction & 0x0F00) >> 8) != m_chip8Cpu->readRegister((instruction & 0xF0) >> 4))
-                    m_chip8Cpu->incrementPC();
-                break;
-            
-            case 0xA000:
-                m_chip8Cpu->writeI(instruction & 0xFFF);
-                break;
-
-            case 0xB000:
-                m_chip8Cpu->writePC((instruction & 0xFFF) + m_chip8Cpu->readRegister(0x0));
-                break;
-
-            case 0xC000:
-                m_chip8Cpu->writeRegister((instruction & 0x0F00) >> 8, (instruction & 0xFF) & (rand() % 256));
-                break;
-
-            case 0xD000:
-                {
-                emuGL::Point pos
-                {
-                    m_chip8Cpu->readRegister((instruction & 0x0F00) >> 8),
-                    m_chip8Cpu->readRegister((instruction & 0xF0) >> 4)
-                };
+            if (m_fault.empty())
+                return true;
 
-                uint8_t n = instruction & 0xF;
+            std::cerr << m_fault << '\n';
+            return false;
+        }
 
-                std::vector<uint8_t> sprite;
-                for (uint16_t i = 0; i < n; i++)
-                    sprite.push_back(m_chip8Memory->read(m_chip8Cpu->readI() + i));
-                
-                m_chip8Cpu->writeRegister(0xF, m_chip8Display->attachSprite(sprite, pos.x, pos.y));
-                }
-                break;
+        static chip8::Interpreter* loadRom(const std::string& romPath, chip8::AnalysisCache* analysisCache,
+                                           std::optional<chip8::Platform> platform)
+        {
+            const chip8::MappedRom rom{romPath};
+            return new chip8::Interpreter{rom.data(), rom.size(), chip8::choosePlatform(rom.data(), rom.size(), analysisCache, platform)};
+        }
 
-            case 0xE000:
-                {
-                uint8_t valX = m_chip8Cpu->readRegister((instruction & 0x0F00) >> 8);
+        /**
+         * runs m_runAheadFrames frames with the keys held now and puts the
+         * last one into frame, then restores the state from before. the
+         * frames get the cheats as real ones do, but key reads and draws in
+         * them are not latency samples.
+        **/
+        void runAhead(std::vector<uint64_t>& frame)
+        {
+            const std::chrono::time_point<std::chrono::steady_clock> start = std::chrono::steady_clock::now();
+            m_interpreter->save(m_runAheadState);
+            m_interpreter->setLatencyTracker(nullptr);
 
-                switch (instruction & 0xFF)
+            const std::chrono::time_point<std::chrono::steady_clock> saved = std::chrono::steady_clock::now();
+            try
+            {
+                for (uint32_t f = 0; f < m_runAheadFrames; f++)
                 {
-                case 0x9E:
-                    if (m_chip8Keypad->isPressed(valX))
-                        m_chip8Cpu->incrementPC();
-                    break;
-                
-                case 0xA1:
-                    std::cout << "in EA1: " << (int)valX << "\n";
-                    if (!m_chip8Keypad->isPressed(valX))
-                    {
-                        std::cout << "INSIDE IF\n";
-                        m_chip8Cpu->incrementPC();
-                    }
-                    break;
+                    if (!m_cheats.empty())
+                        m_cheats.apply(*m_interpreter->memory());
 
-                default:
-                    break;
+                    for (uint32_t i = 0; i < m_instructionsPerFrame; i++)
+                        m_interpreter->step();
+                    m_interpreter->decrementTimers();
                 }
-                }
-                break;
+            }
+            catch (const std::runtime_error&)
+            {
+                // a fault yet to come, shown as far as it got. the rom hits it for real in its frame.
+            }
+            frame = m_interpreter->display()->screenBuffer();
 
-            case 0xF000:
-                {
-                    uint8_t reg = (instruction & 0xF00) >> 8;
-                    switch (instruction & 0xFF)
-                    {
-                    case 0x07:
-                        m_chip8Cpu->writeRegister(reg, m_chip8Cpu->delayTimer());
-                        break;
-
-                    case 0x0A:
-                        m_chip8Cpu->writeRegister(reg, m_inputDriver->waitKeyPress(m_chip8Keypad));
-                        break;
-
-                    case 0x15:
-                        m_chip8Cpu->setDelayTimer(m_chip8Cpu->readRegister(reg));
-                        break;
-                    
-                    case 0x18:
-                        m_chip8Cpu->setSoundTimer(m_chip8Cpu->readRegister(reg));
-                        break;
-
-                    case 0x1E:
-                        m_chip8Cpu->writeI(m_chip8Cpu->readI() + m_chip8Cpu->readRegister(reg));
-                        break;
-
-                    case 0x29:
-                        m_chip8Cpu->writeI(chip8::Memory::c_fontStartAddr + m_chip8Cpu->readRegister(reg));
-                        break;
-
-                    case 0x33:
-                        {
-                            uint8_t val = m_chip8Cpu->readRegister(reg);
-                            m_chip8Memory->write(m_chip8Cpu->readI(), val / 100);
-                            m_chip8Memory->write(m_chip8Cpu->readI() + 1, (val % 100) / 10);
-                            m_chip8Memory->write(m_chip8Cpu->readI() + 2, val % 10);
-                        }
-                        break;
-                    
-                    case 0x55:
-                        for (uint8_t i = 0; i <= reg; i++)
-                            m_chip8Memory->write(m_chip8Cpu->readI() + i, m_chip8Cpu->readRegister(i));
-                        break;
-
-                    case 0x65:
-                        for (uint8_t i = 0; i <= reg; i++)
-                            m_chip8Cpu->writeRegister(i, m_chip8Memory->read(m_chip8Cpu->readI() + i));
-                        break;
-
-                    default:
-                        break;
-                    }
-                }
-                break;
+            const std::chrono::time_point<std::chrono::steady_clock> ran = std::chrono::steady_clock::now();
+            m_interpreter->restore(m_runAheadState);
+            m_interpreter->setLatencyTracker(m_latency);
+
+            const std::chrono::time_point<std::chrono::steady_clock> end = std::chrono::steady_clock::now();
+            m_runAheadStats.add(saved - start + (end - ran), ran - saved);
+        }
+
+        /**
+         * decrements the timers, publishes and records the frame and starts the next one
+        **/
+        void endFrame()
+        {
+            m_interpreter->decrementTimers();
+
+            chip8::Display* display = m_interpreter->display();
+            if (m_runAheadFrames > 0 && !m_debugger)
+                runAhead(m_frames.back().pixels);
+            else
+                m_frames.back().pixels = display->screenBuffer();
+            m_frames.back().number = ++m_frameCount;
+            m_frames.publish();
 
-            default:
-                break;
+            if (m_latency)
+                m_latency->framePublished(m_frameCount);
+
+            if (m_recorder)
+                m_recorder->push(display->screenBuffer().data(), display->wordsPerRow(), display->planes());
+
+            if (m_stats)
+                m_stats->publish(*m_interpreter, std::chrono::steady_clock::now() - m_frameStartTime, m_keyChanges);
+
+            // the frame as run, not as run ahead
+            if (m_frameRing)
+                m_frameRing->publish(m_frameCount, m_interpreter->keypad()->keys(), display->screenBuffer());
+
+            startFrame();
+        }
+
+        /**
+         * applies the cheats, and plays, records or counts the keys of frame
+         * no. m_frameCount as it starts
+        **/
+        void startFrame()
+        {
+            m_frameStart = m_interpreter->instructions();
+
+            if (!m_cheats.empty())
+                m_cheats.apply(*m_interpreter->memory());
+
+            if (m_movie)
+                m_interpreter->keypad()->setKeys(m_movie->keysAt(m_frameCount));
+
+            if (m_inputRecording)
+                m_inputRecording->record(m_frameCount, m_interpreter->keypad()->keys());
+
+            if (m_stats)
+            {
+                const uint16_t keys = m_interpreter->keypad()->keys();
+                m_keyChanges = __builtin_popcount(keys ^ m_statsKeys);
+                m_statsKeys = keys;
             }
+        }
+
+        /**
+         * @returns false if the user asked to quit from the debugger
+        **/
+        bool debugPrompt()
+        {
+            if (m_gdbServer)
+                return m_gdbServer->serveWhileStopped();
+
+            m_debugger->printStop(std::cout);
+
+            chip8::Debugger::PromptResult result = chip8::Debugger::PromptResult::EndOfInput;
+            if (m_debugScript.is_open())
+                result = m_debugger->prompt(m_debugScript, std::cout);
+
+            if (result == chip8::Debugger::PromptResult::EndOfInput)
+                result = m_debugger->prompt(std::cin, std::cout);
 
-            if (shallInc)
-                m_chip8Cpu->incrementPC();
+            return result == chip8::Debugger::PromptResult::Resumed;
         }
     };
 }
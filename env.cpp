@@ -0,0 +1,283 @@
+#include "env.h"
+
+#include <string.h>
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace chip8
+{
+    namespace
+    {
+        /**
+         * @returns the splitmix64 hash of x, a well spread seed from a counter
+        **/
+        uint64_t splitMix(uint64_t x)
+        {
+            x += 0x9E3779B97F4A7C15ull;
+            x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ull;
+            x = (x ^ (x >> 27)) * 0x94D049BB133111EBull;
+            return x ^ (x >> 31);
+        }
+    }
+
+
+    Environments::Environments(const uint8_t* rom, size_t size, size_t count, Platform platform, const Config& config)
+        :   m_rom(rom, rom + size),
+            m_platform(platform),
+            m_config(config)
+    {
+        if (count == 0)
+            throw std::runtime_error("ERROR: Environments need at least one environment!");
+
+        for (const Reward& reward : m_config.rewards)
+            if (reward.probe.addr + reward.probe.width() > Memory::sizeFor(platform))
+                throw std::runtime_error("ERROR: Reward probe at " + std::to_string(reward.probe.addr) + " reaches past the memory!");
+
+        for (const Done& done : m_config.dones)
+            if (done.probe.addr + done.probe.width() > Memory::sizeFor(platform))
+                throw std::runtime_error("ERROR: Done probe at " + std::to_string(done.probe.addr) + " reaches past the memory!");
+
+        m_envs.resize(count);
+        try
+        {
+            for (Env& env : m_envs)
+            {
+                env.interpreter = new Interpreter{m_rom.data(), m_rom.size(), m_platform};
+                env.rewardValues.resize(m_config.rewards.size());
+            }
+        }
+        catch (...)
+        {
+            for (Env& env : m_envs)
+                delete env.interpreter;
+            throw;
+        }
+
+        const size_t chunks = (count + k_chunkSize - 1) / k_chunkSize;
+        const size_t threads = m_config.threads ? m_config.threads : std::max(std::thread::hardware_concurrency(), 1u);
+
+        for (size_t index = 1; index < std::min(threads, chunks); index++)
+            m_workers.emplace_back(&Environments::work, this);
+    }
+
+    Environments::~Environments()
+    {
+        {
+            std::lock_guard<std::mutex> lock{m_mutex};
+            m_quit = true;
+        }
+        m_started.notify_all();
+
+        for (std::thread& worker : m_workers)
+            worker.join();
+
+        for (Env& env : m_envs)
+            delete env.interpreter;
+    }
+
+    size_t Environments::observationSize() const
+    {
+        Display* display = m_envs[0].interpreter->display();
+        const size_t pixels = display->width() * display->height() * display->planes();
+
+        return m_config.observation == Observation::Packed ? pixels / 8 : pixels;
+    }
+
+    void Environments::reset(uint8_t* observations, uint64_t seed)
+    {
+        m_seed = seed;
+        for (Env& env : m_envs)
+            env.episode = 0;
+
+        m_job = Job::Reset;
+        m_observations = observations;
+        dispatch();
+    }
+
+    void Environments::step(const uint16_t* actions, uint32_t frames, uint8_t* observations, float* rewards, uint8_t* dones)
+    {
+        m_job = Job::Step;
+        m_actions = actions;
+        m_frames = frames;
+        m_observations = observations;
+        m_rewards = rewards;
+        m_dones = dones;
+        dispatch();
+    }
+
+    void Environments::dispatch()
+    {
+        {
+            std::lock_guard<std::mutex> lock{m_mutex};
+            m_nextChunk.store(0, std::memory_order_relaxed);
+            m_busy = m_workers.size();
+            m_generation++;
+        }
+        m_started.notify_all();
+
+        runChunks();
+
+        std::unique_lock<std::mutex> lock{m_mutex};
+        m_finished.wait(lock, [this] { return m_busy == 0; });
+    }
+
+    void Environments::work()
+    {
+        uint64_t done = 0;
+        while (true)
+        {
+            {
+                std::unique_lock<std::mutex> lock{m_mutex};
+                m_started.wait(lock, [&] { return m_quit || m_generation != done; });
+                if (m_quit)
+                    return;
+
+                done = m_generation;
+            }
+
+            runChunks();
+
+            std::lock_guard<std::mutex> lock{m_mutex};
+            if (--m_busy == 0)
+                m_finished.notify_one();
+        }
+    }
+
+    void Environments::runChunks()
+    {
+        while (true)
+        {
+            const size_t first = m_nextChunk.fetch_add(1, std::memory_order_relaxed) * k_chunkSize;
+            if (first >= m_envs.size())
+                return;
+
+            const size_t last = std::min(first + k_chunkSize, m_envs.size());
+            for (size_t env = first; env < last; env++)
+            {
+                if (m_job == Job::Reset)
+                    resetEnv(env);
+                else
+                    stepEnv(env);
+            }
+        }
+    }
+
+    void Environments::resetEnv(size_t index)
+    {
+        Env& env = m_envs[index];
+        Interpreter& interpreter = *env.interpreter;
+
+        interpreter.reset(m_rom.data(), m_rom.size(), m_platform);
+
+        const uint32_t random = splitMix(m_seed ^ splitMix(index ^ splitMix(env.episode)));
+        interpreter.setRandomState(random ? random : Interpreter::k_randomSeed);
+        env.episode++;
+
+        for (size_t reward = 0; reward < m_config.rewards.size(); reward++)
+            env.rewardValues[reward] = probe(index, m_config.rewards[reward].probe);
+
+        env.frames = 0;
+        env.isDone = false;
+        env.error.clear();
+
+        observe(index);
+    }
+
+    void Environments::stepEnv(size_t index)
+    {
+        Env& env = m_envs[index];
+        Interpreter& interpreter = *env.interpreter;
+
+        if (env.isDone)
+            resetEnv(index);
+
+        interpreter.keypad()->setKeys(m_actions[index]);
+
+        try
+        {
+            for (uint32_t frame = 0; frame < m_frames && !env.isDone; frame++)
+            {
+                TableEngine::run(interpreter, m_config.instructionsPerFrame);
+                interpreter.decrementTimers();
+
+                env.frames++;
+                env.isDone = isDone(index);
+            }
+        }
+        catch (const std::exception& e)
+        {
+            env.error = e.what();
+            env.isDone = true;
+        }
+
+        float reward = 0;
+        for (size_t at = 0; at < m_config.rewards.size(); at++)
+        {
+            const uint32_t value = probe(index, m_config.rewards[at].probe);
+            reward += m_config.rewards[at].scale * (int64_t(value) - int64_t(env.rewardValues[at]));
+            env.rewardValues[at] = value;
+        }
+
+        m_rewards[index] = reward;
+        m_dones[index] = env.isDone;
+        observe(index);
+    }
+
+    void Environments::observe(size_t index)
+    {
+        Display* display = m_envs[index].interpreter->display();
+        const std::vector<uint64_t>& screen = display->screenBuffer();
+
+        const size_t size = observationSize();
+        uint8_t* observation = m_observations + index * size;
+
+        if (m_config.observation == Observation::Packed)
+        {
+            memcpy(observation, screen.data(), size);
+            return;
+        }
+
+        for (size_t word = 0; word < screen.size(); word++)
+            for (int bit = 0; bit < 64; bit++)
+                observation[word * 64 + bit] = (screen[word] >> (63 - bit)) & 1;
+    }
+
+    uint32_t Environments::probe(size_t index, const RamProbe& probe)
+    {
+        Memory* memory = m_envs[index].interpreter->memory();
+
+        switch (probe.encoding)
+        {
+        case RamProbe::Encoding::Word:
+            return memory->readWord(probe.addr);
+
+        case RamProbe::Encoding::Bcd:
+            return memory->read(probe.addr) * 100 + memory->read(probe.addr + 1) * 10 + memory->read(probe.addr + 2);
+
+        default:
+            return memory->read(probe.addr);
+        }
+    }
+
+    bool Environments::isDone(size_t index)
+    {
+        if (m_config.maxFrames && m_envs[index].frames >= m_config.maxFrames)
+            return true;
+
+        for (const Done& done : m_config.dones)
+        {
+            const uint32_t value = probe(index, done.probe);
+
+            switch (done.when)
+            {
+            case Done::When::Equal:     if (value == done.value) return true; break;
+            case Done::When::NotEqual:  if (value != done.value) return true; break;
+            case Done::When::Below:     if (value < done.value) return true; break;
+            case Done::When::Above:     if (value > done.value) return true; break;
+            }
+        }
+
+        return false;
+    }
+}
@@ -0,0 +1,216 @@
+#ifndef ENV_H
+#define ENV_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "interpreter.h"
+
+namespace chip8
+{
+    /**
+     * A value a rom keeps in memory, e.g. its score or lives left
+    **/
+    struct RamProbe
+    {
+        enum class Encoding
+        {
+            Byte,
+            Word,       // big endian, as the rom reads it
+            Bcd         // 3 bytes of a decimal digit each, as Fx33 writes them
+        };
+
+        uint16_t addr;
+        Encoding encoding { Encoding::Byte };
+
+        /**
+         * @returns no. of bytes from addr on the value takes
+        **/
+        uint16_t width() const { return encoding == Encoding::Byte ? 1 : encoding == Encoding::Word ? 2 : 3; }
+    };
+
+    /**
+     * Many machines running one rom for reinforcement learning, stepped
+     * together: every step takes a set of keys per environment and writes
+     * what each shows, the reward it earned and whether its episode ended
+     * into buffers the caller owns.
+     *
+     * Rewards and episode ends are read from memory through RamProbes.
+     * The environments are stepped by a pool of threads kept for the whole
+     * run, and nothing is allocated per step or per reset.
+    **/
+    class Environments
+    {
+    public:
+        enum class Observation
+        {
+            Packed,     // the frame as Display::screenBuffer() holds it, 1 bit per pixel
+            Bytes       // a byte per pixel, 0 or 1, row after row and plane after plane
+        };
+
+        /**
+         * the reward of a step is scale times how much the value grew
+        **/
+        struct Reward
+        {
+            RamProbe probe;
+            float scale { 1 };
+        };
+
+        /**
+         * the episode ends once the value compares to value as when says
+        **/
+        struct Done
+        {
+            enum class When
+            {
+                Equal,
+                NotEqual,
+                Below,
+                Above
+            };
+
+            RamProbe probe;
+            When when { When::Equal };
+            uint32_t value {};
+        };
+
+        struct Config
+        {
+            std::vector<Reward> rewards;
+            std::vector<Done> dones;
+
+            Observation observation { Observation::Packed };
+
+            uint32_t instructionsPerFrame { 15 };
+
+            // frames after which an episode is cut off, 0 for never
+            uint64_t maxFrames {};
+
+            // no. of threads stepping, the calling one included, 0 for one per core
+            size_t threads {};
+        };
+
+        /**
+         * @param rom, size the rom image, copied
+         * @param count no. of environments
+         * @param platform the rom was written for, see detectPlatform()
+         * @throws runtime_error
+         *  if size > Memory::maxRomSize(platform), count is 0 or a probe reaches past the memory
+        **/
+        Environments(const uint8_t* rom, size_t size, size_t count, Platform platform, const Config& config);
+        ~Environments();
+
+        Environments(const Environments&) = delete;
+        Environments& operator=(const Environments&) = delete;
+
+        size_t count() const { return m_envs.size(); }
+
+        /**
+         * @returns no. of bytes an observation takes, see Observation
+        **/
+        size_t observationSize() const;
+
+        /**
+         * starts a new episode in every environment.
+         * @param observations count() * observationSize() bytes, the first
+         *  frame of each environment is written to
+         * @param seed the random generators are seeded from, each
+         *  environment and episode drawing other numbers
+        **/
+        void reset(uint8_t* observations, uint64_t seed = 0);
+
+        /**
+         * holds keys actions[n] in environment n for frames frames.
+         * environments whose episode ended in the previous step start a new
+         * one first.
+         * @param actions count() key masks, bit k for key k
+         * @param observations as for reset(), the last frame of the step
+         * @param rewards count() rewards earned during the step
+         * @param dones count() flags set to 1 where the episode ended, by a
+         *  Done probe, maxFrames or a rom fault, see error()
+        **/
+        void step(const uint16_t* actions, uint32_t frames, uint8_t* observations, float* rewards, uint8_t* dones);
+
+        /**
+         * @returns the rom fault that ended the environment's episode, empty if none did
+        **/
+        const std::string& error(size_t env) const { return m_envs[env].error; }
+
+        /**
+         * @returns the environment's machine, to be looked at between steps only
+        **/
+        Interpreter& interpreter(size_t env) { return *m_envs[env].interpreter; }
+
+    private:
+        // environments handed to a thread at a time
+        static constexpr size_t k_chunkSize = 8;
+
+        struct Env
+        {
+            Interpreter* interpreter {};
+            std::vector<uint32_t> rewardValues;     // per reward probe, at the end of the last step
+            uint64_t episode {};
+            uint64_t frames {};                     // in this episode
+            bool isDone {};
+            std::string error;
+        };
+
+        const std::vector<uint8_t> m_rom;
+        const Platform m_platform;
+        const Config m_config;
+
+        std::vector<Env> m_envs;
+
+        uint64_t m_seed {};
+
+        // the job the pool works on
+        enum class Job { Reset, Step };
+
+        Job m_job {};
+        const uint16_t* m_actions {};
+        uint32_t m_frames {};
+        uint8_t* m_observations {};
+        float* m_rewards {};
+        uint8_t* m_dones {};
+
+        std::vector<std::thread> m_workers;
+        std::mutex m_mutex;
+        std::condition_variable m_started;
+        std::condition_variable m_finished;
+        uint64_t m_generation {};               // no. of jobs handed out
+        size_t m_busy {};                       // workers still on the current job
+        bool m_quit {};
+        std::atomic<size_t> m_nextChunk {};
+
+        /**
+         * runs the current job on all environments, the calling thread helping the pool
+        **/
+        void dispatch();
+
+        void work();
+
+        /**
+         * takes chunks of the current job until none is left
+        **/
+        void runChunks();
+
+        void resetEnv(size_t env);
+        void stepEnv(size_t env);
+
+        void observe(size_t env);
+
+        uint32_t probe(size_t env, const RamProbe& probe);
+
+        bool isDone(size_t env);
+    };
+}
+
+#endif /* ENV_H */
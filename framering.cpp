@@ -0,0 +1,165 @@
+#include "framering.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <new>
+#include <stdexcept>
+
+namespace chip8
+{
+    namespace
+    {
+        static_assert(std::atomic<uint64_t>::is_always_lock_free && std::atomic<uint32_t>::is_always_lock_free,
+                      "shared between processes, the atomics may not hide a lock");
+        static_assert(sizeof(SharedFrameRing::Slot) % sizeof(uint64_t) == 0, "the words of a slot follow it aligned");
+
+        const char* const c_segmentPrefix = "chip8-frames.";
+
+        size_t slotSizeFor(uint32_t frameWords)
+        {
+            const size_t bytes = sizeof(SharedFrameRing::Slot) + frameWords * sizeof(uint64_t);
+            return (bytes + SharedFrameRing::k_alignment - 1) / SharedFrameRing::k_alignment * SharedFrameRing::k_alignment;
+        }
+    }
+
+
+    size_t SharedFrameRing::segmentSize(uint32_t slots, uint32_t frameWords)
+    {
+        return headerSize() + slots * slotSizeFor(frameWords);
+    }
+
+    void SharedFrameRing::write(uint64_t number, uint16_t keys, const uint64_t* frame)
+    {
+        Slot& to = slot(number);
+
+        const uint32_t at = to.sequence.load(std::memory_order_relaxed);
+        to.sequence.store(at + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+
+        // readers may be reading the words meanwhile, what they get is rejected by the sequence no.
+        to.keys = keys;
+        to.number = number;
+        memcpy(to.words(), frame, frameWords * sizeof(uint64_t));
+
+        to.sequence.store(at + 2, std::memory_order_release);
+        latest.store(number, std::memory_order_release);
+    }
+
+
+    FramePublisher::FramePublisher(Display& display, uint32_t slots)
+        :   m_name(frameRingName(getpid()))
+    {
+        if (slots == 0)
+            throw std::runtime_error("ERROR: A frame ring needs at least one slot");
+
+        const uint32_t frameWords = display.screenBuffer().size();
+        m_size = SharedFrameRing::segmentSize(slots, frameWords);
+
+        // left over by an earlier process of the same pid that did not get to clean up
+        shm_unlink(m_name.c_str());
+
+        const int fd = shm_open(m_name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0644);
+        if (fd < 0)
+            throw std::runtime_error("ERROR: Unable to create frame ring " + m_name + ": " + strerror(errno));
+
+        void* data = MAP_FAILED;
+        if (ftruncate(fd, m_size) == 0)
+            data = mmap(nullptr, m_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        const int error = errno;
+        close(fd);
+
+        if (data == MAP_FAILED)
+        {
+            shm_unlink(m_name.c_str());
+            throw std::runtime_error("ERROR: Unable to map frame ring " + m_name + ": " + strerror(error));
+        }
+
+        // readers mapping it before the header is written reject it by its magic,
+        // the slots are zeros, sequence no. 0 and frame no. 0 that is never acquired
+        m_shared = new (data) SharedFrameRing{};
+        m_shared->version = SharedFrameRing::k_version;
+        m_shared->pid = getpid();
+        m_shared->width = display.width();
+        m_shared->height = display.height();
+        m_shared->wordsPerRow = display.wordsPerRow();
+        m_shared->planes = display.planes();
+        m_shared->frameWords = frameWords;
+        m_shared->slots = slots;
+        m_shared->slotSize = slotSizeFor(frameWords);
+
+        m_shared->magic.store(SharedFrameRing::k_magic, std::memory_order_release);
+    }
+
+    FramePublisher::~FramePublisher()
+    {
+        munmap(m_shared, m_size);
+        shm_unlink(m_name.c_str());
+    }
+
+
+    FrameRingView::FrameRingView(const std::string& name)
+    {
+        const int fd = shm_open(name.c_str(), O_RDONLY, 0);
+        if (fd < 0)
+            throw std::runtime_error("ERROR: Unable to open frame ring " + name + ": " + strerror(errno));
+
+        // the header first, for the size of the whole
+        struct stat info;
+        void* data = MAP_FAILED;
+        if (fstat(fd, &info) == 0 && static_cast<size_t>(info.st_size) >= SharedFrameRing::headerSize())
+        {
+            m_size = info.st_size;
+            data = mmap(nullptr, m_size, PROT_READ, MAP_SHARED, fd, 0);
+        }
+        close(fd);
+
+        if (data == MAP_FAILED)
+            throw std::runtime_error("ERROR: " + name + " is no frame ring!");
+
+        m_shared = static_cast<const SharedFrameRing*>(data);
+
+        if (m_shared->magic.load(std::memory_order_acquire) != SharedFrameRing::k_magic ||
+            m_shared->version != SharedFrameRing::k_version ||
+            m_size < SharedFrameRing::segmentSize(m_shared->slots, m_shared->frameWords))
+        {
+            munmap(data, m_size);
+            throw std::runtime_error("ERROR: " + name + " is no frame ring of this version!");
+        }
+    }
+
+    FrameRingView::~FrameRingView()
+    {
+        munmap(const_cast<SharedFrameRing*>(m_shared), m_size);
+    }
+
+    FrameRingView::Frame FrameRingView::acquire(uint64_t number) const
+    {
+        const SharedFrameRing::Slot& slot = m_shared->slot(number);
+
+        const uint32_t sequence = slot.sequence.load(std::memory_order_acquire);
+        const Frame frame { slot.words(), slot.number, slot.keys, sequence };
+
+        // the number read is only the slot's if the sequence no. still is what it was
+        if (number == 0 || (sequence & 1) || frame.number != number || !isIntact(frame))
+            return { nullptr, number, 0, sequence };
+
+        return frame;
+    }
+
+    bool FrameRingView::isIntact(const Frame& frame) const
+    {
+        std::atomic_thread_fence(std::memory_order_acquire);
+        return m_shared->slot(frame.number).sequence.load(std::memory_order_relaxed) == frame.sequence;
+    }
+
+
+    std::string frameRingName(pid_t pid)
+    {
+        return "/" + std::string(c_segmentPrefix) + std::to_string(pid);
+    }
+}
@@ -0,0 +1,203 @@
+#ifndef FRAMERING_H
+#define FRAMERING_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <sys/types.h>
+
+#include <atomic>
+#include <string>
+#include <vector>
+
+#include "chip8.h"
+
+namespace chip8
+{
+    /**
+     * The header of a frame ring segment, a POSIX shared memory object named
+     * after the emulator's pid holding its last frames, for other processes
+     * to map read-only. The slots follow it, frame no. n in slot n % slots.
+     *
+     * A single thread writes the frames, each into the slot of the oldest one,
+     * and never waits for the readers. Readers use the frames where they are
+     * and tell by the slot's sequence no. whether it was overwritten while
+     * they did: it is odd while the slot is written and changed once it was.
+    **/
+    struct SharedFrameRing
+    {
+        static constexpr uint32_t k_magic = 0x52463843;     // "C8FR"
+        static constexpr uint32_t k_version = 1;
+
+        // of the header and of every slot, so slots share no cache line
+        static constexpr size_t k_alignment = 64;
+
+        /**
+         * a frame and what it was run with, followed by the frame's words
+        **/
+        struct Slot
+        {
+            std::atomic<uint32_t> sequence;
+            uint16_t keys;                  // held as the frame ended, bit n for key n
+            uint64_t number;                // of the frame, from 1 on
+
+            const uint64_t* words() const { return reinterpret_cast<const uint64_t*>(this + 1); }
+            uint64_t* words() { return reinterpret_cast<uint64_t*>(this + 1); }
+        };
+
+        std::atomic<uint32_t> magic;        // k_magic once the rest of the header is written
+
+        // constant once magic is set
+        uint32_t version;
+        pid_t pid;
+
+        // the frames, packed as Display::screenBuffer() is
+        uint16_t width;
+        uint16_t height;
+        uint16_t wordsPerRow;
+        uint8_t planes;
+        uint32_t frameWords;
+
+        uint32_t slots;
+        uint32_t slotSize;                  // bytes from one slot to the next
+
+        std::atomic<uint64_t> latest;       // no. of the last frame completely written, 0 before the first
+
+        /**
+         * @returns no. of bytes of a segment of slots slots of frameWords words
+        **/
+        static size_t segmentSize(uint32_t slots, uint32_t frameWords);
+
+        /**
+         * @returns the slot frame no. number is written into
+        **/
+        const Slot& slot(uint64_t number) const
+        {
+            const size_t offset = headerSize() + number % slots * slotSize;
+            return *reinterpret_cast<const Slot*>(reinterpret_cast<const uint8_t*>(this) + offset);
+        }
+
+        Slot& slot(uint64_t number)
+        {
+            return const_cast<Slot&>(static_cast<const SharedFrameRing*>(this)->slot(number));
+        }
+
+        /**
+         * to be called by the writing thread only
+         * @param frame frameWords words
+        **/
+        void write(uint64_t number, uint16_t keys, const uint64_t* frame);
+
+        static constexpr size_t headerSize()
+        {
+            return (sizeof(SharedFrameRing) + k_alignment - 1) / k_alignment * k_alignment;
+        }
+    };
+
+    /**
+     * Writes an emulator's frames into its frame ring, one publish() per
+     * frame. The segment is removed again when this is destroyed.
+    **/
+    class FramePublisher
+    {
+    public:
+        static constexpr uint32_t k_defaultSlots = 8;
+
+        /**
+         * creates the segment of this process, see frameRingName()
+         * @param display whose frames are published, its size is fixed from now on
+         * @param slots no. of frames kept, the lag a reader may fall behind by
+         * @throws runtime_error if slots is 0 or it cannot be created
+        **/
+        FramePublisher(Display& display, uint32_t slots = k_defaultSlots);
+
+        ~FramePublisher();
+
+        FramePublisher(const FramePublisher&) = delete;
+        FramePublisher& operator=(const FramePublisher&) = delete;
+
+        /**
+         * called as a frame ends
+         * @param number of the frame, one more than the last published
+         * @param frame as Display::screenBuffer() returns it
+        **/
+        void publish(uint64_t number, uint16_t keys, const std::vector<uint64_t>& frame)
+        {
+            m_shared->write(number, keys, frame.data());
+        }
+
+    private:
+        std::string m_name;
+        SharedFrameRing* m_shared {};
+        size_t m_size {};
+    };
+
+    /**
+     * A frame ring of another process, mapped read-only.
+     *
+     * A frame is read in place: acquire() it, use its words, and then check
+     * isIntact(), discarding whatever was made of it if not, e.g.
+     *
+     *     FrameRingView::Frame frame = view.acquire(view.latest());
+     *     if (frame.words)
+     *     {
+     *         scaler.scale(frame.words, view.shared().wordsPerRow, view.shared().planes);
+     *         if (view.isIntact(frame))
+     *             show(scaler);
+     *     }
+    **/
+    class FrameRingView
+    {
+    public:
+        /**
+         * a frame in the ring, for as long as isIntact() says so
+        **/
+        struct Frame
+        {
+            const uint64_t* words;          // nullptr if the frame was not in the ring
+            uint64_t number;
+            uint16_t keys;
+            uint32_t sequence;              // of its slot as acquired
+        };
+
+        /**
+         * @param name as frameRingName() returns it
+         * @throws runtime_error if it cannot be mapped or is no frame ring
+        **/
+        explicit FrameRingView(const std::string& name);
+
+        ~FrameRingView();
+
+        FrameRingView(const FrameRingView&) = delete;
+        FrameRingView& operator=(const FrameRingView&) = delete;
+
+        const SharedFrameRing& shared() const { return *m_shared; }
+
+        /**
+         * @returns no. of the newest frame, 0 before the first
+        **/
+        uint64_t latest() const { return m_shared->latest.load(std::memory_order_acquire); }
+
+        /**
+         * @returns frame no. number, without words if it is being written,
+         *  was overwritten already or is yet to come
+        **/
+        Frame acquire(uint64_t number) const;
+
+        /**
+         * @returns true if frame was not written to since acquire() returned
+         *  it, so everything read of its words belongs to it
+        **/
+        bool isIntact(const Frame& frame) const;
+
+    private:
+        const SharedFrameRing* m_shared {};
+        size_t m_size {};
+    };
+
+    /**
+     * @returns the name of the frame ring of process pid, "/chip8-frames.<pid>"
+    **/
+    std::string frameRingName(pid_t pid);
+}
+
+#endif /* FRAMERING_H */
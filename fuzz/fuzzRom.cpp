@@ -0,0 +1,78 @@
+#include <stdint.h>
+#include <stddef.h>
+
+#include <algorithm>
+#include <stdexcept>
+
+#include "../interpreter.h"
+#include "../movie.h"
+
+/**
+ * libFuzzer entry point running the input as a rom on the headless core.
+ *
+ * input layout:
+ *  byte 0          platform in the low 3 bits, bit 7 picks the table engine
+ *  byte 1          n, no. of key changes (at most k_maxEvents)
+ *  n * 3 bytes     frames since the last change, then the keys held as 16 bit little endian
+ *  the rest        the rom, cut to Memory::maxRomSize(platform)
+ *
+ * Runs k_frames frames of k_instructionsPerFrame instructions. A rom doing
+ * something the machine rejects, a load it refuses, a bad address or a call
+ * stack over- or underflow, throws runtime_error and simply ends the run, anything else
+ * escaping or tripping a sanitizer is a bug.
+**/
+
+namespace
+{
+    constexpr uint32_t k_frames = 64;
+    constexpr uint32_t k_instructionsPerFrame = 15;
+    constexpr uint8_t k_maxEvents = 32;
+}
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size)
+{
+    // reused between runs so nothing is allocated per input
+    static chip8::Interpreter interpreter{nullptr, 0};
+    static chip8::InputMovie movie;
+
+    if (size < 2)
+        return 0;
+
+    const chip8::Platform platform = static_cast<chip8::Platform>((data[0] & 0x7) % (static_cast<uint8_t>(chip8::Platform::XoChip) + 1));
+    const bool isTable = data[0] & 0x80;
+    const uint8_t events = std::min(data[1], k_maxEvents);
+
+    size_t at = 2;
+    movie.clear();
+    for (uint32_t e = 0, frame = 0; e < events && at + 3 <= size; e++, at += 3)
+    {
+        frame += data[at];
+        movie.record(frame, data[at + 1] | (data[at + 2] << 8));
+    }
+
+    const uint8_t* rom = data + at;
+    const size_t romSize = std::min<size_t>(size - at, chip8::Memory::maxRomSize(platform));
+
+    try
+    {
+        // a load the machine rejects ends the run like any other fault
+        interpreter.reset(rom, romSize, platform);
+        interpreter.setEngine(isTable ? chip8::Interpreter::Engine::Table : chip8::Interpreter::Engine::Switch);
+
+        for (uint32_t frame = 0; frame < k_frames; frame++)
+        {
+            interpreter.keypad()->setKeys(movie.keysAt(frame));
+
+            for (uint32_t i = 0; i < k_instructionsPerFrame; i++)
+                interpreter.step();
+
+            interpreter.decrementTimers();
+        }
+    }
+    catch (const std::runtime_error&)
+    {
+        // the rom did something invalid, which the machine caught
+    }
+
+    return 0;
+}
@@ -0,0 +1,70 @@
+#include <stdint.h>
+#include <stddef.h>
+
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <random>
+#include <string>
+#include <vector>
+
+/**
+ * Drives LLVMFuzzerTestOneInput() where libFuzzer is not available, e.g. with g++.
+ *
+ * usage:
+ *  replay <file|directory>...  runs every file, e.g. a crash or a corpus
+ *  replay -random <n>          runs n random inputs and prints the execs per second
+**/
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size);
+
+namespace
+{
+    void replay(const std::filesystem::path& path)
+    {
+        std::ifstream file{path, std::ios::binary};
+        const std::vector<uint8_t> input{std::istreambuf_iterator<char>{file}, std::istreambuf_iterator<char>{}};
+
+        std::cout << path.string() << '\n';
+        LLVMFuzzerTestOneInput(input.data(), input.size());
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    if (argc == 3 && std::string{argv[1]} == "-random")
+    {
+        const uint64_t runs = std::stoull(argv[2]);
+
+        std::mt19937_64 random{0};
+        std::vector<uint8_t> input;
+
+        const std::chrono::time_point<std::chrono::steady_clock> start = std::chrono::steady_clock::now();
+        for (uint64_t run = 0; run < runs; run++)
+        {
+            input.resize(2 + random() % 512);
+            for (uint8_t& byte : input)
+                byte = random();
+
+            LLVMFuzzerTestOneInput(input.data(), input.size());
+        }
+        const std::chrono::duration<double> took = std::chrono::steady_clock::now() - start;
+
+        std::cout << runs << " inputs, " << runs / took.count() << " execs/s\n";
+        return 0;
+    }
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (std::filesystem::is_directory(argv[i]))
+        {
+            for (const std::filesystem::directory_entry& entry : std::filesystem::directory_iterator{argv[i]})
+                if (entry.is_regular_file())
+                    replay(entry.path());
+        }
+        else
+            replay(argv[i]);
+    }
+}
@@ -0,0 +1,673 @@
+#include "gdbstub.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+
+#include <unistd.h>
+#include <poll.h>
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+
+#include <sstream>
+#include <stdexcept>
+
+#include "interpreter.h"
+
+namespace chip8
+{
+    namespace
+    {
+        const int c_regI  = 16;
+        const int c_regPC = 17;
+        const int c_regSP = 18;
+        const int c_regDT = 19;
+        const int c_regST = 20;
+        const int c_regCount = 21;
+
+        const char* c_hexDigits = "0123456789abcdef";
+
+        std::string toHex(uint32_t val, int bytes)
+        {
+            // target byte order, little endian
+            std::string hex;
+            for (int i = 0; i < bytes; i++, val >>= 8)
+            {
+                hex += c_hexDigits[(val >> 4) & 0xF];
+                hex += c_hexDigits[val & 0xF];
+            }
+            return hex;
+        }
+
+        int hexDigit(char c)
+        {
+            if (c >= '0' && c <= '9') return c - '0';
+            if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+            if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+            return -1;
+        }
+
+        /**
+         * @returns the little endian value of the hex bytes in hex, -1 if malformed
+        **/
+        long fromHexBytes(const std::string& hex)
+        {
+            if (hex.empty() || hex.size() % 2 || hex.size() > 8) return -1;
+
+            long val = 0;
+            for (size_t i = hex.size(); i > 0; i -= 2)
+            {
+                const int hi = hexDigit(hex[i - 2]);
+                const int lo = hexDigit(hex[i - 1]);
+                if (hi < 0 || lo < 0) return -1;
+                val = (val << 8) | (hi << 4) | lo;
+            }
+            return val;
+        }
+
+        uint32_t parseHex(const std::string& str)
+        {
+            return static_cast<uint32_t>(std::stoul(str, nullptr, 16));
+        }
+
+        int regBytes(int reg) { return reg == c_regI || reg == c_regPC ? 2 : 1; }
+
+        std::string targetXml()
+        {
+            std::ostringstream xml;
+            xml << "<?xml version=\"1.0\"?>"
+                << "<!DOCTYPE target SYSTEM \"gdb-target.dtd\">"
+                << "<target version=\"1.0\"><feature name=\"org.chip8.core\">";
+
+            for (int i = 0; i < 16; i++)
+                xml << "<reg name=\"v" << std::hex << i << std::dec << "\" bitsize=\"8\" type=\"uint8\" regnum=\"" << i << "\"/>";
+
+            xml << "<reg name=\"i\" bitsize=\"16\" type=\"uint16\"/>"
+                << "<reg name=\"pc\" bitsize=\"16\" type=\"code_ptr\"/>"
+                << "<reg name=\"sp\" bitsize=\"8\" type=\"uint8\"/>"
+                << "<reg name=\"dt\" bitsize=\"8\" type=\"uint8\"/>"
+                << "<reg name=\"st\" bitsize=\"8\" type=\"uint8\"/>"
+                << "</feature></target>";
+
+            return xml.str();
+        }
+    }
+
+
+    GdbServer::GdbServer(chip8::Interpreter& interpreter, chip8::Debugger& debugger)
+        :   m_interpreter(interpreter),
+            m_debugger(debugger)
+    {
+        if (pipe(m_wakePipe) < 0)
+            throw std::runtime_error(std::string("ERROR: Unable to create gdb server pipe: ") + strerror(errno));
+
+        fcntl(m_wakePipe[0], F_SETFL, O_NONBLOCK);
+        fcntl(m_wakePipe[1], F_SETFL, O_NONBLOCK);
+    }
+
+    GdbServer::~GdbServer()
+    {
+        {
+            std::lock_guard<std::mutex> lock{m_mutex};
+            m_shutdown = true;
+            m_stateChanged.notify_all();
+        }
+        wake();
+
+        if (m_thread.joinable())
+            m_thread.join();
+
+        if (m_clientFd >= 0) close(m_clientFd);
+        if (m_listenFd >= 0) close(m_listenFd);
+        if (!m_unixPath.empty()) unlink(m_unixPath.c_str());
+
+        close(m_wakePipe[0]);
+        close(m_wakePipe[1]);
+    }
+
+    void GdbServer::listen(const std::string& address)
+    {
+        if (m_listenFd >= 0)
+            throw std::runtime_error("ERROR: gdb server is already listening");
+
+        if (address.rfind("unix:", 0) == 0)
+        {
+            sockaddr_un addr {};
+            addr.sun_family = AF_UNIX;
+            m_unixPath = address.substr(5);
+            if (m_unixPath.empty() || m_unixPath.size() >= sizeof(addr.sun_path))
+                throw std::runtime_error("ERROR: Invalid gdb server socket path");
+
+            strncpy(addr.sun_path, m_unixPath.c_str(), sizeof(addr.sun_path) - 1);
+            unlink(m_unixPath.c_str());
+
+            m_listenFd = socket(AF_UNIX, SOCK_STREAM, 0);
+            if (m_listenFd < 0 || bind(m_listenFd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0)
+                throw std::runtime_error(std::string("ERROR: Unable to bind gdb server socket: ") + strerror(errno));
+        }
+        else
+        {
+            sockaddr_in addr {};
+            addr.sin_family = AF_INET;
+            addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+            addr.sin_port = htons(static_cast<uint16_t>(std::stoul(address)));
+
+            m_listenFd = socket(AF_INET, SOCK_STREAM, 0);
+            int reuse = 1;
+            if (m_listenFd >= 0)
+                setsockopt(m_listenFd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+
+            if (m_listenFd < 0 || bind(m_listenFd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0)
+                throw std::runtime_error(std::string("ERROR: Unable to bind gdb server port: ") + strerror(errno));
+        }
+
+        if (::listen(m_listenFd, 1) < 0)
+            throw std::runtime_error(std::string("ERROR: Unable to listen for gdb: ") + strerror(errno));
+
+        std::cout << "gdb server listening on " << address << std::endl;
+
+        m_thread = std::thread{&GdbServer::serve, this};
+    }
+
+    bool GdbServer::serveWhileStopped()
+    {
+        std::unique_lock<std::mutex> lock{m_mutex};
+        m_isStopped = true;
+        m_stateChanged.notify_all();
+        wake();
+
+        m_stateChanged.wait(lock, [this]() { return !m_isStopped || m_isKilled || m_shutdown; });
+        return !m_isKilled;
+    }
+
+    void GdbServer::serve()
+    {
+        while (!m_shutdown)
+        {
+            pollfd fds[2] { {m_listenFd, POLLIN, 0}, {m_wakePipe[0], POLLIN, 0} };
+            if (poll(fds, 2, -1) < 0 && errno != EINTR)
+                return;
+
+            if (fds[1].revents)
+            {
+                char drain[64];
+                while (read(m_wakePipe[0], drain, sizeof(drain)) > 0);
+            }
+
+            if (m_shutdown || !(fds[0].revents & POLLIN))
+                continue;
+
+            m_clientFd = accept(m_listenFd, nullptr, nullptr);
+            if (m_clientFd < 0)
+                continue;
+
+            int noDelay = 1;
+            setsockopt(m_clientFd, IPPROTO_TCP, TCP_NODELAY, &noDelay, sizeof(noDelay));
+
+            serveClient();
+
+            close(m_clientFd);
+            m_clientFd = -1;
+        }
+    }
+
+    void GdbServer::serveClient()
+    {
+        m_inBuffer.clear();
+        m_noAck = false;
+
+        // gdb expects to find the target stopped when it attaches
+        stopTarget();
+        bool isRunning = false;
+
+        while (!m_shutdown)
+        {
+            pollfd fds[2] { {m_clientFd, POLLIN, 0}, {m_wakePipe[0], POLLIN, 0} };
+            if (poll(fds, 2, -1) < 0 && errno != EINTR)
+                break;
+
+            if (fds[1].revents)
+            {
+                char drain[64];
+                while (read(m_wakePipe[0], drain, sizeof(drain)) > 0);
+
+                if (isRunning && isStopped())
+                {
+                    sendPacket(stopReply(false));
+                    isRunning = false;
+                }
+            }
+
+            if (fds[0].revents && !handleInput(isRunning))
+                break;
+        }
+
+        detachClient();
+    }
+
+    void GdbServer::detachClient()
+    {
+        if (m_shutdown)
+            return;
+
+        stopTarget();
+
+        for (uint16_t addr : m_breakpoints)
+            m_debugger.removeBreakpoint(addr);
+        for (const auto& [addr, len, access] : m_watchpoints)
+            m_debugger.removeWatchpoint(addr, len, access);
+
+        m_breakpoints.clear();
+        m_watchpoints.clear();
+
+        resumeTarget(false);
+    }
+
+    bool GdbServer::handleInput(bool& isRunning)
+    {
+        char chunk[4096];
+        const ssize_t n = read(m_clientFd, chunk, sizeof(chunk));
+        if (n <= 0)
+            return false;
+
+        m_inBuffer.append(chunk, n);
+
+        while (!m_inBuffer.empty())
+        {
+            const char c = m_inBuffer[0];
+
+            if (c == 0x03)
+            {
+                m_inBuffer.erase(0, 1);
+                if (isRunning)
+                {
+                    stopTarget();
+                    sendPacket(stopReply(true));
+                    isRunning = false;
+                }
+                continue;
+            }
+
+            if (c != '$')
+            {
+                // acks and line noise
+                m_inBuffer.erase(0, 1);
+                continue;
+            }
+
+            const size_t end = m_inBuffer.find('#');
+            if (end == std::string::npos || m_inBuffer.size() < end + 3)
+                break;
+
+            const std::string packet = m_inBuffer.substr(1, end - 1);
+            const std::string checksum = m_inBuffer.substr(end + 1, 2);
+            m_inBuffer.erase(0, end + 3);
+
+            uint8_t sum = 0;
+            for (char ch : packet) sum += static_cast<uint8_t>(ch);
+
+            if (!m_noAck)
+            {
+                if (fromHexBytes(checksum) != sum)
+                {
+                    writeAll("-");
+                    continue;
+                }
+                writeAll("+");
+            }
+
+            if (packet == "k")
+            {
+                std::lock_guard<std::mutex> lock{m_mutex};
+                m_isKilled = true;
+                m_stateChanged.notify_all();
+                return false;
+            }
+
+            bool resumes = false;
+            const std::string reply = handlePacket(packet, resumes);
+
+            if (resumes)
+                isRunning = true;
+            else
+                sendPacket(reply);
+
+            if (packet == "D")
+                return false;
+        }
+
+        return true;
+    }
+
+    std::string GdbServer::handlePacket(const std::string& packet, bool& resumes)
+    {
+        const char cmd = packet[0];
+        const std::string args = packet.substr(1);
+
+        try
+        {
+            switch (cmd)
+            {
+                case '?':
+                    return stopReply(false);
+
+                case 'g':
+                    return readRegisters();
+
+                case 'G':
+                    for (int reg = 0, pos = 0; reg < c_regCount; pos += 2 * regBytes(reg), reg++)
+                    {
+                        const long val = fromHexBytes(args.substr(pos, 2 * regBytes(reg)));
+                        if (val < 0 || (reg != c_regSP && !writeRegister(reg, val)))
+                            return "E01";
+                    }
+                    return "OK";
+
+                case 'p':
+                    return readRegister(parseHex(args));
+
+                case 'P':
+                {
+                    const size_t eq = args.find('=');
+                    const long val = fromHexBytes(args.substr(eq + 1));
+                    return val >= 0 && writeRegister(parseHex(args.substr(0, eq)), val) ? "OK" : "E01";
+                }
+
+                case 'm':
+                {
+                    const size_t comma = args.find(',');
+                    return readMemory(parseHex(args.substr(0, comma)), parseHex(args.substr(comma + 1)));
+                }
+
+                case 'M':
+                {
+                    const size_t colon = args.find(':');
+                    return writeMemory(parseHex(args.substr(0, args.find(','))), args.substr(colon + 1)) ? "OK" : "E01";
+                }
+
+                case 'Z':
+                case 'z':
+                    return setPoint(packet, cmd == 'Z');
+
+                case 'c':
+                case 's':
+                    if (!args.empty())
+                        writeRegister(c_regPC, parseHex(args));
+
+                    resumeTarget(cmd == 's');
+                    resumes = true;
+                    return "";
+
+                case 'D':
+                    return "OK";
+
+                case 'H':
+                    return "OK";
+
+                case 'T':
+                    return "OK";
+
+                default:
+                    break;
+            }
+
+            if (packet.rfind("qSupported", 0) == 0)
+                return "PacketSize=4000;qXfer:features:read+;QStartNoAckMode+;swbreak+;hwbreak+";
+
+            if (packet == "QStartNoAckMode")
+            {
+                sendPacket("OK");
+                m_noAck = true;
+                return "";
+            }
+
+            if (packet.rfind("qXfer:features:read:target.xml:", 0) == 0)
+            {
+                const std::string range = packet.substr(packet.rfind(':') + 1);
+                const size_t offset = parseHex(range.substr(0, range.find(',')));
+                const size_t length = parseHex(range.substr(range.find(',') + 1));
+
+                const std::string xml = targetXml();
+                if (offset >= xml.size())
+                    return "l";
+
+                const std::string part = xml.substr(offset, length);
+                return (offset + part.size() >= xml.size() ? "l" : "m") + part;
+            }
+
+            if (packet == "qAttached") return "1";
+            if (packet == "qC") return "QC1";
+            if (packet == "qfThreadInfo") return "m1";
+            if (packet == "qsThreadInfo") return "l";
+            if (packet == "qSymbol::") return "OK";
+        }
+        catch (const std::exception&)
+        {
+            return "E01";
+        }
+
+        return "";
+    }
+
+    std::string GdbServer::readRegisters()
+    {
+        std::string hex;
+        for (int reg = 0; reg < c_regCount; reg++)
+            hex += readRegister(reg);
+        return hex;
+    }
+
+    std::string GdbServer::readRegister(int reg)
+    {
+        if (reg < 0 || reg >= c_regCount)
+            return "E01";
+
+        std::lock_guard<std::mutex> lock{m_mutex};
+        if (!m_isStopped)
+            return "E02";
+
+        chip8::Cpu* cpu = m_interpreter.cpu();
+        uint16_t val {};
+        switch (reg)
+        {
+            case c_regI:  val = cpu->readI(); break;
+            case c_regPC: val = cpu->readPC(); break;
+            case c_regSP: val = static_cast<uint16_t>(cpu->stackDepth()); break;
+            case c_regDT: val = cpu->delayTimer(); break;
+            case c_regST: val = cpu->soundTimer(); break;
+            default:      val = cpu->readRegister(reg); break;
+        }
+
+        return toHex(val, regBytes(reg));
+    }
+
+    bool GdbServer::writeRegister(int reg, uint16_t val)
+    {
+        if (reg < 0 || reg >= c_regCount || reg == c_regSP)
+            return false;
+
+        std::lock_guard<std::mutex> lock{m_mutex};
+        if (!m_isStopped)
+            return false;
+
+        chip8::Cpu* cpu = m_interpreter.cpu();
+        switch (reg)
+        {
+            case c_regI:  cpu->writeI(val); break;
+            case c_regPC: cpu->writePC(val); break;
+            case c_regDT: cpu->setDelayTimer(val); break;
+            case c_regST: cpu->setSoundTimer(val); break;
+            default:      cpu->writeRegister(reg, val); break;
+        }
+
+        return true;
+    }
+
+    std::string GdbServer::readMemory(uint32_t addr, uint32_t len)
+    {
+        if (addr >= m_interpreter.memory()->size())
+            return "E01";
+
+        const bool wasRunning = !isStopped();
+        if (wasRunning)
+            stopTarget();
+
+        std::string hex;
+        {
+            std::lock_guard<std::mutex> lock{m_mutex};
+            for (uint32_t i = addr; i < addr + len && i < m_interpreter.memory()->size(); i++)
+                hex += toHex(m_interpreter.memory()->read(i), 1);
+        }
+
+        if (wasRunning)
+            resumeTarget(false);
+
+        return hex;
+    }
+
+    bool GdbServer::writeMemory(uint32_t addr, const std::string& hex)
+    {
+        if (addr + hex.size() / 2 > m_interpreter.memory()->size())
+            return false;
+
+        const bool wasRunning = !isStopped();
+        if (wasRunning)
+            stopTarget();
+
+        bool ok = true;
+        {
+            std::lock_guard<std::mutex> lock{m_mutex};
+            for (size_t i = 0; i + 1 < hex.size() && ok; i += 2)
+            {
+                const long val = fromHexBytes(hex.substr(i, 2));
+                ok = val >= 0;
+                if (ok)
+                    m_interpreter.memory()->write(addr + i / 2, static_cast<uint8_t>(val));
+            }
+        }
+
+        if (wasRunning)
+            resumeTarget(false);
+
+        return ok;
+    }
+
+    std::string GdbServer::setPoint(const std::string& packet, bool insert)
+    {
+        // Z<type>,<addr>,<kind or len>
+        const char type = packet[1];
+        const size_t first = packet.find(',');
+        const size_t second = packet.find(',', first + 1);
+        const uint16_t addr = static_cast<uint16_t>(parseHex(packet.substr(first + 1, second - first - 1)));
+        const uint16_t len = static_cast<uint16_t>(parseHex(packet.substr(second + 1)));
+
+        if (addr >= m_interpreter.memory()->size())
+            return "E01";
+
+        Debugger::Access access {};
+        switch (type)
+        {
+            case '0':
+            case '1':
+                break;
+            case '2': access = Debugger::Access::Write; break;
+            case '3': access = Debugger::Access::Read; break;
+            case '4': access = Debugger::Access::ReadWrite; break;
+            default:
+                return "";
+        }
+
+        const bool wasRunning = !isStopped();
+        if (wasRunning)
+            stopTarget();
+
+        {
+            std::lock_guard<std::mutex> lock{m_mutex};
+            if (type == '0' || type == '1')
+            {
+                insert ? m_debugger.addBreakpoint(addr) : m_debugger.removeBreakpoint(addr);
+                insert ? (void)m_breakpoints.insert(addr) : (void)m_breakpoints.erase(addr);
+            }
+            else
+            {
+                insert ? m_debugger.addWatchpoint(addr, len, access) : m_debugger.removeWatchpoint(addr, len, access);
+                insert ? (void)m_watchpoints.insert({addr, len, access}) : (void)m_watchpoints.erase({addr, len, access});
+            }
+        }
+
+        if (wasRunning)
+            resumeTarget(false);
+
+        return "OK";
+    }
+
+    std::string GdbServer::stopReply(bool interrupted)
+    {
+        if (interrupted)
+            return "S02";
+
+        std::lock_guard<std::mutex> lock{m_mutex};
+        if (m_debugger.stopReason() != Debugger::StopReason::Watchpoint)
+            return "S05";
+
+        const char* kind = m_debugger.watchAccess() == Debugger::Access::Read ? "rwatch" : "watch";
+        return std::string("T05") + kind + ':' + toHex(m_debugger.watchAddr() >> 8, 1) + toHex(m_debugger.watchAddr() & 0xFF, 1) + ';';
+    }
+
+    void GdbServer::sendPacket(const std::string& payload)
+    {
+        uint8_t sum = 0;
+        for (char c : payload) sum += static_cast<uint8_t>(c);
+
+        writeAll('$' + payload + '#' + c_hexDigits[sum >> 4] + c_hexDigits[sum & 0xF]);
+    }
+
+    void GdbServer::writeAll(const std::string& data)
+    {
+        for (size_t sent = 0; sent < data.size();)
+        {
+            const ssize_t n = write(m_clientFd, data.data() + sent, data.size() - sent);
+            if (n <= 0)
+                return;
+            sent += n;
+        }
+    }
+
+    bool GdbServer::isStopped()
+    {
+        std::lock_guard<std::mutex> lock{m_mutex};
+        return m_isStopped;
+    }
+
+    void GdbServer::stopTarget()
+    {
+        if (isStopped())
+            return;
+
+        m_debugger.pause();
+
+        std::unique_lock<std::mutex> lock{m_mutex};
+        m_stateChanged.wait(lock, [this]() { return m_isStopped || m_shutdown; });
+    }
+
+    void GdbServer::resumeTarget(bool step)
+    {
+        std::lock_guard<std::mutex> lock{m_mutex};
+        if (!m_isStopped)
+            return;
+
+        step ? m_debugger.step() : m_debugger.resume();
+        m_isStopped = false;
+        m_stateChanged.notify_all();
+    }
+
+    void GdbServer::wake()
+    {
+        const char byte = 0;
+        (void)!write(m_wakePipe[1], &byte, 1);
+    }
+}
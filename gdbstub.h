@@ -0,0 +1,107 @@
+#ifndef GDBSTUB_H
+#define GDBSTUB_H
+
+#include <stdint.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <tuple>
+
+#include "debugger.h"
+
+namespace chip8
+{
+    class Interpreter;
+
+    /**
+     * GDB remote serial protocol server for an Interpreter.
+     *
+     * Serves one client at a time on its own thread. The emulation thread is
+     * only parked while the client keeps the target stopped, or for the
+     * duration of a packet that needs the machine while it is running, so an
+     * attached but idle client does not slow emulation down.
+     *
+     * Registers as described to gdb, all little endian:
+     *  0-15 V0-VF (8 bit), 16 I (16 bit), 17 PC (16 bit),
+     *  18 SP (8 bit, read only), 19 DT (8 bit), 20 ST (8 bit)
+    **/
+    class GdbServer
+    {
+    public:
+        /**
+         * interpreter and debugger have to outlive the server
+        **/
+        GdbServer(chip8::Interpreter& interpreter, chip8::Debugger& debugger);
+        ~GdbServer();
+
+        GdbServer(const GdbServer&) = delete;
+        GdbServer& operator=(const GdbServer&) = delete;
+
+        /**
+         * starts serving on address
+         * @param address a TCP port on the loopback interface, or unix:<path>
+         * @throws runtime_error if it is unable to listen on address
+        **/
+        void listen(const std::string& address);
+
+        /**
+         * to be called by the emulation thread whenever the interpreter stops,
+         * blocks till the client resumes the target.
+         * @returns false if the client killed the target
+        **/
+        bool serveWhileStopped();
+
+    private:
+        chip8::Interpreter& m_interpreter;
+        chip8::Debugger& m_debugger;
+
+        int m_listenFd {-1};
+        int m_clientFd {-1};
+        int m_wakePipe[2] {-1, -1};
+        std::string m_unixPath {};
+
+        std::thread m_thread {};
+        std::atomic<bool> m_shutdown {};
+
+        // handshake with the emulation thread
+        std::mutex m_mutex {};
+        std::condition_variable m_stateChanged {};
+        bool m_isStopped {};
+        bool m_isKilled {};
+
+        // per client state, only touched by the server thread
+        std::string m_inBuffer {};
+        bool m_noAck {};
+        std::set<uint16_t> m_breakpoints {};
+        std::set< std::tuple<uint16_t, uint16_t, Debugger::Access> > m_watchpoints {};
+
+        void serve();
+        void serveClient();
+        void detachClient();
+
+        bool handleInput(bool& isRunning);
+        std::string handlePacket(const std::string& packet, bool& resumes);
+
+        std::string readRegisters();
+        std::string readRegister(int reg);
+        bool writeRegister(int reg, uint16_t val);
+        std::string readMemory(uint32_t addr, uint32_t len);
+        bool writeMemory(uint32_t addr, const std::string& hex);
+        std::string setPoint(const std::string& packet, bool insert);
+
+        std::string stopReply(bool interrupted);
+        void sendPacket(const std::string& payload);
+        void writeAll(const std::string& data);
+
+        bool isStopped();
+        void stopTarget();
+        void resumeTarget(bool step);
+        void wake();
+    };
+}
+
+#endif /* GDBSTUB_H */
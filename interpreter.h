@@ -0,0 +1,762 @@
+#ifndef INTERPRETER_H
+#define INTERPRETER_H
+
+#include <stdint.h>
+
+#include <algorithm>
+#include <atomic>
+#include <fstream>
+#include <functional>
+#include <vector>
+
+#include "chip8.h"
+#include "debugger.h"
+#include "latency.h"
+#include "tableengine.h"
+
+namespace chip8
+{
+    /**
+     * What the rom did so far, for monitoring, see Interpreter::counters()
+    **/
+    struct Counters
+    {
+        uint64_t draws;             // Dxyn executed
+        uint64_t collisions;        // Dxyn setting VF
+        uint8_t stackHighWater;     // deepest call stack seen
+    };
+
+    /**
+     * The whole machine state, see Interpreter::save()
+    **/
+    struct Snapshot
+    {
+        chip8::Memory::Ram ram;
+        chip8::Cpu::State cpu;
+        std::vector<uint64_t> screen;
+        chip8::Display::Mode displayMode;
+        bool isFrameDrawn;
+        uint32_t random;
+        uint64_t instructions;
+        Counters counters;
+    };
+
+    /**
+     * Headless CHIP-8 machine.
+     * Owns the chip8 components and maps instructions to operations on them,
+     * knows nothing about windows or host input devices.
+     *
+     * The instructions are executed with the quirks of the platform the rom
+     * was loaded for, by a dispatch specialized on its QuirkProfile.
+    **/
+    class Interpreter
+    {
+    public:
+        /**
+         * how untraced instructions are dispatched, both do the same
+        **/
+        enum class Engine
+        {
+            Switch,     // execute(), decoding every instruction
+            Table       // TableEngine, a handler per opcode
+        };
+
+        // Cxnn draws from a generator of its own, so a run only depends on the machine state
+        static constexpr uint32_t k_randomSeed = 0x2545F491;
+
+        Interpreter(std::ifstream& rom, Platform platform = Platform::CosmacVip)
+            :   Interpreter(new chip8::Memory{rom, platform}, platform)
+        { }
+
+        /**
+         * @param rom, size the rom image, e.g. a MappedRom or a RomCatalog image
+         * @param platform the rom was written for, see detectPlatform(). XO-CHIP
+         *  gets its memory, display and instructions, the others run CHIP-8.
+         *  all get the quirks of their platform, see visitProfile().
+        **/
+        Interpreter(const uint8_t* rom, size_t size, Platform platform = Platform::CosmacVip)
+            :   Interpreter(new chip8::Memory{rom, size, platform}, platform)
+        { }
+
+        ~Interpreter()
+        {
+            delete m_chip8Display;
+            delete m_chip8Memory;
+            delete m_chip8Cpu;
+            delete m_chip8Keypad;
+        }
+
+        Interpreter(const Interpreter&) = delete;
+        Interpreter& operator=(const Interpreter&) = delete;
+
+        chip8::Memory* memory() { return m_chip8Memory; }
+        chip8::Cpu* cpu() { return m_chip8Cpu; }
+        chip8::Keypad* keypad() { return m_chip8Keypad; }
+        chip8::Display* display() { return m_chip8Display; }
+
+        Platform platform() const { return m_platform; }
+
+        /**
+         * @returns the instruction stored at PC
+        **/
+        uint16_t fetch()
+        {
+            return m_chip8Memory->readWord(m_chip8Cpu->readPC());
+        }
+
+        /**
+         * executes the instruction at PC.
+         * @returns
+         *  false if an attached debugger stopped the machine, true otherwise
+        **/
+        bool step() { return m_step.load(std::memory_order_relaxed)(*this); }
+
+        /**
+         * copies the memory, cpu and display state into snapshot.
+         * allocates nothing once snapshot held a state of this machine.
+        **/
+        void save(Snapshot& snapshot) const
+        {
+            m_chip8Memory->copyTo(snapshot.ram);
+            snapshot.cpu = m_chip8Cpu->state();
+            snapshot.screen = m_chip8Display->screenBuffer();
+            snapshot.displayMode = m_chip8Display->mode();
+            snapshot.isFrameDrawn = m_isFrameDrawn;
+            snapshot.random = m_random;
+            snapshot.instructions = m_instructions;
+            snapshot.counters = m_counters;
+        }
+
+        /**
+         * puts the machine back to a state save() took of it.
+         * the keypad is left alone, it belongs to the host.
+        **/
+        void restore(const Snapshot& snapshot)
+        {
+            m_chip8Memory->setRam(snapshot.ram);
+            m_chip8Cpu->setState(snapshot.cpu);
+            m_chip8Display->setScreenBuffer(snapshot.screen);
+            m_chip8Display->setMode(snapshot.displayMode);
+            m_isFrameDrawn = snapshot.isFrameDrawn;
+            m_random = snapshot.random;
+            m_instructions = snapshot.instructions;
+            m_counters = snapshot.counters;
+        }
+
+        /**
+         * forks the machine, the copy going on from the same state. memory
+         * pages are shared until either writes to one, so this costs a few
+         * small allocations whatever the rom did. the copy may run on
+         * another thread, independently of this one, but this one may not
+         * run while being cloned.
+         * the engine is kept, the debugger, key wait and latency tracker are not.
+         * @returns a new interpreter, to be deleted by the caller
+        **/
+        Interpreter* clone() { return new Interpreter{this}; }
+
+        /**
+         * powers the machine on again with rom loaded, as a new Interpreter
+         * would start but without allocating anything, unless memory pages
+         * are shared with a clone or platform needs a larger machine. the
+         * engine and everything attached are kept.
+         * @throws runtime_error if size > Memory::maxRomSize(platform)
+        **/
+        void reset(const uint8_t* rom, size_t size, Platform platform = Platform::CosmacVip)
+        {
+            m_chip8Memory->load(rom, size, platform);
+            m_chip8Cpu->setState({});
+            m_chip8Cpu->writePC(m_chip8Memory->romStartAddress());
+            m_chip8Keypad->setKeys(0);
+            m_chip8Display->reset(platform);
+            m_platform = platform;
+            m_step.store(stepFor(m_engine, m_isTraced.load()));
+            m_isFrameDrawn = false;
+            m_random = k_randomSeed;
+            m_instructions = 0;
+            m_counters = {};
+        }
+
+        /**
+         * @returns no. of instructions executed since the machine started,
+         *  the emulated time
+        **/
+        uint64_t instructions() const { return m_instructions; }
+
+        /**
+         * @returns what the rom did since the machine started, part of the
+         *  state save() takes, so run-ahead leaves no trace in it
+        **/
+        const Counters& counters() const { return m_counters; }
+
+        /**
+         * @returns the state of the generator Cxnn draws from, see save()
+        **/
+        uint32_t randomState() const { return m_random; }
+
+        /**
+         * @returns true if Dxyn drew since the frame started, see Quirks::displayWait
+        **/
+        bool isFrameDrawn() const { return m_isFrameDrawn; }
+
+        /**
+         * @param state not 0, e.g. to have machines running the same rom draw other numbers
+        **/
+        void setRandomState(uint32_t state) { m_random = state; }
+
+        /**
+         * ends the frame, counting the timers down
+        **/
+        void decrementTimers()
+        {
+            m_isFrameDrawn = false;
+
+            const uint8_t dt = m_chip8Cpu->delayTimer();
+            if (dt > 0)
+                m_chip8Cpu->setDelayTimer(dt - 1);
+
+            const uint8_t st = m_chip8Cpu->soundTimer();
+            if (st > 0)
+                m_chip8Cpu->setSoundTimer(st - 1);
+        }
+
+        /**
+         * @param keyWait
+         *  blocks until a key is pressed and returns it, used by Fx0A.
+         *  if not set Fx0A is re-executed until a key is held in the keypad.
+        **/
+        void setKeyWait(std::function<uint8_t()> keyWait) { m_keyWait = keyWait; }
+
+        /**
+         * @param latency told about key reads and draws, nullptr to stop
+        **/
+        void setLatencyTracker(chip8::LatencyTracker* latency) { m_latency = latency; }
+
+        /**
+         * switches between the plain dispatch and the one that reports every
+         * instruction and memory access to the attached debugger.
+         * called by the debugger whenever something gets armed or disarmed,
+         * so nothing is checked per instruction while nothing is armed.
+         * may be called from any thread.
+        **/
+        void setTraced(bool traced)
+        {
+            m_isTraced.store(traced);
+            m_step.store(stepFor(m_engine, traced));
+        }
+
+        /**
+         * picks the dispatch used while nothing is traced, the switch unless set.
+         * to be called before the rom runs.
+        **/
+        void setEngine(Engine engine)
+        {
+            m_engine = engine;
+            m_step.store(stepFor(engine, m_isTraced.load()));
+        }
+
+    private:
+        friend class Debugger;
+        friend class TableEngine;
+
+        using Step = bool (*)(Interpreter&);
+
+        chip8::Memory* m_chip8Memory {};
+        chip8::Cpu* m_chip8Cpu {};
+        chip8::Keypad* m_chip8Keypad {};
+        chip8::Display* m_chip8Display {};
+
+        Platform m_platform;
+
+        chip8::Debugger* m_debugger {};
+
+        std::function<uint8_t()> m_keyWait {};
+
+        chip8::LatencyTracker* m_latency {};
+
+        // Dxyn drew since the frame started, for Quirks::displayWait
+        bool m_isFrameDrawn {};
+
+        uint32_t m_random { k_randomSeed };
+
+        uint64_t m_instructions {};
+        Counters m_counters {};
+
+        Engine m_engine { Engine::Switch };
+        std::atomic<bool> m_isTraced {};
+
+        // stepFor(m_engine, m_isTraced)
+        std::atomic<Step> m_step {};
+
+        Interpreter(chip8::Memory* memory, Platform platform)
+            :   m_chip8Memory(memory),
+                m_chip8Cpu(new chip8::Cpu{}),
+                m_chip8Keypad(new chip8::Keypad{}),
+                m_chip8Display(new chip8::Display{platform}),
+                m_platform(platform),
+                m_step(stepFor(Engine::Switch, false))
+        {
+            m_chip8Cpu->writePC(m_chip8Memory->romStartAddress());
+        }
+
+        /**
+         * see clone()
+        **/
+        explicit Interpreter(Interpreter* original)
+            :   m_chip8Memory(original->m_chip8Memory->clone()),
+                m_chip8Cpu(new chip8::Cpu{}),
+                m_chip8Keypad(new chip8::Keypad{}),
+                m_chip8Display(original->m_chip8Display->clone()),
+                m_platform(original->m_platform),
+                m_isFrameDrawn(original->m_isFrameDrawn),
+                m_random(original->m_random),
+                m_instructions(original->m_instructions),
+                m_counters(original->m_counters),
+                m_engine(original->m_engine),
+                m_step(stepFor(m_engine, false))
+        {
+            m_chip8Cpu->setState(original->m_chip8Cpu->state());
+            m_chip8Keypad->setKeys(original->m_chip8Keypad->keys());
+        }
+
+        /**
+         * @returns the next number of a xorshift32 generator
+        **/
+        uint32_t nextRandom()
+        {
+            m_random ^= m_random << 13;
+            m_random ^= m_random >> 17;
+            m_random ^= m_random << 5;
+            return m_random;
+        }
+
+        /**
+         * @returns the step of engine, or the traced one, specialized on the
+         *  quirk profile of m_platform
+        **/
+        Step stepFor(Engine engine, bool traced) const
+        {
+            return visitProfile(m_platform, [engine, traced](auto profile) -> Step
+            {
+                using Profile = decltype(profile);
+
+                if (traced)
+                    return &Interpreter::stepImpl<Profile, true>;
+
+                return engine == Engine::Table ? &TableEngine::step<Profile> : &Interpreter::stepImpl<Profile, false>;
+            });
+        }
+
+        /**
+         * @returns no. of bytes of the instruction after the one at PC, which
+         *  skips jump over. on XO-CHIP F000 nnnn is 4 bytes long.
+        **/
+        template <typename Profile>
+        uint16_t skipSize() const
+        {
+            if constexpr (Profile::k_isXoChip)
+            {
+                const uint32_t next = m_chip8Cpu->state().PC + 2;
+                return next + 1 < m_chip8Memory->size() && m_chip8Memory->readWord(next) == 0xF000 ? 4 : 2;
+            }
+            else
+                return 2;
+        }
+
+        template <typename Profile>
+        void skip() { m_chip8Cpu->writePC(m_chip8Cpu->readPC() + skipSize<Profile>()); }
+
+        template <typename Profile, bool Traced>
+        static bool stepImpl(Interpreter& self)
+        {
+            if constexpr (Traced)
+            {
+                if (!self.m_debugger->beforeExecute(self.m_chip8Cpu->readPC()))
+                    return false;
+
+                self.execute<Profile, true>(self.fetch());
+                self.m_instructions++;
+                return self.m_debugger->afterExecute();
+            }
+            else
+            {
+                self.execute<Profile, false>(self.fetch());
+                self.m_instructions++;
+                return true;
+            }
+        }
+
+        template <bool Traced>
+        uint8_t readMemory(uint16_t addr)
+        {
+            const uint8_t val = m_chip8Memory->read(addr);
+
+            if constexpr (Traced)
+                m_debugger->onAccess(addr, Debugger::Access::Read);
+
+            return val;
+        }
+
+        template <bool Traced>
+        void writeMemory(uint16_t addr, uint8_t val)
+        {
+            m_chip8Memory->write(addr, val);
+
+            if constexpr (Traced)
+                m_debugger->onAccess(addr, Debugger::Access::Write);
+        }
+
+        template <typename Profile, bool Traced>
+        void execute(const uint16_t instruction)
+        {
+            constexpr Quirks quirks = Profile::k_quirks;
+
+            bool shallInc = true;
+
+            switch (instruction & 0xF000)
+            {
+            case 0x0:
+                switch (instruction)
+                {
+                case 0xE0:
+                        m_chip8Display->clear();
+                    break;
+
+                case 0xEE:
+                    m_chip8Cpu->writePC(m_chip8Cpu->peekStack());
+                    m_chip8Cpu->popStack();
+                    break;
+
+                case 0xFB:
+                    if constexpr (Profile::k_hasHires)
+                        m_chip8Display->scroll(4, 0);
+                    break;
+
+                case 0xFC:
+                    if constexpr (Profile::k_hasHires)
+                        m_chip8Display->scroll(-4, 0);
+                    break;
+
+                case 0xFE:
+                case 0xFF:
+                    if constexpr (Profile::k_hasHires)
+                        m_chip8Display->setLowRes(instruction == 0xFE);
+                    break;
+
+                default:
+                    if (Profile::k_hasHires && (instruction & 0xFFF0) == 0xC0)
+                        m_chip8Display->scroll(0, instruction & 0xF);
+                    else if (Profile::k_isXoChip && (instruction & 0xFFF0) == 0xD0)
+                        m_chip8Display->scroll(0, -(instruction & 0xF));
+                    break;
+                }
+                break;
+
+            case 0x1000:
+                m_chip8Cpu->writePC(instruction & 0x0FFF);
+                shallInc = false;
+                break;
+
+            case 0x2000:
+                m_chip8Cpu->pushStack(m_chip8Cpu->readPC());
+                m_chip8Cpu->writePC(instruction & 0x0FFF);
+                m_counters.stackHighWater = std::max<uint8_t>(m_counters.stackHighWater, m_chip8Cpu->stackDepth());
+                shallInc = false;
+                break;
+
+            case 0x3000:
+                if (m_chip8Cpu->readRegister((instruction & 0x0F00) >> 8) == (instruction & 0xFF))
+                    skip<Profile>();
+                break;
+
+            case 0x4000:
+                if (m_chip8Cpu->readRegister((instruction & 0x0F00) >> 8) != (instruction & 0xFF))
+                    skip<Profile>();
+                break;
+
+            case 0x5000:
+                if (Profile::k_isXoChip && ((instruction & 0xF) == 0x2 || (instruction & 0xF) == 0x3))
+                {
+                    // Vx to Vy, counting down if x > y, saved at I on or loaded from there
+                    const uint8_t regX = (instruction & 0x0F00) >> 8;
+                    const uint8_t regY = (instruction & 0xF0) >> 4;
+                    const int8_t dir = regX <= regY ? 1 : -1;
+
+                    for (uint8_t i = 0; i <= abs(regY - regX); i++)
+                    {
+                        const uint8_t reg = regX + i * dir;
+                        if ((instruction & 0xF) == 0x2)
+                            writeMemory<Traced>(m_chip8Cpu->readI() + i, m_chip8Cpu->readRegister(reg));
+                        else
+                            m_chip8Cpu->writeRegister(reg, readMemory<Traced>(m_chip8Cpu->readI() + i));
+                    }
+                }
+                else if (m_chip8Cpu->readRegister((instruction & 0x0F00) >> 8) == m_chip8Cpu->readRegister((instruction & 0xF0) >> 4))
+                    skip<Profile>();
+                break;
+
+            case 0x6000:
+                m_chip8Cpu->writeRegister((instruction & 0x0F00) >> 8, instruction & 0xFF);
+                break;
+
+            case 0x7000:
+                {
+                uint8_t reg = (instruction & 0xF00) >> 8;
+                m_chip8Cpu->writeRegister(reg, m_chip8Cpu->readRegister(reg) + (instruction & 0xFF));
+                }
+                break;
+
+            case 0x8000:
+                {
+
+                uint8_t regX = (instruction & 0x0F00) >> 8;
+                uint8_t regY = (instruction & 0xF0) >> 4;
+
+                uint8_t valX = m_chip8Cpu->readRegister(regX);
+                uint8_t valY = m_chip8Cpu->readRegister(regY);
+
+                switch (instruction & 0xF)
+                {
+                case 0x0:
+                    m_chip8Cpu->writeRegister(regX, valY);
+                    break;
+
+                case 0x1:
+                    m_chip8Cpu->writeRegister(regX, valX | valY);
+                    if constexpr (quirks.logicResetsVf)
+                        m_chip8Cpu->writeRegister(0xF, 0);
+                    break;
+
+                case 0x2:
+                    m_chip8Cpu->writeRegister(regX, valX & valY);
+                    if constexpr (quirks.logicResetsVf)
+                        m_chip8Cpu->writeRegister(0xF, 0);
+                    break;
+
+                case 0x3:
+                    m_chip8Cpu->writeRegister(regX, valX ^ valY);
+                    if constexpr (quirks.logicResetsVf)
+                        m_chip8Cpu->writeRegister(0xF, 0);
+                    break;
+
+                case 0x4:
+                    m_chip8Cpu->writeRegister(regX, valX + valY);
+                    m_chip8Cpu->writeRegister(0xF, (static_cast<uint16_t>(valX) + static_cast<uint16_t>(valY)) > 255);
+                    break;
+
+                case 0x5:
+                    m_chip8Cpu->writeRegister(regX, valX - valY);
+                    m_chip8Cpu->writeRegister(0xF, valX > valY);
+                    break;
+
+                case 0x6:
+                    {
+                    const uint8_t shifted = quirks.shiftUsesVy ? valY : valX;
+                    m_chip8Cpu->writeRegister(regX, shifted >> 1);
+                    m_chip8Cpu->writeRegister(0xF, shifted & 1);
+                    }
+                    break;
+
+                case 0x7:
+                    m_chip8Cpu->writeRegister(regX, valY - valX);
+                    m_chip8Cpu->writeRegister(0xF, valY > valX);
+                    break;
+
+                case 0xE:
+                    {
+                    const uint8_t shifted = quirks.shiftUsesVy ? valY : valX;
+                    m_chip8Cpu->writeRegister(regX, shifted << 1);
+                    m_chip8Cpu->writeRegister(0xF, (shifted & (1 << 7)) >> 7);
+                    }
+                    break;
+
+                default:
+                    break;
+                }
+                }
+                break;
+
+            case 0x9000:
+                if (m_chip8Cpu->readRegister((instruction & 0x0F00) >> 8) != m_chip8Cpu->readRegister((instruction & 0xF0) >> 4))
+                    skip<Profile>();
+                break;
+
+            case 0xA000:
+                m_chip8Cpu->writeI(instruction & 0xFFF);
+                break;
+
+            case 0xB000:
+                m_chip8Cpu->writePC((instruction & 0xFFF) + m_chip8Cpu->readRegister(quirks.jumpUsesVx ? (instruction & 0x0F00) >> 8 : 0x0));
+                shallInc = false;
+                break;
+
+            case 0xC000:
+                m_chip8Cpu->writeRegister((instruction & 0x0F00) >> 8, (instruction & 0xFF) & (nextRandom() % 256));
+                break;
+
+            case 0xD000:
+                {
+                // waiting for the next frame executes this again
+                if constexpr (quirks.displayWait)
+                {
+                    if (m_isFrameDrawn)
+                    {
+                        shallInc = false;
+                        break;
+                    }
+                    m_isFrameDrawn = true;
+                }
+
+                uint8_t x = m_chip8Cpu->readRegister((instruction & 0x0F00) >> 8);
+                uint8_t y = m_chip8Cpu->readRegister((instruction & 0xF0) >> 4);
+
+                uint8_t n = instruction & 0xF;
+                const uint8_t size = m_chip8Display->spriteSize(n);
+
+                uint8_t sprite[Display::k_maxSpriteSize] {};
+                for (uint16_t i = 0; i < size; i++)
+                    sprite[i] = readMemory<Traced>(m_chip8Cpu->readI() + i);
+
+                const bool collided = m_chip8Display->attachSprite<quirks.spritesWrap>(sprite, n, x, y);
+                m_chip8Cpu->writeRegister(0xF, collided);
+                m_counters.draws++;
+                m_counters.collisions += collided;
+
+                if (m_latency && std::any_of(sprite, sprite + size, [](uint8_t row) { return row != 0; }))
+                    m_latency->drawn();
+                }
+                break;
+
+            case 0xE000:
+                {
+                uint8_t valX = m_chip8Cpu->readRegister((instruction & 0x0F00) >> 8);
+
+                if (m_latency)
+                    m_latency->keyRead(1 << (valX & 0xF));
+
+                switch (instruction & 0xFF)
+                {
+                case 0x9E:
+                    if (m_chip8Keypad->isPressed(valX))
+                        skip<Profile>();
+                    break;
+
+                case 0xA1:
+                    if (!m_chip8Keypad->isPressed(valX))
+                        skip<Profile>();
+                    break;
+
+                default:
+                    break;
+                }
+                }
+                break;
+
+            case 0xF000:
+                {
+                    uint8_t reg = (instruction & 0xF00) >> 8;
+                    switch (instruction & 0xFF)
+                    {
+                    case 0x00:
+                        if (Profile::k_isXoChip && instruction == 0xF000)
+                        {
+                            m_chip8Cpu->writeI(m_chip8Memory->readWord(m_chip8Cpu->readPC() + 2));
+                            m_chip8Cpu->incrementPC();
+                        }
+                        break;
+
+                    case 0x01:
+                        if constexpr (Profile::k_isXoChip)
+                            m_chip8Display->selectPlanes(reg);
+                        break;
+
+                    case 0x02:
+                        if (Profile::k_isXoChip && instruction == 0xF002)
+                        {
+                            std::array<uint8_t, 16> pattern;
+                            for (uint8_t i = 0; i < pattern.size(); i++)
+                                pattern[i] = readMemory<Traced>(m_chip8Cpu->readI() + i);
+                            m_chip8Cpu->setAudioPattern(pattern);
+                        }
+                        break;
+
+                    case 0x07:
+                        m_chip8Cpu->writeRegister(reg, m_chip8Cpu->delayTimer());
+                        break;
+
+                    case 0x0A:
+                        if (m_latency)
+                            m_latency->keyRead(0xFFFF);
+
+                        if (m_keyWait)
+                        {
+                            m_chip8Cpu->writeRegister(reg, m_keyWait());
+                            break;
+                        }
+
+                        if (const uint16_t keys = m_chip8Keypad->keys())
+                            m_chip8Cpu->writeRegister(reg, __builtin_ctz(keys));
+                        else
+                            shallInc = false;
+                        break;
+
+                    case 0x15:
+                        m_chip8Cpu->setDelayTimer(m_chip8Cpu->readRegister(reg));
+                        break;
+
+                    case 0x18:
+                        m_chip8Cpu->setSoundTimer(m_chip8Cpu->readRegister(reg));
+                        break;
+
+                    case 0x1E:
+                        m_chip8Cpu->writeI(m_chip8Cpu->readI() + m_chip8Cpu->readRegister(reg));
+                        break;
+
+                    case 0x3A:
+                        if constexpr (Profile::k_isXoChip)
+                            m_chip8Cpu->setPitch(m_chip8Cpu->readRegister(reg));
+                        break;
+
+                    case 0x29:
+                        m_chip8Cpu->writeI(chip8::Memory::c_fontStartAddr + (m_chip8Cpu->readRegister(reg) & 0xF) * fonts::k_glyphSize);
+                        break;
+
+                    case 0x33:
+                        {
+                            uint8_t val = m_chip8Cpu->readRegister(reg);
+                            writeMemory<Traced>(m_chip8Cpu->readI(), val / 100);
+                            writeMemory<Traced>(m_chip8Cpu->readI() + 1, (val % 100) / 10);
+                            writeMemory<Traced>(m_chip8Cpu->readI() + 2, val % 10);
+                        }
+                        break;
+
+                    case 0x55:
+                        for (uint8_t i = 0; i <= reg; i++)
+                            writeMemory<Traced>(m_chip8Cpu->readI() + i, m_chip8Cpu->readRegister(i));
+                        if constexpr (quirks.loadStoreIncrementsI)
+                            m_chip8Cpu->writeI(m_chip8Cpu->readI() + reg + 1);
+                        break;
+
+                    case 0x65:
+                        for (uint8_t i = 0; i <= reg; i++)
+                            m_chip8Cpu->writeRegister(i, readMemory<Traced>(m_chip8Cpu->readI() + i));
+                        if constexpr (quirks.loadStoreIncrementsI)
+                            m_chip8Cpu->writeI(m_chip8Cpu->readI() + reg + 1);
+                        break;
+
+                    default:
+                        break;
+                    }
+                }
+                break;
+
+            default:
+                break;
+            }
+
+            if (shallInc)
+                m_chip8Cpu->incrementPC();
+        }
+    };
+}
+
+#endif /* INTERPRETER_H */
@@ -0,0 +1,172 @@
+#include "latency.h"
+
+#include <algorithm>
+#include <fstream>
+#include <stdexcept>
+
+namespace chip8
+{
+    namespace
+    {
+        uint64_t microsBetween(LatencyTracker::Clock::time_point from, LatencyTracker::Clock::time_point to)
+        {
+            return to > from ? std::chrono::duration_cast<std::chrono::microseconds>(to - from).count() : 0;
+        }
+    }
+
+
+    void LatencyHistogram::add(uint64_t micros)
+    {
+        m_samples.push_back(micros);
+
+        int bucket = micros ? 63 - __builtin_clzll(micros) : 0;
+        m_buckets[std::min(bucket, k_buckets - 1)]++;
+    }
+
+    void LatencyHistogram::writeJson(std::ostream& out) const
+    {
+        std::vector<uint64_t> sorted = m_samples;
+        std::sort(sorted.begin(), sorted.end());
+
+        auto percentile = [&sorted](int p) -> uint64_t
+        {
+            return sorted.empty() ? 0 : sorted[(sorted.size() - 1) * p / 100];
+        };
+
+        uint64_t sum = 0;
+        for (uint64_t sample : sorted)
+            sum += sample;
+
+        out << "{\"count\": " << sorted.size()
+            << ", \"min_us\": " << (sorted.empty() ? 0 : sorted.front())
+            << ", \"max_us\": " << (sorted.empty() ? 0 : sorted.back())
+            << ", \"mean_us\": " << (sorted.empty() ? 0 : sum / sorted.size())
+            << ", \"p50_us\": " << percentile(50)
+            << ", \"p90_us\": " << percentile(90)
+            << ", \"p99_us\": " << percentile(99)
+            << ", \"buckets\": [";
+
+        // only the buckets from the first to the last one used
+        int first = 0, last = k_buckets - 1;
+        while (first < k_buckets && !m_buckets[first])
+            first++;
+        while (last > first && !m_buckets[last])
+            last--;
+
+        for (int i = first; i <= last && first < k_buckets; i++)
+            out << (i > first ? ", " : "") << "{\"below_us\": " << (2ull << i) << ", \"count\": " << m_buckets[i] << "}";
+
+        out << "]}";
+    }
+
+
+    void LatencyTracker::keyApplied(uint8_t key, Clock::time_point happened)
+    {
+        const Clock::time_point now = Clock::now();
+
+        Stage stage = m_stage.load(std::memory_order_acquire);
+
+        // a rom that never reads the key would keep the event forever
+        if (stage == Stage::Applied && now - m_applied > c_giveUpAfter &&
+            m_stage.compare_exchange_strong(stage, Stage::Idle, std::memory_order_acq_rel))
+        {
+            m_abandoned.fetch_add(1, std::memory_order_relaxed);
+            stage = Stage::Idle;
+        }
+
+        if (stage != Stage::Idle)
+        {
+            m_overlapped++;
+            return;
+        }
+
+        m_keyMask = 1 << key;
+        m_happened = std::min(happened, now);
+        m_applied = now;
+
+        m_stage.store(Stage::Applied, std::memory_order_release);
+    }
+
+    void LatencyTracker::onKeyRead(uint16_t keys)
+    {
+        Stage stage = m_stage.load(std::memory_order_acquire);
+        if (stage != Stage::Applied || !(keys & m_keyMask))
+            return;
+
+        // the window thread may just have given up on the event
+        if (!m_stage.compare_exchange_strong(stage, Stage::Observed, std::memory_order_acq_rel))
+            return;
+
+        m_observed = Clock::now();
+    }
+
+    void LatencyTracker::onDrawn()
+    {
+        m_drawn = Clock::now();
+        m_stage.store(Stage::Drawn, std::memory_order_relaxed);
+    }
+
+    void LatencyTracker::framePublished(uint64_t frame)
+    {
+        const Stage stage = m_stage.load(std::memory_order_relaxed);
+
+        if (stage == Stage::Drawn)
+        {
+            m_frame = frame;
+            m_stage.store(Stage::Published, std::memory_order_release);
+        }
+        else if (stage == Stage::Observed && Clock::now() - m_observed > c_giveUpAfter)
+        {
+            m_abandoned.fetch_add(1, std::memory_order_relaxed);
+            m_stage.store(Stage::Idle, std::memory_order_release);
+        }
+    }
+
+    void LatencyTracker::framePresented(uint64_t frame)
+    {
+        if (m_stage.load(std::memory_order_acquire) != Stage::Published || frame < m_frame)
+            return;
+
+        const Clock::time_point now = Clock::now();
+
+        m_toApply.add(microsBetween(m_happened, m_applied));
+        m_toRead.add(microsBetween(m_applied, m_observed));
+        m_toDraw.add(microsBetween(m_observed, m_drawn));
+        m_toPresent.add(microsBetween(m_drawn, now));
+        m_total.add(microsBetween(m_happened, now));
+
+        m_stage.store(Stage::Idle, std::memory_order_release);
+    }
+
+    void LatencyTracker::writeJson(std::ostream& out) const
+    {
+        out << "{\n  \"events\": " << m_total.count()
+            << ",\n  \"overlapped\": " << m_overlapped
+            << ",\n  \"abandoned\": " << m_abandoned.load(std::memory_order_relaxed);
+
+        const std::pair<const char*, const LatencyHistogram*> steps[] {
+            { "event_to_keypad", &m_toApply },
+            { "keypad_to_read", &m_toRead },
+            { "read_to_draw", &m_toDraw },
+            { "draw_to_present", &m_toPresent },
+            { "total", &m_total }
+        };
+
+        for (const auto& step : steps)
+        {
+            out << ",\n  \"" << step.first << "\": ";
+            step.second->writeJson(out);
+        }
+
+        out << "\n}\n";
+    }
+
+    void LatencyTracker::writeJson(const std::string& path) const
+    {
+        std::ofstream file{path};
+        if (!file.good())
+            throw std::runtime_error("ERROR: Unable to write latencies to " + path);
+
+        writeJson(file);
+    }
+}
@@ -0,0 +1,131 @@
+#ifndef LATENCY_H
+#define LATENCY_H
+
+#include <stdint.h>
+
+#include <atomic>
+#include <chrono>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace chip8
+{
+    /**
+     * Latencies in µs, kept exactly for percentiles and in power of 2 buckets
+    **/
+    class LatencyHistogram
+    {
+    public:
+        void add(uint64_t micros);
+
+        size_t count() const { return m_samples.size(); }
+
+        /**
+         * writes the count, min, max, mean, p50, p90, p99 and the buckets as a JSON object
+        **/
+        void writeJson(std::ostream& out) const;
+
+    private:
+        static constexpr int k_buckets = 32;    // bucket i counts [2^i, 2^(i+1)) µs, 0 µs goes to 0
+
+        std::vector<uint64_t> m_samples;
+        uint64_t m_buckets[k_buckets] {};
+    };
+
+    /**
+     * Follows host key events through the machine:
+     * the host event, the keypad update applying it, the first instruction
+     * reading the key, the next Dxyn drawing something and the present
+     * showing that frame.
+     *
+     * One event is followed at a time, events arriving meanwhile are only
+     * counted. Each step is taken by the thread doing it, input and present
+     * on the window thread, the rest on the emulation thread, handing over
+     * through an atomic stage without locks.
+    **/
+    class LatencyTracker
+    {
+    public:
+        using Clock = std::chrono::steady_clock;
+
+        /**
+         * window thread, the keypad changed
+         * @param happened when the host saw the event
+        **/
+        void keyApplied(uint8_t key, Clock::time_point happened);
+
+        /**
+         * emulation thread, Ex9E & ExA1 with the key they test, Fx0A with every key
+        **/
+        void keyRead(uint16_t keys)
+        {
+            if (m_stage.load(std::memory_order_relaxed) == Stage::Applied)
+                onKeyRead(keys);
+        }
+
+        /**
+         * emulation thread, a Dxyn drew a sprite with pixels set
+        **/
+        void drawn()
+        {
+            if (m_stage.load(std::memory_order_relaxed) == Stage::Observed)
+                onDrawn();
+        }
+
+        /**
+         * emulation thread, frame no. frame was handed to the presenter
+        **/
+        void framePublished(uint64_t frame);
+
+        /**
+         * window thread, frame no. frame is on screen
+        **/
+        void framePresented(uint64_t frame);
+
+        /**
+         * window thread, writes the histograms of every step and the total as JSON
+        **/
+        void writeJson(std::ostream& out) const;
+
+        /**
+         * @throws runtime_error if path cannot be written
+        **/
+        void writeJson(const std::string& path) const;
+
+    private:
+        enum class Stage : uint8_t
+        {
+            Idle,       // owned by the window thread
+            Applied,    // owned by the emulation thread from here
+            Observed,
+            Drawn,
+            Published   // owned by the window thread again
+        };
+
+        inline static const Clock::duration c_giveUpAfter = std::chrono::seconds(2);
+
+        std::atomic<Stage> m_stage { Stage::Idle };
+
+        uint16_t m_keyMask {};
+        Clock::time_point m_happened;
+        Clock::time_point m_applied;
+        Clock::time_point m_observed;
+        Clock::time_point m_drawn;
+        uint64_t m_frame {};
+
+        uint64_t m_overlapped {};   // events not followed, another one was
+        std::atomic<uint64_t> m_abandoned {};  // events never read or drawn within c_giveUpAfter
+
+        LatencyHistogram m_toApply;
+        LatencyHistogram m_toRead;
+        LatencyHistogram m_toDraw;
+        LatencyHistogram m_toPresent;
+        LatencyHistogram m_total;
+
+        void onKeyRead(uint16_t keys);
+        void onDrawn();
+    };
+}
+
+#endif /* LATENCY_H */
@@ -0,0 +1,271 @@
+#include "lockstep.h"
+
+#include <string.h>
+
+#include <algorithm>
+#include <iomanip>
+#include <sstream>
+#include <stdexcept>
+
+namespace chip8
+{
+    namespace
+    {
+        constexpr uint64_t k_hashMultiplier = 0x9E3779B97F4A7C15ull;
+
+        uint64_t mix(uint64_t hash, uint64_t word)
+        {
+            hash = (hash ^ word) * k_hashMultiplier;
+            return hash ^ (hash >> 32);
+        }
+
+        /**
+         * prints name and both values if they differ
+         * @returns true if they did
+        **/
+        bool printIfDiffers(std::ostream& out, const std::string& name, uint32_t reference, uint32_t candidate, int digits)
+        {
+            if (reference == candidate)
+                return false;
+
+            out << "    " << std::left << std::setw(12) << name << std::right << std::hex << std::setfill('0')
+                << "0x" << std::setw(digits) << reference << "  0x" << std::setw(digits) << candidate
+                << std::dec << std::setfill(' ') << '\n';
+            return true;
+        }
+    }
+
+
+    uint64_t stateHash(Interpreter& interpreter)
+    {
+        // 4 independent lanes, the multiplications of one word need not wait for the previous one
+        uint64_t lanes[4] { 1, 2, 3, 4 };
+
+        const Memory* memory = interpreter.memory();
+        static_assert(Memory::k_pageSize % 32 == 0, "the ram is hashed 32 bytes at a time");
+
+        for (uint16_t index = 0; index < memory->pages(); index++)
+        {
+            const uint8_t* page = memory->page(index);
+            for (size_t at = 0; at < Memory::k_pageSize; at += 32)
+            {
+                uint64_t words[4];
+                memcpy(words, page + at, sizeof(words));
+
+                for (int lane = 0; lane < 4; lane++)
+                    lanes[lane] = mix(lanes[lane], words[lane]);
+            }
+        }
+
+        const std::vector<uint64_t>& screen = interpreter.display()->screenBuffer();
+        for (size_t at = 0; at < screen.size(); at++)
+            lanes[at % 4] = mix(lanes[at % 4], screen[at]);
+
+        const Cpu::State& cpu = interpreter.cpu()->state();
+
+        uint64_t words[4];
+        memcpy(words, cpu.registers.data(), 16);
+        words[2] = cpu.I | (uint64_t(cpu.PC) << 16) | (uint64_t(cpu.delayTimer) << 32) | (uint64_t(cpu.soundTimer) << 40) |
+                   (uint64_t(cpu.stackDepth) << 48);
+        const Display::Mode& mode = interpreter.display()->mode();
+        words[3] = interpreter.randomState() | (uint64_t(cpu.pitch) << 32) | (uint64_t(mode.selected) << 40) |
+                   (uint64_t(mode.isLowRes) << 48) | (uint64_t(interpreter.isFrameDrawn()) << 56);
+        for (int lane = 0; lane < 4; lane++)
+            lanes[lane] = mix(lanes[lane], words[lane]);
+
+        memcpy(words, cpu.audioPattern.data(), 16);
+        lanes[1] = mix(lanes[1], words[0]);
+        lanes[2] = mix(lanes[2], words[1]);
+
+        lanes[0] = mix(lanes[0], interpreter.instructions());
+
+        // only the frames in use, the rest are left overs from earlier calls
+        for (uint8_t depth = 0; depth < cpu.stackDepth && depth < Cpu::k_stackSize; depth++)
+            lanes[depth % 4] = mix(lanes[depth % 4], cpu.callStack[depth]);
+
+        return mix(mix(mix(lanes[0], lanes[1]), lanes[2]), lanes[3]);
+    }
+
+
+    Lockstep::Lockstep(const uint8_t* rom, size_t size, Platform platform,
+                       Interpreter::Engine candidate, uint32_t instructionsPerFrame)
+        :   m_reference(new Interpreter{rom, size, platform}),
+            m_candidate(new Interpreter{rom, size, platform}),
+            m_instructionsPerFrame(std::max<uint32_t>(instructionsPerFrame, 1))
+    {
+        m_reference->setEngine(Interpreter::Engine::Switch);
+        m_candidate->setEngine(candidate);
+    }
+
+    Lockstep::Outcome Lockstep::run(uint32_t frames)
+    {
+        const uint64_t end = uint64_t(frames) * m_instructionsPerFrame;
+
+        Snapshot referenceStart;
+        Snapshot candidateStart;
+
+        while (m_at < end)
+        {
+            const uint64_t count = std::min<uint64_t>(m_blockSize, end - m_at);
+
+            const uint64_t traceStart = m_traced;
+            if (count > 1)
+            {
+                m_reference->save(referenceStart);
+                m_candidate->save(candidateStart);
+            }
+
+            uint64_t referenceAt = m_at;
+            uint64_t candidateAt = m_at;
+            std::string referenceError = advance(*m_reference, referenceAt, count, true);
+            std::string candidateError = advance(*m_candidate, candidateAt, count, false);
+
+            bool isAgreed = agree(referenceAt, referenceError, candidateAt, candidateError);
+
+            if (!isAgreed && count > 1)
+            {
+                // again from the start of the block, one instruction at a time
+                m_reference->restore(referenceStart);
+                m_candidate->restore(candidateStart);
+
+                // what the block left in the ring from before its start stays valid
+                m_traceValid = std::min(m_traced > k_traceLength ? m_traced - k_traceLength : 0, traceStart);
+                m_traced = traceStart;
+
+                for (uint64_t i = 0; i < count; i++)
+                {
+                    referenceAt = candidateAt = m_at;
+                    referenceError = advance(*m_reference, referenceAt, 1, true);
+                    candidateError = advance(*m_candidate, candidateAt, 1, false);
+
+                    isAgreed = agree(referenceAt, referenceError, candidateAt, candidateError);
+                    if (!isAgreed || !referenceError.empty())
+                        break;
+
+                    m_at = referenceAt;
+                }
+            }
+
+            if (!isAgreed)
+            {
+                m_reference->save(m_referenceState);
+                m_candidate->save(m_candidateState);
+                m_referenceError = referenceError;
+                m_candidateError = candidateError;
+
+                return Outcome::Diverged;
+            }
+
+            m_at = referenceAt;
+            if (!referenceError.empty())
+            {
+                m_error = referenceError;
+                return Outcome::Stopped;
+            }
+        }
+
+        return Outcome::Done;
+    }
+
+    std::string Lockstep::advance(Interpreter& interpreter, uint64_t& at, uint64_t count, bool isTraced)
+    {
+        const uint64_t end = at + count;
+        uint32_t inFrame = at % m_instructionsPerFrame;
+
+        try
+        {
+            for (; at < end; at++)
+            {
+                if (inFrame == 0)
+                    interpreter.keypad()->setKeys(m_movie ? m_movie->keysAt(at / m_instructionsPerFrame) : 0);
+
+                if (isTraced)
+                {
+                    const uint16_t pc = interpreter.cpu()->readPC();
+                    m_trace[m_traced++ % k_traceLength] = TraceEntry{at, pc, interpreter.fetch()};
+                }
+
+                interpreter.step();
+
+                if (++inFrame == m_instructionsPerFrame)
+                {
+                    interpreter.decrementTimers();
+                    inFrame = 0;
+                }
+            }
+        }
+        catch (const std::runtime_error& e)
+        {
+            return e.what();
+        }
+
+        return {};
+    }
+
+    bool Lockstep::agree(uint64_t referenceAt, const std::string& referenceError,
+                         uint64_t candidateAt, const std::string& candidateError)
+    {
+        return referenceAt == candidateAt && referenceError == candidateError &&
+               stateHash(*m_reference) == stateHash(*m_candidate);
+    }
+
+    void Lockstep::report(std::ostream& out) const
+    {
+        out << "diverged at instruction " << m_at << " (frame " << m_at / m_instructionsPerFrame << ")\n";
+
+        if (!m_referenceError.empty() || !m_candidateError.empty())
+            out << "  reference stopped with: " << (m_referenceError.empty() ? "nothing" : m_referenceError) << '\n'
+                << "  candidate stopped with: " << (m_candidateError.empty() ? "nothing" : m_candidateError) << '\n';
+
+        out << "  differences after it:  reference  candidate\n";
+
+        const Cpu::State& reference = m_referenceState.cpu;
+        const Cpu::State& candidate = m_candidateState.cpu;
+
+        printIfDiffers(out, "PC", reference.PC, candidate.PC, 4);
+        printIfDiffers(out, "I", reference.I, candidate.I, 4);
+        for (int reg = 0; reg < 16; reg++)
+            printIfDiffers(out, "V" + std::string(1, "0123456789ABCDEF"[reg]), reference.registers[reg], candidate.registers[reg], 2);
+        printIfDiffers(out, "DT", reference.delayTimer, candidate.delayTimer, 2);
+        printIfDiffers(out, "ST", reference.soundTimer, candidate.soundTimer, 2);
+        printIfDiffers(out, "pitch", reference.pitch, candidate.pitch, 2);
+        printIfDiffers(out, "SP", reference.stackDepth, candidate.stackDepth, 2);
+        for (uint8_t depth = 0; depth < std::min(reference.stackDepth, candidate.stackDepth) && depth < Cpu::k_stackSize; depth++)
+            printIfDiffers(out, "stack[" + std::to_string(depth) + "]", reference.callStack[depth], candidate.callStack[depth], 4);
+        printIfDiffers(out, "random", m_referenceState.random, m_candidateState.random, 8);
+        if (m_referenceState.instructions != m_candidateState.instructions)
+            out << "    " << std::left << std::setw(12) << "executed" << std::right
+                << m_referenceState.instructions << "  " << m_candidateState.instructions << '\n';
+
+        const size_t k_maxListed = 16;
+        size_t listed = 0, differing = 0;
+        for (size_t addr = 0; addr < m_referenceState.ram.size(); addr++)
+        {
+            if (m_referenceState.ram[addr] == m_candidateState.ram[addr])
+                continue;
+
+            std::ostringstream name;
+            name << "mem[" << std::hex << std::setw(3) << std::setfill('0') << addr << "]";
+            if (listed < k_maxListed && printIfDiffers(out, name.str(), m_referenceState.ram[addr], m_candidateState.ram[addr], 2))
+                listed++;
+            differing++;
+        }
+        if (differing > listed)
+            out << "    ... " << differing - listed << " more bytes of memory\n";
+
+        differing = 0;
+        for (size_t word = 0; word < m_referenceState.screen.size() && word < m_candidateState.screen.size(); word++)
+            differing += m_referenceState.screen[word] != m_candidateState.screen[word];
+        if (differing)
+            out << "    " << differing << " words of the screen\n";
+
+        out << "  last instructions of the reference:\n";
+        for (uint64_t traced = std::max(m_traced > k_traceLength ? m_traced - k_traceLength : 0, m_traceValid); traced < m_traced; traced++)
+        {
+            const TraceEntry& entry = m_trace[traced % k_traceLength];
+            out << "    #" << std::setw(10) << std::left << entry.instruction << std::right
+                << std::hex << std::setfill('0') << "  0x" << std::setw(3) << entry.pc << "  " << std::setw(4) << entry.opcode
+                << std::dec << std::setfill(' ') << '\n';
+        }
+    }
+}
@@ -0,0 +1,132 @@
+#ifndef LOCKSTEP_H
+#define LOCKSTEP_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include <algorithm>
+#include <array>
+#include <ostream>
+#include <string>
+
+#include "interpreter.h"
+#include "movie.h"
+
+namespace chip8
+{
+    /**
+     * @returns a 64 bit hash of everything a rom can observe, memory, cpu,
+     *  screen and random generator, and of the no. of instructions
+     *  executed. not of the keypad.
+    **/
+    uint64_t stateHash(Interpreter& interpreter);
+
+    /**
+     * Runs a rom on two interpreters side by side, the switch as reference
+     * and a candidate engine, feeding both the same keys, and stops at the
+     * first instruction after which their states differ.
+     *
+     * The states are compared by hash at the end of every block of
+     * instructions. A block that ends differently is run again from its
+     * start one instruction at a time to find the first one diverging.
+    **/
+    class Lockstep
+    {
+    public:
+        enum class Outcome
+        {
+            Done,       // every instruction agreed
+            Stopped,    // both machines ran into the same rom fault, see error()
+            Diverged    // see report()
+        };
+
+        /**
+         * @param instructionsPerFrame no. of instructions between timer ticks and key changes
+        **/
+        Lockstep(const uint8_t* rom, size_t size, Platform platform,
+                 Interpreter::Engine candidate = Interpreter::Engine::Table, uint32_t instructionsPerFrame = 15);
+
+        ~Lockstep()
+        {
+            delete m_reference;
+            delete m_candidate;
+        }
+
+        Lockstep(const Lockstep&) = delete;
+        Lockstep& operator=(const Lockstep&) = delete;
+
+        /**
+         * @param instructions no. of instructions between comparisons, 1 compares after every one
+        **/
+        void setBlockSize(uint32_t instructions) { m_blockSize = std::max<uint32_t>(instructions, 1); }
+
+        /**
+         * @param movie keys held per frame, nullptr for none. not copied.
+        **/
+        void setMovie(const InputMovie* movie) { m_movie = movie; }
+
+        /**
+         * runs both machines on till frames frames passed since the start
+        **/
+        Outcome run(uint32_t frames);
+
+        /**
+         * @returns no. of instructions both machines ran and agreed on
+        **/
+        uint64_t instructions() const { return m_at; }
+
+        const std::string& error() const { return m_error; }
+
+        /**
+         * prints where the machines diverged, how their states differ and
+         * the instructions leading there
+        **/
+        void report(std::ostream& out) const;
+
+    private:
+        static constexpr size_t k_traceLength = 32;
+
+        struct TraceEntry
+        {
+            uint64_t instruction;
+            uint16_t pc;
+            uint16_t opcode;
+        };
+
+        Interpreter* m_reference {};
+        Interpreter* m_candidate {};
+
+        uint32_t m_instructionsPerFrame;
+        uint32_t m_blockSize { 1024 };
+        const InputMovie* m_movie {};
+
+        uint64_t m_at {};       // no. of instructions both ran
+        std::string m_error;
+
+        // the reference's last instructions, a ring
+        std::array<TraceEntry, k_traceLength> m_trace {};
+        uint64_t m_traced {};
+        uint64_t m_traceValid {};   // entries before are left overs of a block run again
+
+        // set once diverged
+        Snapshot m_referenceState;
+        Snapshot m_candidateState;
+        std::string m_referenceError;
+        std::string m_candidateError;
+
+        /**
+         * runs count instructions from instruction no. at on, moving at
+         * past every instruction completed
+         * @returns the message of the rom fault it stopped at, empty if none
+        **/
+        std::string advance(Interpreter& interpreter, uint64_t& at, uint64_t count, bool isTraced);
+
+        /**
+         * @returns true if both ended the same way
+        **/
+        bool agree(uint64_t referenceAt, const std::string& referenceError,
+                   uint64_t candidateAt, const std::string& candidateError);
+    };
+}
+
+#endif /* LOCKSTEP_H */
@@ -1,15 +1,361 @@
+#include <stdint.h>
+
+#include <algorithm>
+#include <iomanip>
 #include <iostream>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
 
 #include "emulator.h"
+#include "wall.h"
 
 const unsigned int SCALE_FACTOR = 15;
 
+const char* ROM_PATH = "./roms/Space Invaders [David Winter].ch8";
+// const char* ROM_PATH = "./roms/Brick.ch8";
+
+/**
+ * @param text a whole decimal no., as options take them
+ * @returns false if text is none or too big for count, count is then left as is
+**/
+bool parseCount(const std::string& text, uint32_t& count)
+{
+    try
+    {
+        size_t used = 0;
+        const unsigned long parsed = std::stoul(text, &used);
+        if (used != text.size() || parsed > UINT32_MAX)
+            return false;
+
+        count = parsed;
+        return true;
+    }
+    catch (const std::exception&)
+    {
+        return false;
+    }
+}
+
 int main(int argc, char * argv[])
 {
+    std::string romPath = ROM_PATH;
+
+    bool debug = false;
+    std::string debugScript;
+    std::string gdbAddress;
+
+    uint32_t headlessFrames = 0;
+    std::string framePath;
+
+    uint32_t instructionsPerFrame = 0;
+    chip8::Interpreter::Engine engine = chip8::Interpreter::Engine::Switch;
+    uint32_t runAheadFrames = 0;
+
+    emuGL::FrameScaler::Upscale upscale = emuGL::FrameScaler::Upscale::None;
+    uint32_t persistence = 0;
+
+    uint32_t wallMachines = 0;
+
+    std::string analysisCachePath;
+    std::string catalogPath;
+    std::optional<chip8::Platform> platform;
+
+    std::string latencyPath;
+    bool stats = false;
+    uint32_t frameRingSlots = 0;
+
+    std::string moviePath;
+    std::string inputRecordingPath;
+
+    std::vector<std::pair<uint16_t, uint8_t>> cheats;
+
+    std::string recordPath;
+    emuGL::VideoRecorder::FullPolicy recordPolicy = emuGL::VideoRecorder::FullPolicy::Drop;
+
+    for (int i = 1; i < argc; i++)
+    {
+        const std::string arg = argv[i];
+
+        // `--rom <path>` loads another rom than ROM_PATH
+        if (arg == "--rom" && i + 1 < argc)
+            romPath = argv[++i];
+
+        // `--debug [script]` starts the rom stopped under the debugger
+        else if (arg == "--debug")
+        {
+            debug = true;
+            if (i + 1 < argc && argv[i + 1][0] != '-')
+                debugScript = argv[++i];
+        }
+
+        // `--gdb <port|unix:path>` lets gdb attach over the remote protocol
+        else if (arg == "--gdb" && i + 1 < argc)
+            gdbAddress = argv[++i];
+
+        // `--headless <frames> <image>` runs without a window and saves the last frame
+        else if (arg == "--headless" && i + 2 < argc)
+        {
+            if (!parseCount(argv[++i], headlessFrames))
+            {
+                std::cerr << "--headless takes <frames> <image>, e.g. 60 frame.png\n";
+                return 1;
+            }
+            framePath = argv[++i];
+        }
+
+        // `--ipf <n>` runs n instructions per 60Hz frame instead of as many as the rom's platform runs
+        else if (arg == "--ipf" && i + 1 < argc)
+        {
+            if (!parseCount(argv[++i], instructionsPerFrame))
+            {
+                std::cerr << "--ipf takes a no. of instructions, e.g. 30\n";
+                return 1;
+            }
+        }
+
+        // `--engine switch|table` picks how instructions are dispatched
+        else if (arg == "--engine" && i + 1 < argc)
+        {
+            const std::string name = argv[++i];
+            if (name == "table")
+                engine = chip8::Interpreter::Engine::Table;
+            else if (name != "switch")
+            {
+                std::cerr << "--engine takes switch or table\n";
+                return 1;
+            }
+        }
+
+        // `--analysis-cache <file>` keeps rom analyses in file across runs
+        else if (arg == "--analysis-cache" && i + 1 < argc)
+            analysisCachePath = argv[++i];
+
+        // `--wall <n>` runs n machines and shows them all in one window
+        else if (arg == "--wall" && i + 1 < argc)
+        {
+            if (!parseCount(argv[++i], wallMachines))
+            {
+                std::cerr << "--wall takes a no. of machines, e.g. 16\n";
+                return 1;
+            }
+        }
+
+        // `--run-ahead <n>` shows frames n frames ahead of the rom
+        else if (arg == "--run-ahead" && i + 1 < argc)
+        {
+            if (!parseCount(argv[++i], runAheadFrames))
+            {
+                std::cerr << "--run-ahead takes a no. of frames, e.g. 2\n";
+                return 1;
+            }
+        }
+
+        // `--filter scale2x|scale3x|epx` upscales frames before they are shown
+        else if (arg == "--filter" && i + 1 < argc)
+        {
+            const std::string name = argv[++i];
+            if (name == "scale2x" || name == "epx")
+                upscale = emuGL::FrameScaler::Upscale::Scale2x;
+            else if (name == "scale3x")
+                upscale = emuGL::FrameScaler::Upscale::Scale3x;
+            else
+            {
+                std::cerr << "--filter takes scale2x, scale3x or epx\n";
+                return 1;
+            }
+        }
+
+        // `--persistence <percent>` keeps that much of a pixel's brightness a frame after it went dark
+        else if (arg == "--persistence" && i + 1 < argc)
+        {
+            if (!parseCount(argv[++i], persistence))
+            {
+                std::cerr << "--persistence takes a percentage, e.g. 60\n";
+                return 1;
+            }
+            persistence = std::min<uint32_t>(persistence, 100);
+        }
+
+        // `--latency <file.json>` measures input latency, written on exit
+        else if (arg == "--latency" && i + 1 < argc)
+            latencyPath = argv[++i];
+
+        // `--stats` publishes live counters for chip8-top
+        else if (arg == "--stats")
+            stats = true;
+
+        // `--frame-ring <slots>` publishes the last frames for other processes to read
+        else if (arg == "--frame-ring" && i + 1 < argc)
+        {
+            if (!parseCount(argv[++i], frameRingSlots))
+            {
+                std::cerr << "--frame-ring takes a no. of slots, e.g. 8\n";
+                return 1;
+            }
+        }
+
+        // `--movie <movie.txt>` holds the keys recorded in a movie
+        else if (arg == "--movie" && i + 1 < argc)
+            moviePath = argv[++i];
+
+        // `--record-input <movie.txt>` records the keys held each frame
+        else if (arg == "--record-input" && i + 1 < argc)
+            inputRecordingPath = argv[++i];
+
+        // `--record <video.y4m|video.gif>` records every frame
+        else if (arg == "--record" && i + 1 < argc)
+            recordPath = argv[++i];
+
+        // `--record-full <drop|block>` what to do when the encoder falls behind, headless runs always block
+        else if (arg == "--record-full" && i + 1 < argc)
+        {
+            const std::string policy = argv[++i];
+            if (policy != "drop" && policy != "block")
+            {
+                std::cerr << "--record-full takes drop or block\n";
+                return 1;
+            }
+            recordPolicy = policy == "drop" ? emuGL::VideoRecorder::FullPolicy::Drop : emuGL::VideoRecorder::FullPolicy::Block;
+        }
+
+        // `--cheat <addr>=<val>` writes val to addr before every frame
+        else if (arg == "--cheat" && i + 1 < argc)
+        {
+            const std::string cheat = argv[++i];
+            const size_t equals = cheat.find('=');
+
+            bool isValid = equals != std::string::npos;
+            unsigned long addr = 0, val = 0;
+            try
+            {
+                size_t used = 0;
+                addr = std::stoul(cheat.substr(0, equals), &used, 0);
+                isValid = isValid && used == equals;
+
+                val = std::stoul(cheat.substr(equals + 1), &used, 0);
+                isValid = isValid && used == cheat.size() - equals - 1;
+            }
+            catch (const std::exception&)
+            {
+                isValid = false;
+            }
+
+            if (!isValid || addr >= chip8::Memory::maxSize() || val > 0xFF)
+            {
+                std::cerr << "--cheat takes <addr>=<val>, e.g. 0x1F0=3\n";
+                return 1;
+            }
+            cheats.emplace_back(addr, val);
+        }
+
+        // `--platform <vip|dream6800|eti660|chip48|schip|xochip>` runs roms on it instead of the one detected
+        else if (arg == "--platform" && i + 1 < argc)
+        {
+            chip8::Platform chosen;
+            if (!chip8::platformFromKey(argv[++i], chosen))
+            {
+                std::cerr << "--platform takes " << chip8::c_platformKeys << '\n';
+                return 1;
+            }
+            platform = chosen;
+        }
+
+        // `--catalog <dir>` lists the roms below dir and exits
+        else if (arg == "--catalog" && i + 1 < argc)
+            catalogPath = argv[++i];
+
+        else
+        {
+            std::cerr << "unknown argument: " << arg << '\n';
+            return 1;
+        }
+    }
+
+    chip8::AnalysisCache* analysisCache = analysisCachePath.empty() ? nullptr : new chip8::AnalysisCache{analysisCachePath};
+
+    if (!catalogPath.empty())
+    {
+        const chip8::RomCatalog catalog{catalogPath, analysisCache, platform};
+        delete analysisCache;
+
+        for (const chip8::RomCatalog::Entry& entry : catalog.entries())
+            std::cout << std::hex << std::setw(16) << std::setfill('0') << entry.hash << std::dec
+                      << "  " << std::setw(4) << std::setfill(' ') << entry.size
+                      << "  " << std::setw(10) << std::left << chip8::platformName(entry.platform) << std::right
+                      << "  " << entry.path << '\n';
+
+        for (const std::string& reason : catalog.rejected())
+            std::cerr << reason << '\n';
+
+        return 0;
+    }
+
+    if (wallMachines > 0)
+    {
+        chip8::WallViewer wall{wallMachines, romPath, analysisCache, platform};
+        delete analysisCache;
+        if (instructionsPerFrame > 0)
+            wall.setInstructionsPerFrame(instructionsPerFrame);
+
+        wall.run();
+        return 0;
+    }
+
+    chip8::Emulator e{SCALE_FACTOR, romPath, headlessFrames > 0, analysisCache, platform};
+    delete analysisCache;
+
+    if (debug)
+        e.enableDebugger(debugScript);
+
+    if (!gdbAddress.empty())
+        e.enableGdbServer(gdbAddress);
+
+    if (instructionsPerFrame > 0)
+        e.setInstructionsPerFrame(instructionsPerFrame);
+
+    e.setEngine(engine);
+
+    if (runAheadFrames > 0)
+        e.setRunAhead(runAheadFrames);
+
+    if (upscale != emuGL::FrameScaler::Upscale::None || persistence > 0)
+        e.setFilter(upscale, std::min<uint32_t>(persistence * 256 / 100, 255));
+
+    if (!latencyPath.empty())
+        e.enableLatencyTracking(latencyPath);
+
+    if (stats)
+        e.enableStats(romPath);
+
+    if (frameRingSlots > 0)
+        e.enableFrameRing(frameRingSlots);
+
+    // past the memory of the rom's platform, which only now is known
+    for (const std::pair<uint16_t, uint8_t>& cheat : cheats)
+    {
+        try
+        {
+            e.freeze(cheat.first, cheat.second);
+        }
+        catch (const std::runtime_error&)
+        {
+            std::cerr << "--cheat takes <addr>=<val>, e.g. 0x1F0=3\n";
+            return 1;
+        }
+    }
+
+    if (!moviePath.empty())
+        e.playMovie(moviePath);
+
+    if (!inputRecordingPath.empty())
+        e.recordInput(inputRecordingPath);
 
-    chip8::Emulator e{SCALE_FACTOR, "./roms/Space Invaders [David Winter].ch8"};
-    // chip8::Emulator e{SCALE_FACTOR, "./roms/Brick.ch8"};
+    if (!recordPath.empty())
+        e.startRecording(recordPath, recordPolicy);
 
-    e.run();
+    const bool isClean = headlessFrames > 0 ? e.runHeadless(headlessFrames, framePath) : e.run();
+    return isClean ? 0 : 1;
 
 }
@@ -0,0 +1,78 @@
+#include "movie.h"
+
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+#include <stdexcept>
+
+namespace chip8
+{
+    namespace
+    {
+        const char* c_header = "chip8-movie 1";
+    }
+
+
+    InputMovie::InputMovie(const std::string& path)
+    {
+        std::ifstream file{path};
+        if (!file.good())
+            throw std::runtime_error("ERROR: Unable to load movie " + path);
+
+        std::string line;
+        if (!std::getline(file, line) || line != c_header)
+            throw std::runtime_error("ERROR: " + path + " is no movie, it does not start with \"" + c_header + "\"");
+
+        for (size_t lineNo = 2; std::getline(file, line); lineNo++)
+        {
+            line = line.substr(0, line.find('#'));
+            if (line.find_first_not_of(" \t\r") == std::string::npos)
+                continue;
+
+            std::istringstream fields{line};
+            uint32_t frame;
+            uint32_t keys;
+            std::string rest;
+
+            if (!(fields >> frame >> std::hex >> keys) || keys > 0xFFFF || fields >> rest)
+                throw std::runtime_error("ERROR: " + path + ":" + std::to_string(lineNo) + ": expected <frame> <keys>");
+
+            record(frame, keys);
+        }
+    }
+
+    void InputMovie::save(const std::string& path) const
+    {
+        std::ofstream file{path};
+        if (!file.good())
+            throw std::runtime_error("ERROR: Unable to write movie " + path);
+
+        file << c_header << "\n# frame keys\n" << std::hex << std::setfill('0');
+        for (const Event& event : m_events)
+            file << std::dec << event.frame << ' ' << std::hex << std::setw(4) << event.keys << '\n';
+    }
+
+    void InputMovie::record(uint32_t frame, uint16_t keys)
+    {
+        if (!m_events.empty() && frame < m_events.back().frame)
+            throw std::runtime_error("ERROR: Movie events have to be recorded in order, frame " +
+                                     std::to_string(frame) + " came after " + std::to_string(m_events.back().frame));
+
+        // a later change in the same frame wins
+        if (!m_events.empty() && m_events.back().frame == frame)
+            m_events.pop_back();
+
+        if (keys != (m_events.empty() ? 0 : m_events.back().keys))
+            m_events.push_back(Event{frame, keys});
+    }
+
+    uint16_t InputMovie::keysAt(uint32_t frame) const
+    {
+        // the last change at or before frame
+        auto after = std::upper_bound(m_events.begin(), m_events.end(), frame,
+                                      [](uint32_t frame, const Event& event) { return frame < event.frame; });
+
+        return after == m_events.begin() ? 0 : std::prev(after)->keys;
+    }
+}
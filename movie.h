@@ -0,0 +1,69 @@
+#ifndef MOVIE_H
+#define MOVIE_H
+
+#include <stdint.h>
+
+#include <string>
+#include <vector>
+
+namespace chip8
+{
+    /**
+     * The keys held over a run, frame by frame, to play a rom the same way
+     * again without a window.
+     *
+     * Stored as text, a "chip8-movie 1" line followed by one
+     * "<frame> <keys>" line per change, the frame in decimal and the keys
+     * as the hex mask Keypad::keys() returns. # starts a comment.
+    **/
+    class InputMovie
+    {
+    public:
+        struct Event
+        {
+            uint32_t frame;
+            uint16_t keys;      // held from frame on
+        };
+
+        InputMovie() = default;
+
+        /**
+         * @throws runtime_error if path cannot be read or is no movie
+        **/
+        explicit InputMovie(const std::string& path);
+
+        /**
+         * @throws runtime_error if path cannot be written
+        **/
+        void save(const std::string& path) const;
+
+        /**
+         * keys are held from frame on, only kept if they differ from the
+         * ones held before
+         * @throws runtime_error if frame is before the last recorded one
+        **/
+        void record(uint32_t frame, uint16_t keys);
+
+        /**
+         * @returns the keys held during frame
+        **/
+        uint16_t keysAt(uint32_t frame) const;
+
+        /**
+         * @returns the frame of the last change, 0 for an empty movie
+        **/
+        uint32_t lastFrame() const { return m_events.empty() ? 0 : m_events.back().frame; }
+
+        const std::vector<Event>& events() const { return m_events; }
+
+        /**
+         * forgets every event, keeping the memory for the next ones
+        **/
+        void clear() { m_events.clear(); }
+
+    private:
+        std::vector<Event> m_events;    // ordered by frame, each with different keys than the one before
+    };
+}
+
+#endif /* MOVIE_H */
@@ -0,0 +1,172 @@
+#ifndef PLATFORM_H
+#define PLATFORM_H
+
+#include <stdint.h>
+
+#include <string>
+#include <utility>
+
+namespace chip8
+{
+    /**
+     * machines and interpreters CHIP-8 roms were written for
+    **/
+    enum class Platform : uint8_t
+    {
+        CosmacVip,
+        Dream6800,
+        Eti660,
+        Chip48,
+        SuperChip,
+        XoChip
+    };
+
+    /**
+     * behaviours the platforms disagree on
+    **/
+    struct Quirks
+    {
+        bool logicResetsVf;         // 8xy1, 8xy2 & 8xy3 set VF to 0
+        bool shiftUsesVy;           // 8xy6 & 8xyE shift Vy into Vx instead of shifting Vx
+        bool loadStoreIncrementsI;  // Fx55 & Fx65 leave I pointing past the last register
+        bool jumpUsesVx;            // Bnnn jumps to xnn + Vx instead of nnn + V0
+        bool spritesWrap;           // sprites wrap around the screen edges instead of being clipped
+        bool displayWait;           // Dxyn waits for the next frame, drawing once a frame at most
+    };
+
+    constexpr Quirks quirksFor(Platform platform)
+    {
+        switch (platform)
+        {
+        case Platform::CosmacVip:
+        case Platform::Dream6800:
+        case Platform::Eti660:
+            return { true, true, true, false, false, true };
+
+        case Platform::Chip48:
+        case Platform::SuperChip:
+            return { false, false, false, true, false, false };
+
+        case Platform::XoChip:
+            return { false, true, true, false, true, false };
+        }
+
+        return {};
+    }
+
+    /**
+     * @returns how many instructions per 60Hz frame roms of platform were
+     *  written to run at, what runs them at the speed they expect
+    **/
+    constexpr uint32_t instructionsPerFrameFor(Platform platform)
+    {
+        switch (platform)
+        {
+        case Platform::Chip48:
+        case Platform::SuperChip:
+            return 30;
+
+        case Platform::XoChip:
+            return 1000;
+
+        default:
+            return 15;
+        }
+    }
+
+    /**
+     * @returns true if platform has the 128x64 pixel mode roms switch to
+     *  with 00FF, scroll with 00Cn, 00FB & 00FC and draw 16x16 sprites in
+     *  with Dxy0
+    **/
+    constexpr bool hasHires(Platform platform)
+    {
+        return platform == Platform::SuperChip || platform == Platform::XoChip;
+    }
+
+    /**
+     * A quirk profile, the quirks of a platform as constants for code
+     * specialized on them, e.g. template <typename Profile> void f() with
+     * if constexpr (Profile::k_quirks.shiftUsesVy) in it.
+    **/
+    template <Platform P>
+    struct QuirkProfile
+    {
+        static constexpr Platform k_platform = P;
+        static constexpr Quirks k_quirks = quirksFor(P);
+
+        // with its memory, display and instructions
+        static constexpr bool k_isXoChip = P == Platform::XoChip;
+        static constexpr bool k_hasHires = hasHires(P);
+    };
+
+    using CosmacVipProfile = QuirkProfile<Platform::CosmacVip>;
+    using Chip48Profile = QuirkProfile<Platform::Chip48>;
+    using SuperChipProfile = QuirkProfile<Platform::SuperChip>;
+    using XoChipProfile = QuirkProfile<Platform::XoChip>;
+
+    /**
+     * calls visitor with a default constructed profile of platform, the
+     * platforms of the COSMAC VIP's era all getting its one
+     * @returns what visitor does
+    **/
+    template <typename Visitor>
+    constexpr decltype(auto) visitProfile(Platform platform, Visitor&& visitor)
+    {
+        switch (platform)
+        {
+        case Platform::Chip48:      return visitor(Chip48Profile{});
+        case Platform::SuperChip:   return visitor(SuperChipProfile{});
+        case Platform::XoChip:      return visitor(XoChipProfile{});
+        default:                    return visitor(CosmacVipProfile{});
+        }
+    }
+
+    constexpr const char* platformName(Platform platform)
+    {
+        switch (platform)
+        {
+        case Platform::CosmacVip:   return "COSMAC VIP";
+        case Platform::Dream6800:   return "DREAM 6800";
+        case Platform::Eti660:      return "ETI-660";
+        case Platform::Chip48:      return "CHIP-48";
+        case Platform::SuperChip:   return "SUPER-CHIP";
+        case Platform::XoChip:      return "XO-CHIP";
+        }
+
+        return "unknown";
+    }
+
+    /**
+     * the names platformFromKey() takes, for messages
+    **/
+    inline const char* const c_platformKeys = "vip, dream6800, eti660, chip48, schip or xochip";
+
+    /**
+     * @param key a platform as options name it, see c_platformKeys
+     * @returns false if key names none, platform is then left as is
+    **/
+    inline bool platformFromKey(const std::string& key, Platform& platform)
+    {
+        static const std::pair<const char*, Platform> c_keys[]
+        {
+            { "vip", Platform::CosmacVip },
+            { "dream6800", Platform::Dream6800 },
+            { "eti660", Platform::Eti660 },
+            { "chip48", Platform::Chip48 },
+            { "schip", Platform::SuperChip },
+            { "xochip", Platform::XoChip }
+        };
+
+        for (const std::pair<const char*, Platform>& named : c_keys)
+            if (key == named.first)
+            {
+                platform = named.second;
+                return true;
+            }
+
+        return false;
+    }
+}
+
+#endif /* PLATFORM_H */
@@ -0,0 +1,248 @@
+#include "rom.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <array>
+#include <filesystem>
+#include <stdexcept>
+
+#include "analysiscache.h"
+
+namespace chip8
+{
+    MappedRom::MappedRom(const std::string& path)
+    {
+        const int fd = open(path.c_str(), O_RDONLY);
+        if (fd < 0)
+            throw std::runtime_error("ERROR: Unable to load rom " + path + ": " + strerror(errno));
+
+        struct stat info;
+        if (fstat(fd, &info) < 0 || !S_ISREG(info.st_mode))
+        {
+            close(fd);
+            throw std::runtime_error("ERROR: Rom " + path + " is not a regular file!");
+        }
+
+        if (info.st_size == 0 || static_cast<uint64_t>(info.st_size) > Memory::maxRomSize())
+        {
+            close(fd);
+            throw std::runtime_error("ERROR: Rom " + path + " is " + std::to_string(info.st_size) +
+                                     " bytes, it has to be 1 to " + std::to_string(Memory::maxRomSize()) + "!");
+        }
+
+        void* data = mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        close(fd);
+
+        if (data == MAP_FAILED)
+            throw std::runtime_error("ERROR: Unable to map rom " + path + ": " + strerror(errno));
+
+        m_data = static_cast<const uint8_t*>(data);
+        m_size = info.st_size;
+    }
+
+    MappedRom::~MappedRom()
+    {
+        munmap(const_cast<uint8_t*>(m_data), m_size);
+    }
+
+
+    uint64_t romHash(const uint8_t* rom, size_t size)
+    {
+        uint64_t hash = 0xcbf29ce484222325;
+        for (size_t i = 0; i < size; i++)
+            hash = (hash ^ rom[i]) * 0x100000001b3;
+        return hash;
+    }
+
+    RomAnalysis analyzeRom(const uint8_t* rom, size_t size)
+    {
+        RomAnalysis analysis {};
+        analysis.hash = romHash(rom, size);
+        analysis.size = size;
+
+        if (size > Memory::maxRomSize(Platform::CosmacVip))
+        {
+            analysis.platform = Platform::XoChip;
+            analysis.quirks = quirksFor(analysis.platform);
+            return analysis;
+        }
+
+        const uint16_t start = Memory::romStartAddress();
+        const uint16_t end = start + size;
+
+        bool isSuperChip = false;
+        bool isXoChip = false;
+
+        // only instructions reachable from the start count, sprites and other
+        // data would otherwise look like anything
+        std::vector<uint16_t> toVisit { start };
+
+        // bit addr % 64 of word addr / 64 set for the first bytes of the instructions reached
+        std::array<uint64_t, RomAnalysis::k_analyzedSize / 64> code {};
+
+        while (!toVisit.empty())
+        {
+            const uint16_t addr = toVisit.back();
+            toVisit.pop_back();
+
+            if (addr < start || addr + 1 >= end)
+                continue;
+
+            if ((code[addr / 64] >> (addr % 64)) & 1)
+                continue;
+            code[addr / 64] |= uint64_t(1) << (addr % 64);
+
+            const uint16_t instruction = (rom[addr - start] << 8) | rom[addr - start + 1];
+            const uint8_t low = instruction & 0xFF;
+
+            // where the instruction goes on to, if anywhere
+            uint16_t next = addr + 2;
+
+            switch (instruction & 0xF000)
+            {
+            case 0x0:
+                if (instruction == 0x00EE || instruction == 0x00FD)     // return, exit
+                    continue;
+
+                if ((instruction & 0xFFF0) == 0x00D0)                   // scroll up
+                    isXoChip = true;
+
+                if ((instruction & 0xFFF0) == 0x00C0 || (instruction >= 0x00FB && instruction <= 0x00FF))
+                    isSuperChip = true;
+                break;
+
+            case 0x1000:
+                toVisit.push_back(instruction & 0xFFF);
+                continue;
+
+            case 0x2000:
+                toVisit.push_back(instruction & 0xFFF);
+                toVisit.push_back(next);
+                continue;
+
+            case 0x5000:
+                if ((instruction & 0xF) == 2 || (instruction & 0xF) == 3)   // save/load Vx - Vy
+                {
+                    isXoChip = true;
+                    break;
+                }
+                [[fallthrough]];
+
+            case 0x3000:
+            case 0x4000:
+            case 0x9000:
+            case 0xE000:
+                toVisit.push_back(addr + 4);
+                toVisit.push_back(next);
+                continue;
+
+            case 0xB000:                                                // target unknown
+                continue;
+
+            case 0xF000:
+                if (instruction == 0xF000 || instruction == 0xF002 || low == 0x01 || low == 0x3A)
+                    isXoChip = true;
+
+                if (instruction == 0xF000)                              // followed by a 16 bit address
+                    next = addr + 4;
+
+                if (low == 0x30 || low == 0x75 || low == 0x85)
+                    isSuperChip = true;
+                break;
+
+            default:
+                break;
+            }
+
+            toVisit.push_back(next);
+        }
+
+        analysis.platform = isXoChip ? Platform::XoChip : isSuperChip ? Platform::SuperChip : Platform::CosmacVip;
+        analysis.quirks = quirksFor(analysis.platform);
+        return analysis;
+    }
+
+    Platform detectPlatform(const uint8_t* rom, size_t size)
+    {
+        return analyzeRom(rom, size).platform;
+    }
+
+    Platform choosePlatform(const uint8_t* rom, size_t size, AnalysisCache* analysisCache, std::optional<Platform> platform)
+    {
+        if (platform)
+            return *platform;
+
+        return analysisCache ? analysisCache->analyze(rom, size).platform : detectPlatform(rom, size);
+    }
+
+
+    RomCatalog::RomCatalog(const std::string& directory, AnalysisCache* analysisCache, std::optional<Platform> chosen)
+    {
+        namespace fs = std::filesystem;
+
+        std::vector<std::string> paths;
+        try
+        {
+            for (const fs::directory_entry& file : fs::recursive_directory_iterator{directory})
+                if (file.is_regular_file())
+                    paths.push_back(file.path().string());
+        }
+        catch (const fs::filesystem_error& e)
+        {
+            throw std::runtime_error("ERROR: Unable to read rom directory " + directory + ": " + e.what());
+        }
+
+        std::sort(paths.begin(), paths.end());
+
+        for (const std::string& path : paths)
+        {
+            // errors after the rom is mapped come from the cache, not the rom
+            bool isMapped = false;
+            try
+            {
+                const MappedRom rom{path};
+                isMapped = true;
+
+                const uint64_t hash = romHash(rom.data(), rom.size());
+
+                if (m_byHash.count(hash))
+                    continue;
+
+                const Platform platform = choosePlatform(rom.data(), rom.size(), analysisCache, chosen);
+                if (rom.size() > Memory::maxRomSize(platform))
+                {
+                    m_rejected.push_back("ERROR: Rom " + path + " is " + std::to_string(rom.size()) + " bytes, at most " +
+                                         std::to_string(Memory::maxRomSize(platform)) + " fit in " + platformName(platform) + " memory!");
+                    continue;
+                }
+
+                const size_t offset = m_images.size();
+
+                m_images.resize(offset + Memory::maxRomSize(platform), 0);
+                std::copy_n(rom.data(), rom.size(), &m_images[offset]);
+
+                m_byHash[hash] = m_entries.size();
+                m_entries.push_back({ hash, path, static_cast<uint32_t>(rom.size()), platform, quirksFor(platform), offset });
+            }
+            catch (const std::runtime_error& e)
+            {
+                if (isMapped)
+                    throw;
+
+                m_rejected.push_back(e.what());
+            }
+        }
+    }
+
+    const RomCatalog::Entry* RomCatalog::find(uint64_t hash) const
+    {
+        const auto it = m_byHash.find(hash);
+        return it == m_byHash.end() ? nullptr : &m_entries[it->second];
+    }
+}
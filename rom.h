@@ -0,0 +1,163 @@
+#ifndef ROM_H
+#define ROM_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "chip8.h"
+#include "platform.h"
+
+namespace chip8
+{
+    class AnalysisCache;
+
+    /**
+     * A rom file mapped read-only into memory.
+     * The size is checked before anything is read, so a rom too big for
+     * chip8::Memory is rejected without touching its contents.
+    **/
+    class MappedRom
+    {
+    public:
+        /**
+         * @throws runtime_error
+         *  if path cannot be mapped, is empty or holds more than Memory::maxRomSize() bytes
+        **/
+        MappedRom(const std::string& path);
+        ~MappedRom();
+
+        MappedRom(const MappedRom&) = delete;
+        MappedRom& operator=(const MappedRom&) = delete;
+
+        const uint8_t* data() const { return m_data; }
+        size_t size() const { return m_size; }
+
+    private:
+        const uint8_t* m_data {};
+        size_t m_size {};
+    };
+
+    /**
+     * @returns 64 bit FNV-1a hash of the rom's contents
+    **/
+    uint64_t romHash(const uint8_t* rom, size_t size);
+
+    /**
+     * What the instructions reachable from the start address tell about a
+     * rom, see analyzeRom()
+    **/
+    struct RomAnalysis
+    {
+        // code is looked for in the 4KB of CHIP-8, larger roms are XO-CHIP ones without that
+        static constexpr uint32_t k_analyzedSize = Memory::sizeFor(Platform::CosmacVip);
+
+        uint64_t hash;                                  // see romHash()
+        uint32_t size;
+
+        Platform platform;
+        Quirks quirks;
+    };
+
+    /**
+     * follows every path from the start address through jumps, calls and
+     * skips, telling code from data. Bnnn targets are not known, so code
+     * only reached through one is taken as data.
+     * the platform is guessed from the instructions only later platforms
+     * have, plain CHIP-8 roms are taken as COSMAC VIP ones.
+    **/
+    RomAnalysis analyzeRom(const uint8_t* rom, size_t size);
+
+    /**
+     * @returns analyzeRom(rom, size).platform
+    **/
+    Platform detectPlatform(const uint8_t* rom, size_t size);
+
+    /**
+     * @param analysisCache where the rom's analysis is looked up, and added
+     *  if missing, nullptr to analyse it anew
+     * @param platform chosen by the user, e.g. with --platform, taken as is
+     * @returns the platform to run the rom on, the one detected if none was chosen
+     * @throws runtime_error if the analysis cannot be added to the cache
+    **/
+    Platform choosePlatform(const uint8_t* rom, size_t size, AnalysisCache* analysisCache = nullptr,
+                            std::optional<Platform> platform = std::nullopt);
+
+    /**
+     * Index of the roms in a directory tree, keyed by content hash.
+     *
+     * Every rom is read once while indexing and kept as a ready to copy
+     * image of the program area of its platform's memory, so starting an
+     * Interpreter from an entry is a single copy with no file system access.
+     * Files holding the same rom share an entry.
+    **/
+    class RomCatalog
+    {
+    public:
+        struct Entry
+        {
+            uint64_t hash;
+            std::string path;     // first file found with these contents
+            uint32_t size;
+            Platform platform;
+            Quirks quirks;
+
+            size_t offset;        // of the image in the catalog, in bytes
+        };
+
+        /**
+         * indexes every regular file below directory,
+         * files that are no valid roms are listed in rejected()
+         * @param analysisCache where the roms' analyses are looked up, and
+         *  added if missing, nullptr to analyse every rom anew
+         * @param platform of every rom instead of the one detected, if given.
+         *  roms too big for its memory are rejected.
+         * @throws runtime_error
+         *  if directory cannot be read or an analysis cannot be added to the cache
+        **/
+        RomCatalog(const std::string& directory, AnalysisCache* analysisCache = nullptr,
+                   std::optional<Platform> platform = std::nullopt);
+
+        RomCatalog(const RomCatalog&) = delete;
+        RomCatalog& operator=(const RomCatalog&) = delete;
+
+        /**
+         * @returns the entries ordered by path
+        **/
+        const std::vector<Entry>& entries() const { return m_entries; }
+
+        /**
+         * @returns nullptr if no rom hashes to hash
+        **/
+        const Entry* find(uint64_t hash) const;
+
+        /**
+         * @returns imageSize(entry) bytes, the rom padded with zeros, to be
+         *  passed to Interpreter(const uint8_t*, size_t)
+        **/
+        const uint8_t* image(const Entry& entry) const { return &m_images[entry.offset]; }
+
+        /**
+         * @returns the program area of the entry's memory, Memory::maxRomSize(entry.platform)
+        **/
+        static size_t imageSize(const Entry& entry) { return Memory::maxRomSize(entry.platform); }
+
+        /**
+         * @returns why files were left out, one message naming the file each
+        **/
+        const std::vector<std::string>& rejected() const { return m_rejected; }
+
+    private:
+        std::vector<Entry> m_entries;
+        std::unordered_map<uint64_t, size_t> m_byHash;  // hash to index in m_entries
+
+        std::vector<uint8_t> m_images;
+        std::vector<std::string> m_rejected;
+    };
+}
+
+#endif /* ROM_H */
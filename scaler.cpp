@@ -0,0 +1,681 @@
+#include "scaler.h"
+
+#include <string.h>
+
+#include <algorithm>
+#include <array>
+#include <fstream>
+#include <stdexcept>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define SCALER_HAVE_X86_KERNELS
+#endif
+
+namespace emuGL
+{
+    namespace
+    {
+        const uint16_t c_wordBits = 64;
+        const uint16_t c_slackPixels = 8;  // widest vector store, in pixels
+
+        uint32_t packRgba(const Color& color)
+        {
+            const uint8_t bytes[4] { color.red(), color.green(), color.blue(), color.alpha() };
+            uint32_t packed;
+            memcpy(&packed, bytes, sizeof(packed));
+            return packed;
+        }
+
+        /**
+         * @returns the table spreading the bits of a byte Factor bits apart,
+         *  bit i landing on bit i * Factor + Factor - 1
+        **/
+        template <int Factor>
+        constexpr std::array<uint32_t, 256> spreadTable()
+        {
+            std::array<uint32_t, 256> table {};
+            for (uint32_t byte = 0; byte < 256; byte++)
+                for (int bit = 0; bit < 8; bit++)
+                    if (byte & (1 << bit))
+                        table[byte] |= 1u << (bit * Factor + Factor - 1);
+            return table;
+        }
+
+        template <int Factor>
+        constexpr std::array<uint32_t, 256> c_spread = spreadTable<Factor>();
+
+        /**
+         * ors the count low bits of bits into row from pixel at on, count <= 32
+        **/
+        inline void putBits(uint64_t* row, size_t at, uint32_t bits, unsigned count)
+        {
+            const size_t word = at / c_wordBits;
+            const unsigned offset = at % c_wordBits;
+
+            if (offset + count <= c_wordBits)
+                row[word] |= uint64_t(bits) << (c_wordBits - offset - count);
+            else
+            {
+                row[word] |= uint64_t(bits) >> (offset + count - c_wordBits);
+                row[word + 1] |= uint64_t(bits) << (2 * c_wordBits - offset - count);
+            }
+        }
+
+        /**
+         * writes word no. word of Factor rows of subpixels, one per output
+         * pixel of a source pixel, side by side into out
+        **/
+        template <int Factor>
+        void interleave(const uint64_t (&subpixels)[Factor], uint64_t* out, uint16_t word)
+        {
+            for (int byte = 0; byte < 8; byte++)
+            {
+                uint32_t chunk = 0;
+                for (int sub = 0; sub < Factor; sub++)
+                    chunk |= c_spread<Factor>[(subpixels[sub] >> (c_wordBits - 8 - 8 * byte)) & 0xFF] >> sub;
+
+                putBits(out, (word * c_wordBits + byte * 8) * Factor, chunk, 8 * Factor);
+            }
+        }
+
+        /**
+         * A source row and its neighbours as seen from each pixel, 64 pixels at a time.
+         * Pixels off the frame repeat the edge, as Scale2x and Scale3x expect.
+        **/
+        struct Neighbourhood
+        {
+            const uint64_t* up;
+            const uint64_t* row;
+            const uint64_t* down;
+            uint16_t words;
+
+            // of pixel x - 1 and x + 1
+            uint64_t left(const uint64_t* r, uint16_t i) const { return (r[i] >> 1) | (i > 0 ? r[i - 1] << 63 : r[i] & (1ull << 63)); }
+            uint64_t right(const uint64_t* r, uint16_t i) const { return (r[i] << 1) | (i + 1 < words ? r[i + 1] >> 63 : r[i] & 1); }
+        };
+
+        /**
+         * the Scale2x rules, on whole words of pixels:
+         *  A B C     E0 E1
+         *  D E F  ->
+         *  G H I     E2 E3
+        **/
+        void scale2xRow(const Neighbourhood& n, uint64_t* top, uint64_t* bottom)
+        {
+            for (uint16_t i = 0; i < n.words; i++)
+            {
+                const uint64_t B = n.up[i], E = n.row[i], H = n.down[i];
+                const uint64_t D = n.left(n.row, i), F = n.right(n.row, i);
+
+                // B != H && D != F, equality of single bits being ~(a ^ b)
+                const uint64_t corner = (B ^ H) & (D ^ F);
+                const uint64_t db = corner & ~(D ^ B), bf = corner & ~(B ^ F);
+                const uint64_t dh = corner & ~(D ^ H), hf = corner & ~(H ^ F);
+
+                const uint64_t upper[2] { (db & D) | (~db & E), (bf & F) | (~bf & E) };
+                const uint64_t lower[2] { (dh & D) | (~dh & E), (hf & F) | (~hf & E) };
+                interleave<2>(upper, top, i);
+                interleave<2>(lower, bottom, i);
+            }
+        }
+
+        /**
+         * the Scale3x rules, on whole words of pixels:
+         *  A B C     E0 E1 E2
+         *  D E F  -> E3 E4 E5
+         *  G H I     E6 E7 E8
+        **/
+        void scale3xRow(const Neighbourhood& n, uint64_t* top, uint64_t* middle, uint64_t* bottom)
+        {
+            for (uint16_t i = 0; i < n.words; i++)
+            {
+                const uint64_t A = n.left(n.up, i), B = n.up[i], C = n.right(n.up, i);
+                const uint64_t D = n.left(n.row, i), E = n.row[i], F = n.right(n.row, i);
+                const uint64_t G = n.left(n.down, i), H = n.down[i], I = n.right(n.down, i);
+
+                const uint64_t corner = (B ^ H) & (D ^ F);
+                const uint64_t db = corner & ~(D ^ B), bf = corner & ~(B ^ F);
+                const uint64_t dh = corner & ~(D ^ H), hf = corner & ~(H ^ F);
+
+                const uint64_t b = (db & (E ^ C)) | (bf & (E ^ A));
+                const uint64_t d = (db & (E ^ G)) | (dh & (E ^ A));
+                const uint64_t f = (bf & (E ^ I)) | (hf & (E ^ C));
+                const uint64_t h = (dh & (E ^ I)) | (hf & (E ^ G));
+
+                const uint64_t upper[3] { (db & D) | (~db & E), (b & B) | (~b & E), (bf & F) | (~bf & E) };
+                const uint64_t centre[3] { (d & D) | (~d & E), E, (f & F) | (~f & E) };
+                const uint64_t lower[3] { (dh & D) | (~dh & E), (h & H) | (~h & E), (hf & F) | (~hf & E) };
+                interleave<3>(upper, top, i);
+                interleave<3>(centre, middle, i);
+                interleave<3>(lower, bottom, i);
+            }
+        }
+
+        /**
+         * sets the intensity of lit pixels from x on to 255 and scales the others by persistence
+        **/
+        void decayPixels(const uint64_t* bits, uint16_t x, uint16_t width, uint8_t persistence, uint8_t* intensity)
+        {
+            for (; x < width; x++)
+            {
+                const bool isSet = (bits[x / c_wordBits] >> (c_wordBits - 1 - x % c_wordBits)) & 1;
+                intensity[x] = isSet ? 255 : intensity[x] * persistence >> 8;
+            }
+        }
+
+        void decayRowScalar(const uint64_t* bits, uint16_t width, uint8_t persistence, uint8_t* intensity)
+        {
+            decayPixels(bits, 0, width, persistence, intensity);
+        }
+
+        void expandRowScalar(const uint64_t* bits, uint16_t width, uint16_t scale, uint32_t fg, uint32_t bg, uint32_t* out)
+        {
+            for (uint16_t x = 0; x < width; x++)
+            {
+                const bool isSet = (bits[x / c_wordBits] >> (c_wordBits - 1 - x % c_wordBits)) & 1;
+                std::fill_n(out + x * scale, scale, isSet ? fg : bg);
+            }
+        }
+
+        void expandPlanesRowScalar(const uint64_t* first, const uint64_t* second, uint16_t width, uint16_t scale,
+                                   const uint32_t* colors, uint32_t* out)
+        {
+            for (uint16_t x = 0; x < width; x++)
+            {
+                const int shift = c_wordBits - 1 - x % c_wordBits;
+                const uint8_t bits = ((first[x / c_wordBits] >> shift) & 1) | (((second[x / c_wordBits] >> shift) & 1) << 1);
+                std::fill_n(out + x * scale, scale, colors[bits]);
+            }
+        }
+
+#ifdef SCALER_HAVE_X86_KERNELS
+        template <int Lane>
+        __attribute__((target("sse2")))
+        inline void stretchLaneSse2(__m128i colors, uint16_t scale, uint32_t* out)
+        {
+            const __m128i color = _mm_shuffle_epi32(colors, Lane * 0x55);
+            for (uint16_t i = 0; i < scale; i += 4)
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), color);
+        }
+
+        /**
+         * stores the colors of pixels x to x + 3, scale times each
+        **/
+        __attribute__((target("sse2")))
+        inline void storePixelsSse2(__m128i colors, uint16_t x, uint16_t scale, uint32_t* out)
+        {
+            if (scale == 1)
+            {
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(out + x), colors);
+                return;
+            }
+
+            // stores of a pixel spill into the next one, which overwrites them
+            stretchLaneSse2<0>(colors, scale, out + (x + 0) * scale);
+            stretchLaneSse2<1>(colors, scale, out + (x + 1) * scale);
+            stretchLaneSse2<2>(colors, scale, out + (x + 2) * scale);
+            stretchLaneSse2<3>(colors, scale, out + (x + 3) * scale);
+        }
+
+        /**
+         * @returns all ones in the lanes of the pixels set in nibble, 4 pixels from the leftmost one
+        **/
+        __attribute__((target("sse2")))
+        inline __m128i nibbleMaskSse2(const uint64_t* bits, uint16_t x)
+        {
+            const __m128i lanes = _mm_set_epi32(1, 2, 4, 8);
+            const int nibble = (bits[x / c_wordBits] >> (c_wordBits - 4 - x % c_wordBits)) & 0xF;
+            return _mm_cmpeq_epi32(_mm_and_si128(_mm_set1_epi32(nibble), lanes), lanes);
+        }
+
+        __attribute__((target("sse2")))
+        inline __m128i selectSse2(__m128i mask, __m128i ifSet, __m128i otherwise)
+        {
+            return _mm_or_si128(_mm_and_si128(mask, ifSet), _mm_andnot_si128(mask, otherwise));
+        }
+
+        /**
+         * 4 pixels at a time, a nibble of the row is turned into a lane mask
+         * selecting between the two colors
+        **/
+        __attribute__((target("sse2")))
+        void expandRowSse2(const uint64_t* bits, uint16_t width, uint16_t scale, uint32_t fg, uint32_t bg, uint32_t* out)
+        {
+            const __m128i fgv = _mm_set1_epi32(fg);
+            const __m128i bgv = _mm_set1_epi32(bg);
+
+            for (uint16_t x = 0; x < width; x += 4)
+                storePixelsSse2(selectSse2(nibbleMaskSse2(bits, x), fgv, bgv), x, scale, out);
+        }
+
+        /**
+         * the same over 2 planes, the lane masks of both picking one of 4 colors
+        **/
+        __attribute__((target("sse2")))
+        void expandPlanesRowSse2(const uint64_t* first, const uint64_t* second, uint16_t width, uint16_t scale,
+                                 const uint32_t* colors, uint32_t* out)
+        {
+            const __m128i none = _mm_set1_epi32(colors[0]);
+            const __m128i onFirst = _mm_set1_epi32(colors[1]);
+            const __m128i onSecond = _mm_set1_epi32(colors[2]);
+            const __m128i onBoth = _mm_set1_epi32(colors[3]);
+
+            for (uint16_t x = 0; x < width; x += 4)
+            {
+                const __m128i isFirst = nibbleMaskSse2(first, x);
+                const __m128i isSecond = nibbleMaskSse2(second, x);
+                const __m128i pixels = selectSse2(isSecond, selectSse2(isFirst, onBoth, onSecond), selectSse2(isFirst, onFirst, none));
+                storePixelsSse2(pixels, x, scale, out);
+            }
+        }
+
+        /**
+         * stores the colors of pixels x to x + 7, scale times each
+        **/
+        __attribute__((target("avx2")))
+        inline void storePixelsAvx2(__m256i colors, uint16_t x, uint16_t scale, uint32_t* out)
+        {
+            if (scale == 1)
+            {
+                _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + x), colors);
+                return;
+            }
+
+            // stores of a pixel spill into the next one, which overwrites them
+            for (int lane = 0; lane < 8; lane++)
+            {
+                const __m256i color = _mm256_permutevar8x32_epi32(colors, _mm256_set1_epi32(lane));
+                uint32_t* dst = out + (x + lane) * scale;
+                for (uint16_t i = 0; i < scale; i += 8)
+                    _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), color);
+            }
+        }
+
+        /**
+         * @returns all ones in the lanes of the pixels set in the byte of 8 pixels from the leftmost one
+        **/
+        __attribute__((target("avx2")))
+        inline __m256i byteMaskAvx2(const uint64_t* bits, uint16_t x)
+        {
+            const __m256i lanes = _mm256_set_epi32(1, 2, 4, 8, 16, 32, 64, 128);
+            const int byte = (bits[x / c_wordBits] >> (c_wordBits - 8 - x % c_wordBits)) & 0xFF;
+            return _mm256_cmpeq_epi32(_mm256_and_si256(_mm256_set1_epi32(byte), lanes), lanes);
+        }
+
+        /**
+         * 8 pixels at a time, a byte of the row is turned into a lane mask
+         * selecting between the two colors
+        **/
+        __attribute__((target("avx2")))
+        void expandRowAvx2(const uint64_t* bits, uint16_t width, uint16_t scale, uint32_t fg, uint32_t bg, uint32_t* out)
+        {
+            const __m256i fgv = _mm256_set1_epi32(fg);
+            const __m256i bgv = _mm256_set1_epi32(bg);
+
+            for (uint16_t x = 0; x < width; x += 8)
+                storePixelsAvx2(_mm256_blendv_epi8(bgv, fgv, byteMaskAvx2(bits, x)), x, scale, out);
+        }
+
+        /**
+         * the same over 2 planes, the lane masks of both making a 2 bit
+         * index per lane into the 4 colors
+        **/
+        __attribute__((target("avx2")))
+        void expandPlanesRowAvx2(const uint64_t* first, const uint64_t* second, uint16_t width, uint16_t scale,
+                                 const uint32_t* colors, uint32_t* out)
+        {
+            const __m256i palette = _mm256_broadcastsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i*>(colors)));
+            const __m256i firstBit = _mm256_set1_epi32(1);
+            const __m256i secondBit = _mm256_set1_epi32(2);
+
+            for (uint16_t x = 0; x < width; x += 8)
+            {
+                const __m256i index = _mm256_or_si256(_mm256_and_si256(byteMaskAvx2(first, x), firstBit),
+                                                      _mm256_and_si256(byteMaskAvx2(second, x), secondBit));
+                storePixelsAvx2(_mm256_permutevar8x32_epi32(palette, index), x, scale, out);
+            }
+        }
+#endif
+
+#ifdef SCALER_HAVE_X86_KERNELS
+        /**
+         * @returns the byte of row holding pixels x to x + 7
+        **/
+        inline uint64_t pixelByte(const uint64_t* bits, uint16_t x)
+        {
+            return (bits[x / c_wordBits] >> (c_wordBits - 8 - x % c_wordBits)) & 0xFF;
+        }
+
+        /**
+         * 16 pixels at a time, lit ones set to 255 and the others scaled by
+         * persistence in 16 bit lanes
+        **/
+        __attribute__((target("sse2")))
+        void decayRowSse2(const uint64_t* bits, uint16_t width, uint8_t persistence, uint8_t* intensity)
+        {
+            const __m128i select = _mm_set_epi8(1, 2, 4, 8, 16, 32, 64, -128, 1, 2, 4, 8, 16, 32, 64, -128);
+            const __m128i factor = _mm_set1_epi16(persistence);
+            const __m128i zero = _mm_setzero_si128();
+            const uint64_t broadcast = 0x0101010101010101ull;
+
+            uint16_t x = 0;
+            for (; x + 16 <= width; x += 16)
+            {
+                const __m128i bytes = _mm_set_epi64x(pixelByte(bits, x + 8) * broadcast, pixelByte(bits, x) * broadcast);
+                const __m128i lit = _mm_cmpeq_epi8(_mm_and_si128(bytes, select), select);
+
+                const __m128i current = _mm_loadu_si128(reinterpret_cast<const __m128i*>(intensity + x));
+                const __m128i low = _mm_srli_epi16(_mm_mullo_epi16(_mm_unpacklo_epi8(current, zero), factor), 8);
+                const __m128i high = _mm_srli_epi16(_mm_mullo_epi16(_mm_unpackhi_epi8(current, zero), factor), 8);
+
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(intensity + x), _mm_or_si128(_mm_packus_epi16(low, high), lit));
+            }
+
+            decayPixels(bits, x, width, persistence, intensity);
+        }
+
+        /**
+         * 32 pixels at a time, as decayRowSse2()
+        **/
+        __attribute__((target("avx2")))
+        void decayRowAvx2(const uint64_t* bits, uint16_t width, uint8_t persistence, uint8_t* intensity)
+        {
+            const __m256i select = _mm256_set1_epi64x(0x0102040810204080ull);
+            const __m256i factor = _mm256_set1_epi16(persistence);
+            const __m256i zero = _mm256_setzero_si256();
+            const uint64_t broadcast = 0x0101010101010101ull;
+
+            uint16_t x = 0;
+            for (; x + 32 <= width; x += 32)
+            {
+                const __m256i bytes = _mm256_set_epi64x(pixelByte(bits, x + 24) * broadcast, pixelByte(bits, x + 16) * broadcast,
+                                                        pixelByte(bits, x + 8) * broadcast, pixelByte(bits, x) * broadcast);
+                const __m256i lit = _mm256_cmpeq_epi8(_mm256_and_si256(bytes, select), select);
+
+                // unpacking and packing both work within 128 bit halves, so the pixels end up in order
+                const __m256i current = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(intensity + x));
+                const __m256i low = _mm256_srli_epi16(_mm256_mullo_epi16(_mm256_unpacklo_epi8(current, zero), factor), 8);
+                const __m256i high = _mm256_srli_epi16(_mm256_mullo_epi16(_mm256_unpackhi_epi8(current, zero), factor), 8);
+
+                _mm256_storeu_si256(reinterpret_cast<__m256i*>(intensity + x), _mm256_or_si256(_mm256_packus_epi16(low, high), lit));
+            }
+
+            decayPixels(bits, x, width, persistence, intensity);
+        }
+#endif
+
+        uint32_t crc32(const uint8_t* data, size_t len, uint32_t crc = 0)
+        {
+            static uint32_t table[256] {};
+            if (!table[1])
+                for (uint32_t n = 0; n < 256; n++)
+                {
+                    uint32_t c = n;
+                    for (int k = 0; k < 8; k++)
+                        c = c & 1 ? 0xEDB88320 ^ (c >> 1) : c >> 1;
+                    table[n] = c;
+                }
+
+            crc = ~crc;
+            for (size_t i = 0; i < len; i++)
+                crc = table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+            return ~crc;
+        }
+
+        void putBigEndian(std::vector<uint8_t>& out, uint32_t val)
+        {
+            out.push_back(val >> 24);
+            out.push_back(val >> 16);
+            out.push_back(val >> 8);
+            out.push_back(val);
+        }
+
+        void writePngChunk(std::ofstream& file, const char* type, const std::vector<uint8_t>& data)
+        {
+            std::vector<uint8_t> chunk;
+            putBigEndian(chunk, data.size());
+            chunk.insert(chunk.end(), type, type + 4);
+            chunk.insert(chunk.end(), data.begin(), data.end());
+            putBigEndian(chunk, crc32(chunk.data() + 4, chunk.size() - 4));
+
+            file.write(reinterpret_cast<const char*>(chunk.data()), chunk.size());
+        }
+    }
+
+
+    FrameScaler::FrameScaler(uint16_t width, uint16_t height, uint16_t scale, const Color& foreground, const Color& background)
+        :   m_width(width),
+            m_height(height),
+            m_scale(scale),
+            m_foreground(packRgba(foreground)),
+            m_background(packRgba(background)),
+            m_planeColors{m_background, m_foreground, m_foreground, m_foreground},
+            m_pixelScale(scale),
+            m_pixels(static_cast<size_t>(width) * scale * height * scale + c_slackPixels, m_background),
+            m_expandRow(&expandRowScalar),
+            m_expandPlanesRow(&expandPlanesRowScalar),
+            m_decayRow(&decayRowScalar)
+    {
+        if (scale == 0 || width % 8)
+            throw std::runtime_error("ERROR: Frame width has to be a multiple of 8 and scale at least 1");
+
+#ifdef SCALER_HAVE_X86_KERNELS
+        if (__builtin_cpu_supports("avx2"))
+        {
+            m_expandRow = &expandRowAvx2;
+            m_expandPlanesRow = &expandPlanesRowAvx2;
+            m_decayRow = &decayRowAvx2;
+        }
+        else if (__builtin_cpu_supports("sse2"))
+        {
+            m_expandRow = &expandRowSse2;
+            m_expandPlanesRow = &expandPlanesRowSse2;
+            m_decayRow = &decayRowSse2;
+        }
+#endif
+
+        // from the background at 0 to the foreground at 255, channel by channel
+        const uint8_t* fg = reinterpret_cast<const uint8_t*>(&m_foreground);
+        const uint8_t* bg = reinterpret_cast<const uint8_t*>(&m_background);
+        for (int intensity = 0; intensity < 256; intensity++)
+        {
+            uint8_t color[4];
+            for (int channel = 0; channel < 4; channel++)
+                color[channel] = (bg[channel] * (255 - intensity) + fg[channel] * intensity + 127) / 255;
+            memcpy(&m_palette[intensity], color, sizeof(color));
+        }
+    }
+
+    void FrameScaler::setFilter(Upscale upscale, uint8_t persistence)
+    {
+        if (upscale != Upscale::None && m_width % c_wordBits)
+            throw std::runtime_error("ERROR: Upscaling needs a frame width that is a multiple of 64");
+
+        m_upscale = upscale;
+        m_factor = upscale == Upscale::Scale3x ? 3 : upscale == Upscale::Scale2x ? 2 : 1;
+        m_pixelScale = std::max(m_scale / m_factor, 1);
+
+        const size_t width = m_width * m_factor;
+        const size_t height = m_height * m_factor;
+
+        m_upscaled.assign(m_upscale == Upscale::None ? 0 : width / c_wordBits * height, 0);
+
+        m_persistence = persistence;
+        m_intensity.assign(m_persistence ? width * height : 0, 0);
+
+        m_pixels.assign(width * m_pixelScale * height * m_pixelScale + c_slackPixels, m_background);
+    }
+
+    void FrameScaler::upscale(const uint64_t* rows, uint16_t wordsPerRow)
+    {
+        const uint16_t words = m_width / c_wordBits;
+        const uint16_t outWords = words * m_factor;
+
+        std::fill(m_upscaled.begin(), m_upscaled.end(), 0);
+
+        for (uint16_t y = 0; y < m_height; y++)
+        {
+            const Neighbourhood neighbourhood
+            {
+                rows + (y > 0 ? y - 1 : y) * wordsPerRow,
+                rows + y * wordsPerRow,
+                rows + (y + 1 < m_height ? y + 1 : y) * wordsPerRow,
+                words
+            };
+
+            uint64_t* out = m_upscaled.data() + y * m_factor * outWords;
+            if (m_upscale == Upscale::Scale2x)
+                scale2xRow(neighbourhood, out, out + outWords);
+            else
+                scale3xRow(neighbourhood, out, out + outWords, out + 2 * outWords);
+        }
+    }
+
+    void FrameScaler::setPlaneColors(const Color& second, const Color& both)
+    {
+        m_planeColors[2] = packRgba(second);
+        m_planeColors[3] = packRgba(both);
+    }
+
+    void FrameScaler::scale(const uint64_t* rows, uint16_t wordsPerRow, uint8_t planes)
+    {
+        const uint16_t upscaledWidth = m_width * m_factor;
+        const uint16_t upscaledHeight = m_height * m_factor;
+        const size_t planeWords = static_cast<size_t>(wordsPerRow) * m_height;
+
+        if (planes > 1 && (m_upscale != Upscale::None || m_persistence))
+        {
+            m_merged.assign(rows, rows + planeWords);
+            for (size_t word = 0; word < planeWords; word++)
+                m_merged[word] |= rows[planeWords + word];
+
+            rows = m_merged.data();
+            planes = 1;
+        }
+
+        if (planes > 1)
+        {
+            // every XO-CHIP frame, the rows of both planes expanded at once
+            const size_t outWidth = width();
+
+            for (uint16_t y = 0; y < m_height; y++)
+            {
+                uint32_t* line = m_pixels.data() + y * m_pixelScale * outWidth;
+                const uint64_t* first = rows + y * wordsPerRow;
+
+                m_expandPlanesRow(first, first + planeWords, m_width, m_pixelScale, m_planeColors, line);
+
+                for (uint16_t i = 1; i < m_pixelScale; i++)
+                    memcpy(line + i * outWidth, line, outWidth * sizeof(uint32_t));
+            }
+
+            return;
+        }
+
+        if (m_upscale != Upscale::None)
+        {
+            upscale(rows, wordsPerRow);
+            rows = m_upscaled.data();
+            wordsPerRow = upscaledWidth / c_wordBits;
+        }
+
+        const size_t outWidth = width();
+
+        for (uint16_t y = 0; y < upscaledHeight; y++)
+        {
+            uint32_t* line = m_pixels.data() + y * m_pixelScale * outWidth;
+            const uint64_t* bits = rows + y * wordsPerRow;
+
+            if (m_persistence)
+            {
+                uint8_t* intensity = m_intensity.data() + y * upscaledWidth;
+                m_decayRow(bits, upscaledWidth, m_persistence, intensity);
+
+                for (uint16_t x = 0; x < upscaledWidth; x++)
+                    std::fill_n(line + x * m_pixelScale, m_pixelScale, m_palette[intensity[x]]);
+            }
+            else
+                m_expandRow(bits, upscaledWidth, m_pixelScale, m_foreground, m_background, line);
+
+            for (uint16_t i = 1; i < m_pixelScale; i++)
+                memcpy(line + i * outWidth, line, outWidth * sizeof(uint32_t));
+        }
+    }
+
+    void FrameScaler::writePpm(const std::string& path) const
+    {
+        std::ofstream file{path, std::ios::out | std::ios::binary};
+        if (!file.good())
+            throw std::runtime_error("ERROR: Unable to write frame to " + path);
+
+        file << "P6\n" << width() << ' ' << height() << "\n255\n";
+
+        std::vector<uint8_t> rgb;
+        rgb.reserve(static_cast<size_t>(width()) * height() * 3);
+        for (size_t i = 0; i < static_cast<size_t>(width()) * height(); i++)
+        {
+            const uint8_t* px = reinterpret_cast<const uint8_t*>(&m_pixels[i]);
+            rgb.insert(rgb.end(), px, px + 3);
+        }
+
+        file.write(reinterpret_cast<const char*>(rgb.data()), rgb.size());
+    }
+
+    void FrameScaler::writePng(const std::string& path) const
+    {
+        std::ofstream file{path, std::ios::out | std::ios::binary};
+        if (!file.good())
+            throw std::runtime_error("ERROR: Unable to write frame to " + path);
+
+        static const uint8_t signature[8] { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+        file.write(reinterpret_cast<const char*>(signature), sizeof(signature));
+
+        std::vector<uint8_t> header;
+        putBigEndian(header, width());
+        putBigEndian(header, height());
+        header.insert(header.end(), { 8, 6, 0, 0, 0 }); // 8 bit RGBA, no interlacing
+        writePngChunk(file, "IHDR", header);
+
+        // scanlines with filter type 0, in stored (uncompressed) deflate blocks
+        std::vector<uint8_t> raw;
+        raw.reserve((static_cast<size_t>(pitch()) + 1) * height());
+        for (int y = 0; y < height(); y++)
+        {
+            const uint8_t* line = reinterpret_cast<const uint8_t*>(m_pixels.data() + static_cast<size_t>(y) * width());
+            raw.push_back(0);
+            raw.insert(raw.end(), line, line + pitch());
+        }
+
+        std::vector<uint8_t> zlib { 0x78, 0x01 };
+        uint32_t adlerA = 1, adlerB = 0;
+        for (size_t pos = 0; pos < raw.size();)
+        {
+            const uint16_t len = static_cast<uint16_t>(std::min<size_t>(raw.size() - pos, 0xFFFF));
+            zlib.push_back(pos + len == raw.size());
+            zlib.insert(zlib.end(), { static_cast<uint8_t>(len), static_cast<uint8_t>(len >> 8),
+                                      static_cast<uint8_t>(~len), static_cast<uint8_t>(~len >> 8) });
+            zlib.insert(zlib.end(), raw.begin() + pos, raw.begin() + pos + len);
+
+            for (size_t i = pos; i < pos + len; i++)
+            {
+                adlerA = (adlerA + raw[i]) % 65521;
+                adlerB = (adlerB + adlerA) % 65521;
+            }
+
+            pos += len;
+        }
+        putBigEndian(zlib, (adlerB << 16) | adlerA);
+        writePngChunk(file, "IDAT", zlib);
+
+        writePngChunk(file, "IEND", {});
+    }
+
+    void FrameScaler::writeImage(const std::string& path) const
+    {
+        if (path.size() >= 4 && path.compare(path.size() - 4, 4, ".png") == 0)
+            writePng(path);
+        else
+            writePpm(path);
+    }
+}
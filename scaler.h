@@ -0,0 +1,141 @@
+#ifndef SCALER_H
+#define SCALER_H
+
+#include <stdint.h>
+
+#include <string>
+#include <vector>
+
+#include "color.h"
+
+namespace emuGL
+{
+    /**
+     * Software presenter turning a packed 1 bit per pixel frame, as kept by
+     * chip8::Display, into a scaled RGBA image. Frames of 2 planes, as
+     * XO-CHIP draws, get a color per combination of the planes' bits.
+     *
+     * Uses AVX2 or SSE2 bit expansion kernels when the host has them and a
+     * scalar loop otherwise. The image can be handed to a streaming texture
+     * as is, or written out as PPM or PNG.
+     *
+     * Optionally the frame is upscaled by a pixel art filter before and
+     * blended with the ones before it like a slow phosphor, see setFilter().
+    **/
+    class FrameScaler
+    {
+    public:
+        /**
+         * how the frame is upscaled before every pixel is blown up to a square
+        **/
+        enum class Upscale
+        {
+            None,
+            Scale2x,    // 2x2 per pixel rounding diagonal edges, the same as EPX
+            Scale3x     // 3x3 per pixel
+        };
+
+        /**
+         * @param width, height size of the source frame in pixels
+         * @param scale output pixels per source pixel along each axis, >= 1
+        **/
+        FrameScaler(uint16_t width, uint16_t height, uint16_t scale, const Color& foreground, const Color& background);
+
+        FrameScaler(const FrameScaler&) = delete;
+        FrameScaler& operator=(const FrameScaler&) = delete;
+
+        /**
+         * @param upscale applied first, its pixels being blown up by scale
+         *  divided by its factor, at least 1. the image size changes
+         *  unless scale is a multiple of the factor.
+         * @param persistence how much of a pixel's brightness, out of 256, is
+         *  left a frame after it went dark, 0 for none. hides the flicker of
+         *  sprites erased and drawn again every frame.
+         * @throws runtime_error if upscaling a frame whose width is no multiple of 64
+        **/
+        void setFilter(Upscale upscale, uint8_t persistence);
+
+        /**
+         * @param second, both the colors of pixels set on the second plane
+         *  only and on both planes, the foreground unless set
+        **/
+        void setPlaneColors(const Color& second, const Color& both);
+
+        /**
+         * @param rows the source height rows of wordsPerRow 64 bit words each,
+         *  the most significant bit of a row's first word being its leftmost pixel
+         * @param planes no. of such frames following each other in rows, 1 or 2.
+         *  with a filter set the planes are merged and shown in the foreground.
+        **/
+        void scale(const uint64_t* rows, uint16_t wordsPerRow, uint8_t planes = 1);
+
+        /**
+         * @returns width() * height() pixels, 4 bytes each in R, G, B, A order
+        **/
+        const uint32_t* pixels() const { return m_pixels.data(); }
+
+        int width() const { return m_width * m_factor * m_pixelScale; }
+        int height() const { return m_height * m_factor * m_pixelScale; }
+        int pitch() const { return width() * sizeof(uint32_t); }
+
+        /**
+         * @returns the foreground color packed the same way as pixels()
+        **/
+        uint32_t foreground() const { return m_foreground; }
+
+        /**
+         * writes the last scaled frame as a binary PPM (P6)
+         * @throws runtime_error if the file cannot be written
+        **/
+        void writePpm(const std::string& path) const;
+
+        /**
+         * writes the last scaled frame as an (uncompressed) RGBA PNG
+         * @throws runtime_error if the file cannot be written
+        **/
+        void writePng(const std::string& path) const;
+
+        /**
+         * writes a .png path as PNG and anything else as PPM
+        **/
+        void writeImage(const std::string& path) const;
+
+    private:
+        uint16_t m_width;
+        uint16_t m_height;
+        uint16_t m_scale;
+
+        uint32_t m_foreground;
+        uint32_t m_background;
+
+        // by the bits of the first and second plane, the first being bit 0
+        uint32_t m_planeColors[4];
+        std::vector<uint64_t> m_merged;         // the planes or'ed together, for filters
+
+        Upscale m_upscale { Upscale::None };
+        uint16_t m_factor { 1 };        // of m_upscale
+        uint16_t m_pixelScale;          // of the upscaled pixels
+
+        // the upscaled frame, packed like the source
+        std::vector<uint64_t> m_upscaled;
+
+        uint8_t m_persistence {};
+        std::vector<uint8_t> m_intensity;       // per upscaled pixel, 255 while lit
+        uint32_t m_palette[256] {};             // intensity to color
+
+        // output pixels, plus slack for the overlapping vector stores of the last pixel in a row
+        std::vector<uint32_t> m_pixels;
+
+        void (*m_expandRow)(const uint64_t* bits, uint16_t width, uint16_t scale, uint32_t fg, uint32_t bg, uint32_t* out);
+        void (*m_expandPlanesRow)(const uint64_t* first, const uint64_t* second, uint16_t width, uint16_t scale,
+                                  const uint32_t* colors, uint32_t* out);
+        void (*m_decayRow)(const uint64_t* bits, uint16_t width, uint8_t persistence, uint8_t* intensity);
+
+        /**
+         * runs m_upscale over rows into m_upscaled
+        **/
+        void upscale(const uint64_t* rows, uint16_t wordsPerRow);
+    };
+}
+
+#endif /* SCALER_H */
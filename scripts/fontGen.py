@@ -0,0 +1,75 @@
+# font text files to a c++ header of constexpr arrays
+#
+# usage: python3 fontGen.py <header> <font.txt>...
+#
+# a font file has a title line followed by the 16 glyphs 0x0 - 0xF,
+# each a "0xN:" line and 5 "0bXXXXXXXX" lines, one per row of the glyph.
+# fonts/cosmacvipfont.txt becomes chip8::fonts::cosmacvip.
+
+import os
+import sys
+
+GLYPHS = 16
+ROWS = 5
+
+
+def parse(path):
+    with open(path) as f:
+        lines = [line.strip() for line in f.read().splitlines()[1:]]
+
+    glyphs = {}
+    glyph = None
+    for n, line in enumerate(lines, start=2):
+        if not line:
+            continue
+        if line.startswith("0x") and line.endswith(":"):
+            glyph = int(line[:-1], 16)
+            glyphs[glyph] = []
+        elif line.startswith("0b") and glyph is not None:
+            glyphs[glyph].append(int(line, 2))
+        else:
+            sys.exit(f"{path}:{n}: unexpected line '{line}'")
+
+    if sorted(glyphs) != list(range(GLYPHS)) or any(len(rows) != ROWS for rows in glyphs.values()):
+        sys.exit(f"{path}: expected glyphs 0x0 - 0x{GLYPHS - 1:X} of {ROWS} rows each")
+
+    return [glyphs[g] for g in range(GLYPHS)]
+
+
+def main():
+    if len(sys.argv) < 3:
+        sys.exit("usage: fontGen.py <header> <font.txt>...")
+
+    out = [
+        "// generated by scripts/fontGen.py from the fonts directory, do not edit",
+        "",
+        "#ifndef FONTS_H",
+        "#define FONTS_H",
+        "",
+        "#include <stddef.h>",
+        "#include <stdint.h>",
+        "",
+        "#include <array>",
+        "",
+        "namespace chip8::fonts",
+        "{",
+        f"    constexpr size_t k_glyphSize = {ROWS};",
+    ]
+
+    for path in sorted(sys.argv[2:]):
+        name = os.path.basename(path).replace("font.txt", "")
+        out.append("")
+        out.append(f"    inline constexpr std::array<uint8_t, {GLYPHS * ROWS}> {name} {{")
+        glyphs = parse(path)
+        for g, rows in enumerate(glyphs):
+            sep = "," if g < GLYPHS - 1 else " "
+            out.append("        " + ", ".join(f"0x{r:02x}" for r in rows) + f"{sep} // {g:X}")
+        out.append("    };")
+
+    out += ["}", "", "#endif /* FONTS_H */", ""]
+
+    with open(sys.argv[1], "w") as f:
+        f.write("\n".join(out))
+
+
+main()
@@ -0,0 +1,212 @@
+#include "stats.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <filesystem>
+#include <new>
+#include <stdexcept>
+
+namespace chip8
+{
+    namespace
+    {
+        static_assert(std::atomic<uint64_t>::is_always_lock_free && std::atomic<uint32_t>::is_always_lock_free,
+                      "shared between processes, the atomics may not hide a lock");
+        static_assert(sizeof(StatsValues) % sizeof(uint64_t) == 0, "the values are copied a word at a time");
+
+        const char* const c_segmentPrefix = "chip8-stats.";
+
+        // a writer publishes once a frame, a reader missing it that often is being starved
+        constexpr int k_readAttempts = 64;
+
+        uint64_t nanosSinceEpoch()
+        {
+            return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+        }
+    }
+
+
+    void SharedStats::write(const StatsValues& from)
+    {
+        uint64_t words[k_words];
+        memcpy(words, &from, sizeof(words));
+
+        const uint32_t at = sequence.load(std::memory_order_relaxed);
+        sequence.store(at + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+
+        for (size_t i = 0; i < k_words; i++)
+            values[i].store(words[i], std::memory_order_relaxed);
+
+        sequence.store(at + 2, std::memory_order_release);
+    }
+
+    bool SharedStats::read(StatsValues& to) const
+    {
+        for (int attempt = 0; attempt < k_readAttempts; attempt++)
+        {
+            const uint32_t before = sequence.load(std::memory_order_acquire);
+            if (before & 1)
+                continue;
+
+            uint64_t words[k_words];
+            for (size_t i = 0; i < k_words; i++)
+                words[i] = values[i].load(std::memory_order_relaxed);
+
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (sequence.load(std::memory_order_relaxed) == before)
+            {
+                memcpy(&to, words, sizeof(to));
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+
+    StatsPublisher::StatsPublisher(const std::string& rom)
+        :   m_name(segmentName(getpid())),
+            m_summarized(std::chrono::steady_clock::now())
+    {
+        // left over by an earlier process of the same pid that did not get to clean up
+        shm_unlink(m_name.c_str());
+
+        const int fd = shm_open(m_name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0644);
+        if (fd < 0)
+            throw std::runtime_error("ERROR: Unable to create stats segment " + m_name + ": " + strerror(errno));
+
+        void* data = MAP_FAILED;
+        if (ftruncate(fd, sizeof(SharedStats)) == 0)
+            data = mmap(nullptr, sizeof(SharedStats), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        const int error = errno;
+        close(fd);
+
+        if (data == MAP_FAILED)
+        {
+            shm_unlink(m_name.c_str());
+            throw std::runtime_error("ERROR: Unable to map stats segment " + m_name + ": " + strerror(error));
+        }
+
+        // readers mapping it before the header is written reject it by its magic
+        m_shared = new (data) SharedStats{};
+        m_shared->version = SharedStats::k_version;
+        m_shared->pid = getpid();
+        m_shared->started = nanosSinceEpoch();
+        rom.copy(m_shared->rom, sizeof(m_shared->rom) - 1);
+
+        m_values.updated = m_shared->started;
+        m_shared->write(m_values);
+
+        m_shared->magic.store(SharedStats::k_magic, std::memory_order_release);
+    }
+
+    StatsPublisher::~StatsPublisher()
+    {
+        munmap(m_shared, sizeof(SharedStats));
+        shm_unlink(m_name.c_str());
+    }
+
+    void StatsPublisher::publish(const Interpreter& interpreter, std::chrono::nanoseconds frameTime, uint32_t keyChanges)
+    {
+        const Counters& counters = interpreter.counters();
+
+        m_frameTimes[m_values.frames % k_frameWindow] = frameTime.count();
+
+        m_values.frames++;
+        m_values.instructions = interpreter.instructions();
+        m_values.draws = counters.draws;
+        m_values.collisions = counters.collisions;
+        m_values.keyChanges += keyChanges;
+        m_values.stackHighWater = counters.stackHighWater;
+
+        if (m_values.frames % k_summaryFrames == 0)
+            summarize();
+
+        m_values.updated = nanosSinceEpoch();
+        m_shared->write(m_values);
+    }
+
+    void StatsPublisher::summarize()
+    {
+        const std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+        const std::chrono::duration<double> took = now - m_summarized;
+
+        if (took.count() > 0)
+            m_values.instructionsPerSecond = (m_values.instructions - m_summarizedInstructions) / took.count();
+        m_summarized = now;
+        m_summarizedInstructions = m_values.instructions;
+
+        const size_t count = std::min<uint64_t>(m_values.frames, k_frameWindow);
+        std::copy(m_frameTimes.begin(), m_frameTimes.begin() + count, m_sorted.begin());
+
+        const auto percentile = [&](size_t percent)
+        {
+            const size_t rank = (count - 1) * percent / 100;
+            std::nth_element(m_sorted.begin(), m_sorted.begin() + rank, m_sorted.begin() + count);
+            return m_sorted[rank];
+        };
+
+        m_values.frameTimeP99 = percentile(99);
+        m_values.frameTimeP90 = percentile(90);
+        m_values.frameTimeP50 = percentile(50);
+    }
+
+
+    StatsView::StatsView(const std::string& name)
+    {
+        const int fd = shm_open(name.c_str(), O_RDONLY, 0);
+        if (fd < 0)
+            throw std::runtime_error("ERROR: Unable to open stats segment " + name + ": " + strerror(errno));
+
+        struct stat info;
+        void* data = MAP_FAILED;
+        if (fstat(fd, &info) == 0 && static_cast<size_t>(info.st_size) >= sizeof(SharedStats))
+            data = mmap(nullptr, sizeof(SharedStats), PROT_READ, MAP_SHARED, fd, 0);
+        close(fd);
+
+        if (data == MAP_FAILED)
+            throw std::runtime_error("ERROR: " + name + " is no stats segment!");
+
+        m_shared = static_cast<const SharedStats*>(data);
+
+        if (m_shared->magic.load(std::memory_order_acquire) != SharedStats::k_magic || m_shared->version != SharedStats::k_version)
+        {
+            munmap(data, sizeof(SharedStats));
+            throw std::runtime_error("ERROR: " + name + " is no stats segment of this version!");
+        }
+    }
+
+    StatsView::~StatsView()
+    {
+        munmap(const_cast<SharedStats*>(m_shared), sizeof(SharedStats));
+    }
+
+
+    std::string segmentName(pid_t pid)
+    {
+        return "/" + std::string(c_segmentPrefix) + std::to_string(pid);
+    }
+
+    std::vector<std::string> listSegments()
+    {
+        std::vector<std::string> names;
+        std::error_code error;
+
+        for (const std::filesystem::directory_entry& entry : std::filesystem::directory_iterator{"/dev/shm", error})
+        {
+            const std::string file = entry.path().filename().string();
+            if (file.compare(0, strlen(c_segmentPrefix), c_segmentPrefix) == 0)
+                names.push_back("/" + file);
+        }
+
+        std::sort(names.begin(), names.end());
+        return names;
+    }
+}
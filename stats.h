@@ -0,0 +1,160 @@
+#ifndef STATS_H
+#define STATS_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <sys/types.h>
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <vector>
+
+#include "interpreter.h"
+
+namespace chip8
+{
+    /**
+     * What an emulator publishes about itself, all counted since it started
+    **/
+    struct StatsValues
+    {
+        uint64_t instructions;
+        uint64_t instructionsPerSecond;     // over the last second or so
+        uint64_t frames;
+        uint64_t draws;                     // see Counters
+        uint64_t collisions;
+        uint64_t keyChanges;                // keys pressed or released, as seen at frame starts
+        uint64_t stackHighWater;
+        uint64_t frameTimeP50;              // ns of work per frame, over the last k_frameWindow frames
+        uint64_t frameTimeP90;
+        uint64_t frameTimeP99;
+        uint64_t updated;                   // ns since the epoch, when these were written
+    };
+
+    /**
+     * The layout of a stats segment, a POSIX shared memory object named
+     * after the emulator's pid that other processes map read-only.
+     *
+     * The values are written by a single thread, once a frame. Each word is
+     * an atomic of its own, so a reader never sees half a word, and the
+     * sequence no. tells it whether the words it read belong together: it
+     * is odd while they are written and changed once they were.
+    **/
+    struct SharedStats
+    {
+        static constexpr uint32_t k_magic = 0x54533843;     // "C8ST"
+        static constexpr uint32_t k_version = 1;
+        static constexpr size_t k_words = sizeof(StatsValues) / sizeof(uint64_t);
+
+        std::atomic<uint32_t> magic;        // k_magic once the rest of the header is written
+
+        // constant once magic is set
+        uint32_t version;
+        pid_t pid;
+        uint64_t started;                   // ns since the epoch
+        char rom[256];                      // 0 terminated, cut to fit
+
+        std::atomic<uint32_t> sequence;
+        std::array<std::atomic<uint64_t>, k_words> values;
+
+        /**
+         * to be called by the writing thread only
+        **/
+        void write(const StatsValues& from);
+
+        /**
+         * copies a consistent set of values, retrying while they are written
+         * @returns false if every attempt overlapped a write
+        **/
+        bool read(StatsValues& to) const;
+    };
+
+    /**
+     * Keeps an emulator's stats segment up to date, one publish() per frame.
+     * The segment is removed again when this is destroyed.
+    **/
+    class StatsPublisher
+    {
+    public:
+        static constexpr size_t k_frameWindow = 256;
+
+        /**
+         * creates the segment of this process, see segmentName()
+         * @param rom shown by readers
+         * @throws runtime_error if it cannot be created
+        **/
+        explicit StatsPublisher(const std::string& rom);
+
+        ~StatsPublisher();
+
+        StatsPublisher(const StatsPublisher&) = delete;
+        StatsPublisher& operator=(const StatsPublisher&) = delete;
+
+        /**
+         * called as a frame ends
+         * @param frameTime how long it took to run, waiting excluded
+         * @param keyChanges no. of keys pressed or released since the last frame
+        **/
+        void publish(const Interpreter& interpreter, std::chrono::nanoseconds frameTime, uint32_t keyChanges);
+
+    private:
+        // the percentiles and the instructions per second are worked out every that many frames
+        static constexpr uint64_t k_summaryFrames = 60;
+
+        std::string m_name;
+        SharedStats* m_shared {};
+
+        StatsValues m_values {};
+
+        std::array<uint64_t, k_frameWindow> m_frameTimes {};
+        std::array<uint64_t, k_frameWindow> m_sorted {};
+
+        std::chrono::steady_clock::time_point m_summarized;
+        uint64_t m_summarizedInstructions {};
+
+        void summarize();
+    };
+
+    /**
+     * A stats segment of another process, mapped read-only
+    **/
+    class StatsView
+    {
+    public:
+        /**
+         * @param name as segmentName() returns it
+         * @throws runtime_error if it cannot be mapped or is no stats segment
+        **/
+        explicit StatsView(const std::string& name);
+
+        ~StatsView();
+
+        StatsView(const StatsView&) = delete;
+        StatsView& operator=(const StatsView&) = delete;
+
+        const SharedStats& shared() const { return *m_shared; }
+
+        /**
+         * see SharedStats::read()
+        **/
+        bool read(StatsValues& to) const { return m_shared->read(to); }
+
+    private:
+        const SharedStats* m_shared {};
+    };
+
+    /**
+     * @returns the name of the stats segment of process pid, "/chip8-stats.<pid>"
+    **/
+    std::string segmentName(pid_t pid);
+
+    /**
+     * @returns the names of all stats segments, found below /dev/shm where
+     *  Linux keeps them, POSIX has no way of listing them
+    **/
+    std::vector<std::string> listSegments();
+}
+
+#endif /* STATS_H */
@@ -0,0 +1,480 @@
+#include "tableengine.h"
+
+#include <stdlib.h>
+
+#include <algorithm>
+#include <array>
+#include <type_traits>
+#include <utility>
+
+#include "interpreter.h"
+
+// handlers jumping straight into the next one need guaranteed tail calls,
+// everywhere else run() loops over the table
+#if defined(__clang__) && defined(__has_cpp_attribute)
+#if __has_cpp_attribute(clang::musttail)
+#define TABLEENGINE_MUSTTAIL
+#endif
+#endif
+
+namespace chip8
+{
+    template <typename Profile>
+    struct TableEngine::Ops
+    {
+        using Handler = void (*)(Interpreter&, uint16_t);
+        using Threaded = void (*)(Interpreter&, uint16_t, uint64_t);
+
+        /**
+         * @returns
+         *  the opcode with the fields a handler reads at run time cleared,
+         *  opcodes doing nothing all map to 0x0000. every distinct value
+         *  gets its own handler.
+        **/
+        static constexpr uint16_t canonical(uint16_t op)
+        {
+            const uint8_t low = op & 0xFF;
+
+            switch (op >> 12)
+            {
+            case 0x0:   // 00Cn & 00Dn reading n at run time
+                if (op == 0x00E0 || op == 0x00EE || op == 0x00FB || op == 0x00FC || op == 0x00FE || op == 0x00FF)
+                    return op;
+                return (op & 0xFFF0) == 0x00C0 || (op & 0xFFF0) == 0x00D0 ? op & 0xFFF0 : 0x0000;
+
+            case 0x1: case 0x2: case 0xA: case 0xB:
+                return op & 0xF000;
+
+            case 0x5:   // X and the XO-CHIP 5xy2 & 5xy3 baked in
+                return (op & 0xF) == 0x2 || (op & 0xF) == 0x3 ? op & 0xFF0F : op & 0xFF00;
+
+            case 0x8:   // X, Y and the operation baked in
+                return (op & 0xF) <= 0x7 || (op & 0xF) == 0xE ? op : 0x0000;
+
+            case 0xE:   // other ExNN still report the key read
+                return low == 0x9E || low == 0xA1 ? op : op & 0xFF00;
+
+            case 0xF:
+                switch (low)
+                {
+                case 0x00: case 0x02:   // F000 nnnn & F002 only
+                    return op == 0xF000 || op == 0xF002 ? op : 0x0000;
+
+                case 0x01: case 0x07: case 0x0A: case 0x15: case 0x18: case 0x1E:
+                case 0x29: case 0x33: case 0x3A: case 0x55: case 0x65:
+                    return op;
+
+                default:
+                    return 0x0000;
+                }
+
+            default:    // 3xnn 4xnn 6xnn 7xnn 9xyN Cxnn Dxyn, X baked in
+                return op & 0xFF00;
+            }
+        }
+
+        /**
+         * the instruction canonical(op) == P stands for, exactly as
+         * Interpreter::execute<Profile, false>() does it
+        **/
+        template <uint16_t P>
+        static void exec(Interpreter& self, const uint16_t op)
+        {
+            constexpr uint8_t X = (P >> 8) & 0xF;
+            constexpr uint8_t Y = (P >> 4) & 0xF;
+            constexpr uint8_t N = P & 0xF;
+            constexpr Quirks quirks = Profile::k_quirks;
+
+            Cpu& cpu = *self.m_chip8Cpu;
+            Cpu::State& state = cpu.m_state;
+            std::array<uint8_t, 16>& V = state.registers;
+
+            if constexpr (P == 0x00E0)
+                self.m_chip8Display->clear();
+
+            else if constexpr (P == 0x00EE)
+            {
+                state.PC = cpu.peekStack();
+                cpu.popStack();
+            }
+
+            else if constexpr (P == 0x00C0 || P == 0x00D0 || P == 0x00FB || P == 0x00FC)
+            {
+                // scrolling up is XO-CHIP's own
+                if constexpr (P == 0x00D0 ? Profile::k_isXoChip : Profile::k_hasHires)
+                {
+                    const int8_t n = op & 0xF;
+                    self.m_chip8Display->scroll(P == 0x00FB ? 4 : P == 0x00FC ? -4 : 0,
+                                                P == 0x00C0 ? n : P == 0x00D0 ? -n : 0);
+                }
+            }
+
+            else if constexpr (P == 0x00FE || P == 0x00FF)
+            {
+                if constexpr (Profile::k_hasHires)
+                    self.m_chip8Display->setLowRes(P == 0x00FE);
+            }
+
+            else if constexpr (P == 0x1000)
+            {
+                state.PC = op & 0x0FFF;
+                return;
+            }
+
+            else if constexpr (P == 0x2000)
+            {
+                cpu.pushStack(state.PC);
+                state.PC = op & 0x0FFF;
+                self.m_counters.stackHighWater = std::max(self.m_counters.stackHighWater, state.stackDepth);
+                return;
+            }
+
+            else if constexpr ((P & 0xF000) == 0x3000)
+            {
+                if (V[X] == (op & 0xFF))
+                    state.PC += self.template skipSize<Profile>();
+            }
+
+            else if constexpr ((P & 0xF000) == 0x4000)
+            {
+                if (V[X] != (op & 0xFF))
+                    state.PC += self.template skipSize<Profile>();
+            }
+
+            else if constexpr ((P & 0xF00F) == 0x5002 || (P & 0xF00F) == 0x5003)
+            {
+                const uint8_t y = (op & 0xF0) >> 4;
+
+                if constexpr (!Profile::k_isXoChip)
+                {
+                    if (V[X] == V[y])
+                        state.PC += self.template skipSize<Profile>();
+                }
+                else
+                {
+                    const int8_t dir = X <= y ? 1 : -1;
+                    for (uint8_t i = 0; i <= abs(y - X); i++)
+                    {
+                        if constexpr (N == 0x2)
+                            self.m_chip8Memory->write(state.I + i, V[X + i * dir]);
+                        else
+                            V[X + i * dir] = self.m_chip8Memory->read(state.I + i);
+                    }
+                }
+            }
+
+            else if constexpr ((P & 0xF000) == 0x5000)
+            {
+                if (V[X] == V[(op & 0xF0) >> 4])
+                    state.PC += self.template skipSize<Profile>();
+            }
+
+            else if constexpr ((P & 0xF000) == 0x6000)
+                V[X] = op & 0xFF;
+
+            else if constexpr ((P & 0xF000) == 0x7000)
+                V[X] += op & 0xFF;
+
+            else if constexpr ((P & 0xF000) == 0x8000)
+            {
+                const uint8_t valX = V[X];
+                const uint8_t valY = V[Y];
+
+                if constexpr (N == 0x0)
+                    V[X] = valY;
+                else if constexpr (N == 0x1 || N == 0x2 || N == 0x3)
+                {
+                    V[X] = N == 0x1 ? valX | valY : N == 0x2 ? valX & valY : valX ^ valY;
+                    if constexpr (quirks.logicResetsVf)
+                        V[0xF] = 0;
+                }
+                else if constexpr (N == 0x4)
+                {
+                    V[X] = valX + valY;
+                    V[0xF] = (static_cast<uint16_t>(valX) + static_cast<uint16_t>(valY)) > 255;
+                }
+                else if constexpr (N == 0x5)
+                {
+                    V[X] = valX - valY;
+                    V[0xF] = valX > valY;
+                }
+                else if constexpr (N == 0x6)
+                {
+                    const uint8_t shifted = quirks.shiftUsesVy ? valY : valX;
+                    V[X] = shifted >> 1;
+                    V[0xF] = shifted & 1;
+                }
+                else if constexpr (N == 0x7)
+                {
+                    V[X] = valY - valX;
+                    V[0xF] = valY > valX;
+                }
+                else if constexpr (N == 0xE)
+                {
+                    const uint8_t shifted = quirks.shiftUsesVy ? valY : valX;
+                    V[X] = shifted << 1;
+                    V[0xF] = (shifted & (1 << 7)) >> 7;
+                }
+            }
+
+            else if constexpr ((P & 0xF000) == 0x9000)
+            {
+                if (V[X] != V[(op & 0xF0) >> 4])
+                    state.PC += self.template skipSize<Profile>();
+            }
+
+            else if constexpr (P == 0xA000)
+                state.I = op & 0xFFF;
+
+            else if constexpr (P == 0xB000)
+            {
+                state.PC = (op & 0xFFF) + V[quirks.jumpUsesVx ? (op & 0x0F00) >> 8 : 0x0];
+                return;
+            }
+
+            else if constexpr ((P & 0xF000) == 0xC000)
+                V[X] = (op & 0xFF) & (self.nextRandom() % 256);
+
+            else if constexpr ((P & 0xF000) == 0xD000)
+            {
+                // waiting for the next frame executes this again
+                if constexpr (quirks.displayWait)
+                {
+                    if (self.m_isFrameDrawn)
+                        return;
+                    self.m_isFrameDrawn = true;
+                }
+
+                const uint8_t x = V[X];
+                const uint8_t y = V[(op & 0xF0) >> 4];
+
+                const uint8_t n = op & 0xF;
+                const uint8_t size = self.m_chip8Display->spriteSize(n);
+
+                uint8_t sprite[Display::k_maxSpriteSize] {};
+                for (uint16_t i = 0; i < size; i++)
+                    sprite[i] = self.m_chip8Memory->read(state.I + i);
+
+                V[0xF] = self.m_chip8Display->template attachSprite<quirks.spritesWrap>(sprite, n, x, y);
+                self.m_counters.draws++;
+                self.m_counters.collisions += V[0xF];
+
+                if (self.m_latency && std::any_of(sprite, sprite + size, [](uint8_t row) { return row != 0; }))
+                    self.m_latency->drawn();
+            }
+
+            else if constexpr ((P & 0xF000) == 0xE000)
+            {
+                const uint8_t valX = V[X];
+
+                if (self.m_latency)
+                    self.m_latency->keyRead(1 << (valX & 0xF));
+
+                if constexpr ((P & 0xFF) == 0x9E)
+                {
+                    if (self.m_chip8Keypad->isPressed(valX))
+                        state.PC += self.template skipSize<Profile>();
+                }
+                else if constexpr ((P & 0xFF) == 0xA1)
+                {
+                    if (!self.m_chip8Keypad->isPressed(valX))
+                        state.PC += self.template skipSize<Profile>();
+                }
+            }
+
+            else if constexpr (P == 0xF000)
+            {
+                if constexpr (Profile::k_isXoChip)
+                {
+                    state.I = self.m_chip8Memory->readWord(state.PC + 2);
+                    state.PC += 2;
+                }
+            }
+
+            else if constexpr ((P & 0xF0FF) == 0xF001)
+            {
+                if constexpr (Profile::k_isXoChip)
+                    self.m_chip8Display->selectPlanes(X);
+            }
+
+            else if constexpr (P == 0xF002)
+            {
+                if constexpr (Profile::k_isXoChip)
+                    for (uint8_t i = 0; i < state.audioPattern.size(); i++)
+                        state.audioPattern[i] = self.m_chip8Memory->read(state.I + i);
+            }
+
+            else if constexpr ((P & 0xF0FF) == 0xF007)
+                V[X] = state.delayTimer;
+
+            else if constexpr ((P & 0xF0FF) == 0xF00A)
+            {
+                if (self.m_latency)
+                    self.m_latency->keyRead(0xFFFF);
+
+                if (self.m_keyWait)
+                    V[X] = self.m_keyWait();
+                else if (const uint16_t keys = self.m_chip8Keypad->keys())
+                    V[X] = __builtin_ctz(keys);
+                else
+                    return;
+            }
+
+            else if constexpr ((P & 0xF0FF) == 0xF015)
+                state.delayTimer = V[X];
+
+            else if constexpr ((P & 0xF0FF) == 0xF018)
+                state.soundTimer = V[X];
+
+            else if constexpr ((P & 0xF0FF) == 0xF01E)
+                state.I += V[X];
+
+            else if constexpr ((P & 0xF0FF) == 0xF03A)
+            {
+                if constexpr (Profile::k_isXoChip)
+                    state.pitch = V[X];
+            }
+
+            else if constexpr ((P & 0xF0FF) == 0xF029)
+                state.I = Memory::c_fontStartAddr + (V[X] & 0xF) * fonts::k_glyphSize;
+
+            else if constexpr ((P & 0xF0FF) == 0xF033)
+            {
+                const uint8_t val = V[X];
+                self.m_chip8Memory->write(state.I, val / 100);
+                self.m_chip8Memory->write(state.I + 1, (val % 100) / 10);
+                self.m_chip8Memory->write(state.I + 2, val % 10);
+            }
+
+            else if constexpr ((P & 0xF0FF) == 0xF055)
+            {
+                for (uint8_t i = 0; i <= X; i++)
+                    self.m_chip8Memory->write(state.I + i, V[i]);
+                if constexpr (quirks.loadStoreIncrementsI)
+                    state.I += X + 1;
+            }
+
+            else if constexpr ((P & 0xF0FF) == 0xF065)
+            {
+                for (uint8_t i = 0; i <= X; i++)
+                    V[i] = self.m_chip8Memory->read(state.I + i);
+                if constexpr (quirks.loadStoreIncrementsI)
+                    state.I += X + 1;
+            }
+
+            state.PC += 2;
+        }
+
+#ifdef TABLEENGINE_MUSTTAIL
+        /**
+         * exec<P>() followed by a jump into the handler of the next
+         * instruction, till left instructions ran
+        **/
+        template <uint16_t P>
+        static void threaded(Interpreter& self, const uint16_t op, uint64_t left)
+        {
+            exec<P>(self, op);
+            self.m_instructions++;
+
+            if (--left == 0)
+                return;
+
+            const uint16_t next = self.fetch();
+            [[clang::musttail]] return Tables<Profile>::c_threaded[next](self, next, left);
+        }
+#endif
+
+        template <typename Entry, uint16_t P>
+        static constexpr Entry entry()
+        {
+#ifdef TABLEENGINE_MUSTTAIL
+            if constexpr (std::is_same_v<Entry, Threaded>)
+                return &threaded<P>;
+            else
+#endif
+                return &exec<P>;
+        }
+
+        /**
+         * @returns the entries of the opcodes High000 to HighFFF
+        **/
+        template <typename Entry, uint16_t High, size_t... Low>
+        static constexpr std::array<Entry, 0x1000> chunk(std::index_sequence<Low...>)
+        {
+            return {{ entry<Entry, canonical((High << 12) | Low)>()... }};
+        }
+
+        template <typename Entry, size_t... High>
+        static constexpr std::array<Entry, 0x10000> table(std::index_sequence<High...>)
+        {
+            std::array<Entry, 0x10000> table {};
+
+            // one 4096 opcode chunk at a time, a single pack of 65536 is too much for compilers
+            ([&table]
+            {
+                const std::array<Entry, 0x1000> opcodes = chunk<Entry, High>(std::make_index_sequence<0x1000>{});
+                for (size_t low = 0; low < opcodes.size(); low++)
+                    table[(High << 12) | low] = opcodes[low];
+            }(), ...);
+
+            return table;
+        }
+    };
+
+    template <typename Profile>
+    struct TableEngine::Tables
+    {
+        using Ops = TableEngine::Ops<Profile>;
+
+        static constexpr std::array<typename Ops::Handler, 0x10000> c_table =
+            Ops::template table<typename Ops::Handler>(std::make_index_sequence<0x10>{});
+
+#ifdef TABLEENGINE_MUSTTAIL
+        static constexpr std::array<typename Ops::Threaded, 0x10000> c_threaded =
+            Ops::template table<typename Ops::Threaded>(std::make_index_sequence<0x10>{});
+#endif
+
+        static void run(Interpreter& interpreter, uint64_t instructions)
+        {
+#ifdef TABLEENGINE_MUSTTAIL
+            if (instructions > 0)
+            {
+                const uint16_t op = interpreter.fetch();
+                c_threaded[op](interpreter, op, instructions);
+            }
+#else
+            for (uint64_t i = 0; i < instructions; i++)
+            {
+                const uint16_t op = interpreter.fetch();
+                c_table[op](interpreter, op);
+                interpreter.m_instructions++;
+            }
+#endif
+        }
+    };
+
+
+    template <typename Profile>
+    bool TableEngine::step(Interpreter& interpreter)
+    {
+        const uint16_t op = interpreter.fetch();
+        Tables<Profile>::c_table[op](interpreter, op);
+        interpreter.m_instructions++;
+
+        return true;
+    }
+
+    template bool TableEngine::step<CosmacVipProfile>(Interpreter& interpreter);
+    template bool TableEngine::step<Chip48Profile>(Interpreter& interpreter);
+    template bool TableEngine::step<SuperChipProfile>(Interpreter& interpreter);
+    template bool TableEngine::step<XoChipProfile>(Interpreter& interpreter);
+
+    void TableEngine::run(Interpreter& interpreter, uint64_t instructions)
+    {
+        // once per call, the handlers know their quirks
+        visitProfile(interpreter.platform(), [&interpreter, instructions](auto profile)
+        {
+            Tables<decltype(profile)>::run(interpreter, instructions);
+        });
+    }
+}
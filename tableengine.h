@@ -0,0 +1,44 @@
+#ifndef TABLEENGINE_H
+#define TABLEENGINE_H
+
+#include <stdint.h>
+
+namespace chip8
+{
+    class Interpreter;
+
+    /**
+     * Dispatch through a table built at compile time with a handler for every
+     * one of the 65536 opcodes, the register numbers and the 8xyN operation
+     * baked into each handler instead of decoded per instruction.
+     *
+     * Does the same as Interpreter::execute() without tracing, so a debugger
+     * with something armed always goes through the switch. As that, there is
+     * a table specialized on each QuirkProfile.
+    **/
+    class TableEngine
+    {
+    public:
+        /**
+         * executes the instruction at PC with the quirks of Profile, may be
+         * used as Interpreter::step() of an interpreter of its platform
+         * @returns true
+        **/
+        template <typename Profile>
+        static bool step(Interpreter& interpreter);
+
+        /**
+         * executes instructions instructions back to back, with the quirks of
+         * the interpreter's platform. where the compiler guarantees tail calls
+         * each handler jumps straight into the next one.
+        **/
+        static void run(Interpreter& interpreter, uint64_t instructions);
+
+    private:
+        // in tableengine.cpp
+        template <typename Profile> struct Ops;         // the handlers
+        template <typename Profile> struct Tables;      // the opcode tables over them
+    };
+}
+
+#endif /* TABLEENGINE_H */
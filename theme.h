@@ -7,6 +7,10 @@ namespace theme
 {
     emuGL::Color backgroundColor = emuGL::Colors::pastelCream;
     emuGL::Color foregroundColor = emuGL::Colors::pastelRed;
+
+    // XO-CHIP pixels set on the second plane only and on both
+    emuGL::Color secondPlaneColor = emuGL::Colors::pastelDarkBlue;
+    emuGL::Color bothPlanesColor = emuGL::Colors::pastelDarkPurple;
 } // namespace theme
 
 
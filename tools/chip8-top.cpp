@@ -0,0 +1,121 @@
+#include <sys/stat.h>
+
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../stats.h"
+
+/**
+ * Shows every emulator running with --stats, see chip8::StatsPublisher.
+ * Only maps their stats segments read-only, they are neither stopped nor
+ * signalled.
+ *
+ * usage: chip8-top [options]
+ *  --interval <ms>  time between refreshes, 1000 if not given
+ *  --once           prints the table once instead of refreshing the screen
+**/
+
+namespace
+{
+    /**
+     * @returns false if process pid is gone, e.g. crashed without removing its segment
+    **/
+    bool isRunning(pid_t pid)
+    {
+        struct stat info;
+        return stat(("/proc/" + std::to_string(pid)).c_str(), &info) == 0;
+    }
+
+    /**
+     * @returns the last part of path, what fits of it into width
+    **/
+    std::string shortName(const std::string& path, size_t width)
+    {
+        const size_t slash = path.find_last_of('/');
+        const std::string name = slash == std::string::npos ? path : path.substr(slash + 1);
+        return name.size() > width ? name.substr(0, width - 1) + "~" : name;
+    }
+
+    void printTable(std::ostream& out)
+    {
+        const uint64_t now = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+
+        out << std::setw(7) << "PID" << "  " << std::setw(24) << std::left << "ROM" << std::right
+            << std::setw(8) << "UPTIME" << std::setw(9) << "FRAMES" << std::setw(13) << "INSTR" << std::setw(11) << "IPS"
+            << std::setw(10) << "DRAWS" << std::setw(9) << "COLL" << std::setw(7) << "KEYS" << std::setw(6) << "STACK"
+            << std::setw(9) << "P50 us" << std::setw(9) << "P90 us" << std::setw(9) << "P99 us" << std::setw(7) << "IDLE" << '\n';
+
+        for (const std::string& name : chip8::listSegments())
+        {
+            std::unique_ptr<chip8::StatsView> view;
+            try
+            {
+                view = std::make_unique<chip8::StatsView>(name);
+            }
+            catch (const std::runtime_error&)
+            {
+                // being set up, or gone since it was listed
+                continue;
+            }
+
+            const chip8::SharedStats& shared = view->shared();
+            if (!isRunning(shared.pid))
+                continue;
+
+            chip8::StatsValues values;
+            if (!view->read(values))
+                continue;
+
+            out << std::setw(7) << shared.pid << "  " << std::setw(24) << std::left << shortName(shared.rom, 23) << std::right
+                << std::setw(7) << (now - shared.started) / 1000000000 << 's'
+                << std::setw(9) << values.frames << std::setw(13) << values.instructions << std::setw(11) << values.instructionsPerSecond
+                << std::setw(10) << values.draws << std::setw(9) << values.collisions << std::setw(7) << values.keyChanges
+                << std::setw(6) << values.stackHighWater
+                << std::setw(9) << values.frameTimeP50 / 1000 << std::setw(9) << values.frameTimeP90 / 1000 << std::setw(9) << values.frameTimeP99 / 1000
+                // time since the last frame ended, e.g. stopped in the debugger
+                << std::setw(6) << (now > values.updated ? (now - values.updated) / 1000000000 : 0) << "s\n";
+        }
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    uint32_t interval = 1000;
+    bool once = false;
+
+    for (int i = 1; i < argc; i++)
+    {
+        const std::string arg = argv[i];
+
+        if (arg == "--interval" && i + 1 < argc)
+            interval = std::stoul(argv[++i]);
+        else if (arg == "--once")
+            once = true;
+        else
+        {
+            std::cerr << "unknown argument: " << arg << '\n';
+            return 2;
+        }
+    }
+
+    if (once)
+    {
+        printTable(std::cout);
+        return 0;
+    }
+
+    while (true)
+    {
+        // home and clear, then the table
+        std::cout << "\033[H\033[2J";
+        printTable(std::cout);
+        std::cout << std::flush;
+
+        std::this_thread::sleep_for(std::chrono::milliseconds(interval));
+    }
+}
@@ -0,0 +1,124 @@
+#include <chrono>
+#include <filesystem>
+#include <iostream>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "../lockstep.h"
+#include "../rom.h"
+
+/**
+ * Runs roms on the switch and the table engine side by side, see chip8::Lockstep.
+ *
+ * usage: lockstep [options] <rom|directory>...
+ *  --frames <n>    60Hz frames to run every rom for, 36000 (10 minutes) if not given
+ *  --ipf <n>       instructions per frame, 15 if not given
+ *  --block <n>     instructions between comparisons, 1024 if not given, 1 compares after each
+ *  --movie <file>  keys to hold, see chip8::InputMovie, none held if not given
+ *  --platform <p>  to run every rom on, see chip8::c_platformKeys, the one detected if not given
+ *
+ * exits with 1 at the first rom the engines diverge on.
+**/
+
+namespace
+{
+    struct Options
+    {
+        uint32_t frames { 36000 };
+        uint32_t instructionsPerFrame { 15 };
+        uint32_t blockSize { 1024 };
+        chip8::InputMovie movie;
+        std::optional<chip8::Platform> platform;
+    };
+
+    /**
+     * @returns false if the engines diverged
+    **/
+    bool check(const std::string& name, const uint8_t* rom, size_t size, chip8::Platform platform, const Options& options)
+    {
+        chip8::Lockstep lockstep{rom, size, platform, chip8::Interpreter::Engine::Table, options.instructionsPerFrame};
+        lockstep.setBlockSize(options.blockSize);
+        lockstep.setMovie(&options.movie);
+
+        const std::chrono::time_point<std::chrono::steady_clock> start = std::chrono::steady_clock::now();
+        const chip8::Lockstep::Outcome outcome = lockstep.run(options.frames);
+        const std::chrono::duration<double> took = std::chrono::steady_clock::now() - start;
+
+        std::cout << name << ": " << lockstep.instructions() << " instructions agreed, "
+                  << lockstep.instructions() / took.count() / 1e6 << " M/s\n";
+
+        if (outcome == chip8::Lockstep::Outcome::Stopped)
+            std::cout << "  both stopped with: " << lockstep.error() << '\n';
+
+        if (outcome == chip8::Lockstep::Outcome::Diverged)
+        {
+            lockstep.report(std::cout);
+            return false;
+        }
+
+        return true;
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    Options options;
+    std::vector<std::string> paths;
+
+    try
+    {
+        for (int i = 1; i < argc; i++)
+        {
+            const std::string arg = argv[i];
+
+            if (arg == "--frames" && i + 1 < argc)
+                options.frames = std::stoul(argv[++i]);
+            else if (arg == "--ipf" && i + 1 < argc)
+                options.instructionsPerFrame = std::stoul(argv[++i]);
+            else if (arg == "--block" && i + 1 < argc)
+                options.blockSize = std::stoul(argv[++i]);
+            else if (arg == "--movie" && i + 1 < argc)
+                options.movie = chip8::InputMovie{argv[++i]};
+            else if (arg == "--platform" && i + 1 < argc)
+            {
+                chip8::Platform platform;
+                if (!chip8::platformFromKey(argv[++i], platform))
+                {
+                    std::cerr << "--platform takes " << chip8::c_platformKeys << '\n';
+                    return 2;
+                }
+                options.platform = platform;
+            }
+            else if (arg[0] == '-')
+            {
+                std::cerr << "unknown argument: " << arg << '\n';
+                return 2;
+            }
+            else
+                paths.push_back(arg);
+        }
+
+        for (const std::string& path : paths)
+        {
+            if (std::filesystem::is_directory(path))
+            {
+                const chip8::RomCatalog catalog{path, nullptr, options.platform};
+                for (const chip8::RomCatalog::Entry& entry : catalog.entries())
+                    if (!check(entry.path, catalog.image(entry), entry.size, entry.platform, options))
+                        return 1;
+            }
+            else
+            {
+                const chip8::MappedRom rom{path};
+                if (!check(path, rom.data(), rom.size(), chip8::choosePlatform(rom.data(), rom.size(), nullptr, options.platform), options))
+                    return 1;
+            }
+        }
+    }
+    catch (const std::exception& e)
+    {
+        std::cerr << e.what() << '\n';
+        return 2;
+    }
+}
@@ -0,0 +1,69 @@
+#ifndef TRIPLEBUFFER_H
+#define TRIPLEBUFFER_H
+
+#include <stdint.h>
+
+#include <atomic>
+
+namespace emuGL
+{
+    /**
+     * Lock-free handoff of whole values, e.g. frames, from one writer thread
+     * to one reader thread.
+     *
+     * The writer fills back() and publishes it, the reader takes the latest
+     * published value with update() and reads front(). Neither side ever
+     * waits on the other, a value the reader did not get to is overwritten.
+    **/
+    template <typename T>
+    class TripleBuffer
+    {
+    public:
+        TripleBuffer(const T& initial)
+            :   m_slots{ initial, initial, initial }
+        { }
+
+        TripleBuffer(const TripleBuffer&) = delete;
+        TripleBuffer& operator=(const TripleBuffer&) = delete;
+
+        /**
+         * @returns the slot the writer fills, only to be used by the writer
+        **/
+        T& back() { return m_slots[m_back]; }
+
+        /**
+         * makes back() the latest value and hands the writer another slot
+        **/
+        void publish()
+        {
+            m_back = m_middle.exchange(m_back | k_fresh, std::memory_order_acq_rel) & k_index;
+        }
+
+        /**
+         * moves the latest published value to front(), only to be used by the reader
+         * @returns false if nothing was published since the last call
+        **/
+        bool update()
+        {
+            if (!(m_middle.load(std::memory_order_relaxed) & k_fresh))
+                return false;
+
+            m_front = m_middle.exchange(m_front, std::memory_order_acq_rel) & k_index;
+            return true;
+        }
+
+        const T& front() const { return m_slots[m_front]; }
+
+    private:
+        static constexpr uint8_t k_index = 0x3;
+        static constexpr uint8_t k_fresh = 0x4;     // set in m_middle while it was not read
+
+        T m_slots[3];
+
+        uint8_t m_back { 0 };
+        std::atomic<uint8_t> m_middle { 1 };
+        uint8_t m_front { 2 };
+    };
+}
+
+#endif /* TRIPLEBUFFER_H */
@@ -0,0 +1,140 @@
+#ifndef WALL_H
+#define WALL_H
+
+#include <stdint.h>
+
+#include <chrono>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "chip8.h"
+#include "interpreter.h"
+#include "rom.h"
+#include "analysiscache.h"
+#include "tableengine.h"
+#include "drivers.h"
+
+namespace chip8
+{
+    /**
+     * Runs a rom on many machines at once and shows them all in one window,
+     * see drivers::Wall. Every machine draws other random numbers, the keys
+     * pressed go to all of them.
+    **/
+    class WallViewer
+    {
+    public:
+        /**
+         * @param count no. of machines
+         * @param analysisCache, platform see Emulator::Emulator()
+         * @throws runtime_error if count is 0 or the rom cannot be loaded
+        **/
+        WallViewer(size_t count, std::string romPath, chip8::AnalysisCache* analysisCache = nullptr,
+                   std::optional<Platform> chosen = std::nullopt)
+        {
+            if (count == 0)
+                throw std::runtime_error("ERROR: The wall needs at least one machine!");
+
+            const chip8::MappedRom rom{romPath};
+            const Platform platform = chip8::choosePlatform(rom.data(), rom.size(), analysisCache, chosen);
+
+            for (size_t index = 0; index < count; index++)
+            {
+                m_machines.push_back(new chip8::Interpreter{rom.data(), rom.size(), platform});
+
+                const uint32_t seed = Interpreter::k_randomSeed + index * 0x9E3779B9u;
+                m_machines.back()->setRandomState(seed ? seed : Interpreter::k_randomSeed);
+            }
+            m_errors.resize(count);
+            m_instructionsPerFrame = chip8::instructionsPerFrameFor(platform);
+
+            chip8::Display* display = m_machines.front()->display();
+            m_wall = new drivers::Wall{count, display->width(), display->height()};
+        }
+
+        ~WallViewer()
+        {
+            for (chip8::Interpreter* machine : m_machines)
+                delete machine;
+
+            delete m_wall;
+        }
+
+        WallViewer(const WallViewer&) = delete;
+        WallViewer& operator=(const WallViewer&) = delete;
+
+        /**
+         * see Emulator::setInstructionsPerFrame()
+        **/
+        void setInstructionsPerFrame(uint32_t instructions) { m_instructionsPerFrame = instructions; }
+
+        /**
+         * runs every machine a frame per 60th of a second and shows them,
+         * till the window is closed. machines running into a rom fault stop
+         * and keep showing their last frame, their errors are printed on
+         * return.
+        **/
+        void run()
+        {
+            std::chrono::time_point<std::chrono::steady_clock> frameEnd = std::chrono::steady_clock::now();
+
+            while (!m_input.shouldQuit())
+            {
+                m_input.updateKeyStates(&m_keypad);
+                const uint16_t keys = m_keypad.keys();
+
+                for (size_t index = 0; index < m_machines.size(); index++)
+                {
+                    chip8::Interpreter& machine = *m_machines[index];
+                    if (!m_errors[index].empty())
+                        continue;
+
+                    machine.keypad()->setKeys(keys);
+                    try
+                    {
+                        TableEngine::run(machine, m_instructionsPerFrame);
+                        machine.decrementTimers();
+                    }
+                    catch (const std::exception& e)
+                    {
+                        m_errors[index] = e.what();
+                    }
+
+                    m_wall->show(index, machine.display()->screenBuffer(), machine.display()->wordsPerRow());
+                }
+
+                m_wall->present();
+
+                // after a stall go on from now instead of rushing to catch up
+                frameEnd += std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<int64_t, std::ratio<1, 60>>{1});
+                const std::chrono::time_point<std::chrono::steady_clock> now = std::chrono::steady_clock::now();
+                if (now - frameEnd > c_maxLag)
+                    frameEnd = now;
+                else
+                    std::this_thread::sleep_until(frameEnd);
+            }
+
+            for (size_t index = 0; index < m_errors.size(); index++)
+                if (!m_errors[index].empty())
+                    std::cerr << "machine " << index << ": " << m_errors[index] << '\n';
+        }
+
+    private:
+        std::vector<chip8::Interpreter*> m_machines;
+        std::vector<std::string> m_errors;      // per machine, empty while it runs
+
+        uint32_t m_instructionsPerFrame;
+
+        // see Emulator::c_maxLag
+        inline static const std::chrono::milliseconds c_maxLag { 100 };
+
+        drivers::Wall* m_wall {};
+        drivers::Input m_input;
+        chip8::Keypad m_keypad;                 // the keys held on the host
+    };
+}
+
+#endif /* WALL_H */
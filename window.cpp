@@ -19,6 +19,47 @@ namespace emuGL
         SDL_RenderPresent(m_renderer);
     }
 
+    void Window::present(const uint32_t* pixels, int width, int height)
+    {
+        setTextureSize(width, height);
+        updateTextureRows(pixels, 0, height);
+        presentTexture();
+    }
+
+    void Window::setTextureSize(int width, int height)
+    {
+        if (m_texture && m_textureW == width && m_textureH == height)
+            return;
+
+        if (m_texture)
+            SDL_DestroyTexture(m_texture);
+
+        m_texture = SDL_CreateTexture(m_renderer, SDL_PIXELFORMAT_RGBA32, SDL_TEXTUREACCESS_STREAMING, width, height);
+        if (!m_texture) throw std::runtime_error(SDL_GetError());
+
+        m_textureW = width;
+        m_textureH = height;
+    }
+
+    void Window::updateTextureRows(const uint32_t* rows, int y, int height)
+    {
+        const SDL_Rect area { 0, y, m_textureW, height };
+        SDL_UpdateTexture(m_texture, &area, rows, m_textureW * sizeof(uint32_t));
+    }
+
+    void Window::presentTexture()
+    {
+        SDL_SetRenderDrawColor(m_renderer,
+                m_bgCol.red(), m_bgCol.green(), m_bgCol.blue(), m_bgCol.alpha());
+        SDL_RenderClear(m_renderer);
+        SDL_RenderCopy(m_renderer, m_texture, nullptr, nullptr);
+
+        for (int i = 0; i < m_shapes.size(); i++)
+            m_shapes[i]->draw(this);
+
+        SDL_RenderPresent(m_renderer);
+    }
+
     void Window::initializeSdlObjects()
     {
         if (SDL_Init(SDL_INIT_VIDEO) < 0)
@@ -31,7 +72,7 @@ namespace emuGL
             SDL_WINDOW_MAXIMIZED);
         if (!m_window) throw std::runtime_error(SDL_GetError());
 
-        m_renderer = SDL_CreateRenderer(m_window, -1, SDL_RENDERER_ACCELERATED);
+        m_renderer = SDL_CreateRenderer(m_window, -1, SDL_RENDERER_ACCELERATED | SDL_RENDERER_PRESENTVSYNC);
         if (!m_renderer) throw std::runtime_error(SDL_GetError());
     }
 }
\ No newline at end of file
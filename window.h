@@ -37,6 +37,9 @@ namespace emuGL
 
         ~Window()
         {
+            if (m_texture)
+                SDL_DestroyTexture(m_texture);
+
             SDL_DestroyRenderer(m_renderer);
             SDL_DestroyWindow(m_window);
 
@@ -53,6 +56,32 @@ namespace emuGL
         */
         void update();
 
+        /**
+         * shows a frame of RGBA pixels (4 bytes each, in R, G, B, A order)
+         * stretched over the window through a streaming texture, with the
+         * attached shapes drawn on top.
+         * does not have a main loop, it should be used inside a main loop.
+        */
+        void present(const uint32_t* pixels, int width, int height);
+
+        /**
+         * makes the streaming texture width x height pixels, keeping what
+         * it holds if it has that size already
+        **/
+        void setTextureSize(int width, int height);
+
+        /**
+         * copies height rows of RGBA pixels, as wide as the texture, into
+         * the texture from row y on, leaving the other rows be
+        **/
+        void updateTextureRows(const uint32_t* rows, int y, int height);
+
+        /**
+         * shows the texture stretched over the window, with the attached
+         * shapes drawn on top, a single copy of the texture whatever it holds
+        **/
+        void presentTexture();
+
         void attach(const Shape& shape) { m_shapes.push_back(&shape); }
 
         const Color& bgColor() { return m_bgCol; }
@@ -74,6 +103,10 @@ namespace emuGL
         SDL_Window* m_window {};
         SDL_Renderer* m_renderer {};
 
+        SDL_Texture* m_texture {};
+        int m_textureW {};
+        int m_textureH {};
+
         SDL_Event m_currEvent;
 
         void initializeSdlObjects();